@@ -1,11 +1,23 @@
 
 #include "LabSoundInterface.h"
+#include "lab_bundle.h"
 #include "lab_imgui_ext.hpp"
 
 #include <LabSound/LabSound.h>
 #include "OSCNode.hpp"
-
+#include "LatencyProbeNode.hpp"
+#include "lab_histogram.h"
+#include "lab_instrument.h"
+#include "lab_memory.h"
+#include "lab_rt_guard.h"
+#include "lab_timing_ring.h"
+#include "lab_trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <stdio.h>
+#include <type_traits>
 
 using std::map;
 using std::shared_ptr;
@@ -13,16 +25,6 @@ using std::unique_ptr;
 using std::string;
 using std::vector;
 
-struct NodeReverseLookup
-{
-    map<string, ln_Pin> input_pin_map;
-    map<string, ln_Pin> output_pin_map;
-    map<string, ln_Pin> param_pin_map;
-};
-
-map<ln_Node, NodeReverseLookup, cmp_ln_Node> g_node_reverse_lookups;
-unique_ptr<lab::AudioContext> g_audio_context;
-
 // Returns input, output
 inline std::pair<lab::AudioStreamConfig, lab::AudioStreamConfig> GetDefaultAudioDeviceConfiguration(const bool with_input = false)
 {
@@ -40,15 +42,283 @@ inline std::pair<lab::AudioStreamConfig, lab::AudioStreamConfig> GetDefaultAudio
     };
 }
 
+// Returns input, output, as described by settings. Devices that can't be
+// found are reported, and the defaults are used in their place.
+std::pair<lab::AudioStreamConfig, lab::AudioStreamConfig> AudioDeviceConfiguration(const lab::noodle::AudioDeviceSettings& settings)
+{
+    std::pair<lab::AudioStreamConfig, lab::AudioStreamConfig> config = GetDefaultAudioDeviceConfiguration(settings.with_input);
+    lab::AudioStreamConfig& input = config.first;
+    lab::AudioStreamConfig& output = config.second;
 
-shared_ptr<lab::AudioNode> NodeFactory(const string& n)
+    if (!settings.output_device.empty() || (settings.with_input && !settings.input_device.empty()))
+    {
+        bool found_output = settings.output_device.empty();
+        bool found_input = !settings.with_input || settings.input_device.empty();
+        for (const lab::AudioDeviceInfo& info : lab::MakeAudioDeviceList())
+        {
+            if (!found_output && info.identifier == settings.output_device && info.num_output_channels > 0)
+            {
+                output.device_index = info.index;
+                output.desired_channels = std::min(2u, info.num_output_channels);
+                output.desired_samplerate = info.nominal_samplerate;
+                found_output = true;
+            }
+            if (!found_input && info.identifier == settings.input_device && info.num_input_channels > 0)
+            {
+                input.device_index = info.index;
+                input.desired_channels = std::min(1u, info.num_input_channels);
+                input.desired_samplerate = info.nominal_samplerate;
+                found_input = true;
+            }
+        }
+        if (!found_output)
+            printf("Output device %s not found, using the default\n", settings.output_device.c_str());
+        if (!found_input)
+            printf("Input device %s not found, using the default\n", settings.input_device.c_str());
+    }
+
+    if (settings.output_channels > 0)
+        output.desired_channels = settings.output_channels;
+    if (settings.with_input && settings.input_channels > 0)
+        input.desired_channels = settings.input_channels;
+
+    // the input and output run at a common rate
+    if (settings.sample_rate > 0)
+        output.desired_samplerate = settings.sample_rate;
+    if (settings.with_input)
+        input.desired_samplerate = output.desired_samplerate;
+
+    return config;
+}
+
+
+shared_ptr<lab::AudioNode> NodeFactory(lab::AudioContext& ac, const string& n)
 {
-    lab::AudioContext& ac = *g_audio_context.get();
     lab::AudioNode* node = lab::NodeRegistry::Instance().Create(n, ac);
     return std::shared_ptr<lab::AudioNode>(node);
 }
 
 
+// Captures the time each node spent in every quantum. The context pulls it
+// after rendering the graph, so the nodes' timings are for the quantum
+// just rendered. The nodes to sample are handed over by the UI thread as a
+// whole list, which the audio thread adopts between quanta; the list it
+// replaces is handed back for the UI thread to free, so the audio thread
+// never allocates, frees, or waits. Each list carries a ring sized for its
+// own nodes, so that a quantum's timings always fit.
+//
+// Each quantum's render time is also measured against the quantum's
+// duration. LabSound doesn't surface the device's underflow status, so an
+// underrun is inferred from the device's callbacks: a backend may render
+// several quanta back to back in one callback, so quanta that follow the
+// previous one without a pause are counted into the same callback, and a
+// callback that begins more than twice the previous callback's audio after
+// the previous one began means the device probably ran dry.
+struct QuantumTimingCapture : public lab::AudioNode
+{
+    // the number of quanta a list's ring holds before the UI thread must drain it
+    static constexpr size_t quanta_buffered = 64;
+
+    struct NodeList
+    {
+        using Nodes = std::vector<std::pair<uint64_t, std::shared_ptr<lab::AudioNode>>>;
+
+        NodeList(Nodes&& nodes_, std::shared_ptr<lab::AudioNode> device_)
+            : nodes(std::move(nodes_)), device(std::move(device_))
+            , scratch(nodes.size() + 1), ring((nodes.size() + 1) * quanta_buffered) {}
+
+        Nodes nodes;
+        std::shared_ptr<lab::AudioNode> device;
+        std::vector<lab::noodle::QuantumTiming> scratch;    // one quantum's timings
+        lab::noodle::QuantumTimingRing ring;
+    };
+
+    explicit QuantumTimingCapture(lab::AudioContext& ac)
+        : AudioNode(ac), misses(256)
+    {
+        initialize();
+    }
+
+    virtual ~QuantumTimingCapture()
+    {
+        for (NodeList* list : _lists)
+            delete list;
+    }
+
+    static const char* static_name() { return "QuantumTimingCapture"; }
+    virtual const char* name() const override { return static_name(); }
+
+    // called by the UI thread
+    void set_nodes(NodeList* list)
+    {
+        // a list that was never adopted was never read, and may be freed here
+        if (NodeList* unread = _pending.exchange(list, std::memory_order_acq_rel))
+            release(unread);
+        _lists.push_back(list);
+    }
+
+    // called by the UI thread. drains the rings of the lists the audio
+    // thread may have written, oldest first, then frees the list it retired
+    void drain(std::vector<lab::noodle::QuantumTiming>& timings)
+    {
+        NodeList* retired = _retired.exchange(nullptr, std::memory_order_acq_rel);
+        for (NodeList* list : _lists)
+            list->ring.drain(timings);
+        if (retired)
+            release(retired);
+    }
+
+    virtual void process(lab::ContextRenderLock& r, int bufferSize) override
+    {
+        lab::noodle::rt_guard::mark_realtime_thread();
+
+        // a new list is adopted only once the UI thread has freed the last
+        // one retired, so that there is always room to retire the current one
+        if (_pending.load(std::memory_order_acquire) && !_retired.load(std::memory_order_acquire))
+        {
+            if (NodeList* next = _pending.exchange(nullptr, std::memory_order_acq_rel))
+            {
+                _retired.store(_active, std::memory_order_release);
+                _active = next;
+            }
+        }
+
+        const uint64_t quantum = _quantum++;
+        if (!_active)
+            return;
+
+        NodeList& list = *_active;
+        size_t count = 0;
+        list.scratch[count++] = { quantum, 0,
+            list.device ? list.device->graphTime.microseconds.count() * 1.e-6f : 0.f };
+        for (auto& n : list.nodes)
+        {
+            // nodes that haven't rendered yet can report a negative self time, hence abs
+            float self = (n.second->totalTime.microseconds.count() - n.second->graphTime.microseconds.count()) * 1.e-6f;
+            list.scratch[count++] = { quantum, n.first, std::abs(self) };
+        }
+
+        if (!list.ring.push(list.scratch.data(), count))
+            dropped.fetch_add(1, std::memory_order_relaxed);
+
+        const auto now = std::chrono::steady_clock::now();
+        const float budget = bufferSize / r.context()->sampleRate();
+        const float interval = _last_quantum.time_since_epoch().count() ?
+            std::chrono::duration<float>(now - _last_quantum).count() : 0.f;
+        _last_quantum = now;
+        budget_seconds.store(budget, std::memory_order_relaxed);
+        quanta.fetch_add(1, std::memory_order_relaxed);
+        render_time.record(static_cast<uint64_t>(list.scratch[0].seconds * 1.e6f));
+        if (interval > 0)
+            intervals.record(static_cast<uint64_t>(interval * 1.e6f));
+
+        // a quantum that began well after the previous one finished
+        // begins a new callback
+        const float idle = interval - list.scratch[0].seconds;
+        bool underrun = false;
+        float callback_interval = 0;
+        if (interval == 0 || idle > budget / 4)
+        {
+            if (_callback_quanta)
+            {
+                callback_interval = std::chrono::duration<float>(now - _callback_start).count();
+                underrun = callback_interval > 2 * _callback_quanta * budget;
+            }
+            _callback_start = now;
+            _callback_quanta = 0;
+        }
+        ++_callback_quanta;
+
+        const bool late = list.scratch[0].seconds > budget;
+        if (late || underrun)
+        {
+            if (late)
+                deadline_misses.fetch_add(1, std::memory_order_relaxed);
+            if (underrun)
+                underruns.fetch_add(1, std::memory_order_relaxed);
+
+            // if the ring is full the miss is still counted, just not reported
+            lab::noodle::DeadlineMiss miss{ quantum, list.scratch[0].seconds, interval, callback_interval, underrun };
+            misses.push(&miss, 1);
+        }
+
+        // LabSound doesn't report when each node ran, so in the trace the
+        // nodes' self times are laid end to end within the quantum, which
+        // ended just before the capture was pulled
+        if (lab::noodle::trace::recording())
+        {
+            lab::noodle::trace::name_thread("audio");
+            const double end = lab::noodle::trace::now();
+            double start = end - list.scratch[0].seconds * 1.e6;
+            lab::noodle::trace::complete("quantum", "audio", start, list.scratch[0].seconds * 1.e6);
+            for (size_t i = 1; i < count; ++i)
+            {
+                lab::noodle::trace::complete_node(list.scratch[i].node, "node", start, list.scratch[i].seconds * 1.e6);
+                start += list.scratch[i].seconds * 1.e6;
+            }
+        }
+    }
+
+    virtual void reset(lab::ContextRenderLock&) override { }
+    virtual double tailTime(lab::ContextRenderLock& r) const override { return 0.; }
+    virtual double latencyTime(lab::ContextRenderLock& r) const override { return 0.; }
+
+    std::atomic<uint64_t> dropped{ 0 };
+
+    lab::noodle::TimingRing<lab::noodle::DeadlineMiss> misses;
+    lab::noodle::DurationHistogram render_time;  // microseconds
+    lab::noodle::DurationHistogram intervals;    // microseconds
+    std::atomic<float> budget_seconds{ 0.f };
+    std::atomic<uint64_t> quanta{ 0 };
+    std::atomic<uint64_t> deadline_misses{ 0 };
+    std::atomic<uint64_t> underruns{ 0 };
+
+private:
+    void release(NodeList* list)
+    {
+        _lists.erase(std::find(_lists.begin(), _lists.end(), list));
+        delete list;
+    }
+
+    std::vector<NodeList*> _lists;              // owned by the UI thread, in the order handed over
+    NodeList* _active = nullptr;                // read by the audio thread
+    std::atomic<NodeList*> _pending{ nullptr }; // handed to the audio thread
+    std::atomic<NodeList*> _retired{ nullptr }; // handed back to the UI thread
+    uint64_t _quantum = 0;
+    std::chrono::steady_clock::time_point _last_quantum;
+    std::chrono::steady_clock::time_point _callback_start; // when the current callback's first quantum was captured
+    uint32_t _callback_quanta = 0;                         // quanta rendered in the current callback
+};
+
+LabSoundProvider::LabSoundProvider() = default;
+
+LabSoundProvider::LabSoundProvider(const lab::noodle::AudioDeviceSettings& settings)
+    : _device_settings(settings)
+{
+}
+
+LabSoundProvider::LabSoundProvider(std::unique_ptr<lab::AudioContext> context)
+    : _audio_context(std::move(context))
+{
+}
+
+LabSoundProvider::LabSoundProvider(ContextFactory open_context, DeviceTapFactory create_device_tap)
+    : _open_context(std::move(open_context)), _create_device_tap(std::move(create_device_tap))
+{
+}
+
+LabSoundProvider::~LabSoundProvider()
+{
+    // nodes must be released before the context that renders them,
+    // including those captured by the editor's render functions
+    clear_records();
+    _audioPins.clear();
+    _audioNodes.clear();
+    _device_tap.reset();
+    _timing_capture.reset();
+    _audio_context.reset();
+}
+
 static constexpr float node_border_radius = 4.f;
 void DrawSpectrum(std::shared_ptr<lab::AudioNode> audio_node, ImVec2 ul_ws, ImVec2 lr_ws, float scale, ImDrawList* drawList)
 {
@@ -82,24 +352,25 @@ void LabSoundProvider::create_noodle_data_for_node(
     std::shared_ptr<lab::AudioNode> audio_node, 
     lab::noodle::NoodleNode *const node)
 {
+    LAB_TIME_SCOPE("create_noodle_data_for_node", "provider");
     if (!audio_node || !node)
         return;
 
     // prep the reverse table if necessary
-    auto reverse_it = g_node_reverse_lookups.find(node->id);
-    if (reverse_it == g_node_reverse_lookups.end())
+    auto reverse_it = _node_reverse_lookups.find(node->id);
+    if (reverse_it == _node_reverse_lookups.end())
     {
-        g_node_reverse_lookups[node->id] = NodeReverseLookup{};
-        reverse_it = g_node_reverse_lookups.find(node->id);
+        _node_reverse_lookups[node->id] = NodeReverseLookup{};
+        reverse_it = _node_reverse_lookups.find(node->id);
     }
     auto& reverse = reverse_it->second;
 
     //---------- custom renderers
 
-    lab::ContextRenderLock r(g_audio_context.get(), "LabSoundGraphToy_init");
+    lab::ContextRenderLock r(_audio_context.get(), "LabSoundGraphToy_init");
     if (nullptr != dynamic_cast<lab::AnalyserNode*>(audio_node.get()))
     {
-        g_audio_context->addAutomaticPullNode(audio_node);
+        _audio_context->addAutomaticPullNode(audio_node);
         node->render =
             lab::noodle::NodeRender{
                 [audio_node](ln_Node id, lab::noodle::vec2 ul_ws, lab::noodle::vec2 lr_ws, float scale, void* drawList) {
@@ -175,7 +446,7 @@ void LabSoundProvider::create_noodle_data_for_node(
         else if (type == lab::AudioSetting::Type::Bool)
         {
             dataType = lab::noodle::NoodlePin::DataType::Bool;
-            sprintf(buff, "%s", settings[i]->valueBool() ? "1" : "0");
+            sprintf(buff, "%s", settings[i]->valueBool() ? "True" : "False");
         }
         else if (type == lab::AudioSetting::Type::Enumeration)
         {
@@ -236,6 +507,7 @@ void LabSoundProvider::create_noodle_data_for_node(
 void LabSoundProvider::pin_set_setting_bus_value(
     const std::string& node_name, const std::string& setting_name, const std::string& path)
 {
+    LAB_TIME_SCOPE("pin_set_setting_bus_value", "provider");
     ln_Node node = entity_for_node_named(node_name);
     if (!node.valid)
         return;
@@ -260,6 +532,7 @@ void LabSoundProvider::pin_set_setting_bus_value(
 // override
 void LabSoundProvider::pin_set_bus_from_file(ln_Pin pin_id, const std::string& path)
 {
+    LAB_TIME_SCOPE("pin_set_bus_from_file", "provider");
     if (!pin_id.valid || !path.length())
         return;
 
@@ -280,9 +553,86 @@ void LabSoundProvider::pin_set_bus_from_file(ln_Pin pin_id, const std::string& p
     }
 }
 
+// override
+bool LabSoundProvider::pin_bus_value(ln_Pin pin_id, lab::noodle::BusData& result)
+{
+    LAB_TIME_SCOPE("pin_bus_value", "provider");
+    if (!pin_id.valid)
+        return false;
+
+    auto a_pin_it = _audioPins.find(pin_id);
+    if (a_pin_it == _audioPins.end())
+        return false;
+
+    LabSoundPinData& a_pin = a_pin_it->second;
+    if (!a_pin.setting)
+        return false;
+
+    std::shared_ptr<lab::AudioBus> bus = a_pin.setting->valueBus();
+    if (!bus)
+        return false;
+
+    result.channels = bus->numberOfChannels();
+    result.frames = bus->length();
+    result.sample_rate = bus->sampleRate();
+    result.samples.resize(static_cast<size_t>(result.channels) * result.frames);
+    for (int i = 0; i < result.channels; ++i)
+        memcpy(&result.samples[static_cast<size_t>(i) * result.frames], bus->channel(i)->data(), sizeof(float) * result.frames);
+
+    return true;
+}
+
+// override
+void LabSoundProvider::pin_set_setting_bus_samples(
+    const std::string& node_name, const std::string& setting_name, const lab::noodle::BundleSample& sample)
+{
+    LAB_TIME_SCOPE("pin_set_setting_bus_samples", "provider");
+    ln_Node node = entity_for_node_named(node_name);
+    if (!node.valid || !sample.samples || sample.channels <= 0)
+        return;
+
+    auto n_it = _audioNodes.find(node);
+    if (n_it == _audioNodes.end())
+        return;
+
+    std::shared_ptr<lab::AudioNode> n = n_it->second.node;
+    if (!n)
+        return;
+
+    auto s = n->setting(setting_name.c_str());
+    if (!s)
+        return;
+
+    // the bus refers to the bundle's storage rather than owning a copy of it,
+    // and its deleter holds the bundle open for as long as the bus is alive.
+    // A SampledAudioNode shares the bus, and so plays from the bundle; any
+    // other node's setting takes a raw pointer, and copies the samples before
+    // the bus, and with it the bundle, are released on return.
+    std::shared_ptr<const void> owner = sample.owner;
+    std::shared_ptr<lab::AudioBus> bus(new lab::AudioBus(sample.channels, sample.frames, false),
+        [owner](lab::AudioBus* b) { delete b; });
+    for (int i = 0; i < sample.channels; ++i)
+        bus->setChannelMemory(i, const_cast<float*>(sample.samples) + static_cast<size_t>(i) * sample.frames, sample.frames);
+    bus->setSampleRate(sample.sample_rate);
+
+    lab::SampledAudioNode* san = dynamic_cast<lab::SampledAudioNode*>(n.get());
+    if (san)
+    {
+        lab::ContextRenderLock r(_audio_context.get(), "pin_set_setting_bus_samples");
+        san->setBus(r, bus);
+    }
+    else
+    {
+        // copies, as pin_set_bus_from_file's setBus does
+        s->setBus(bus.get());
+    }
+    printf("SetBusSetting %s %s from bundle\n", node_name.c_str(), setting_name.c_str());
+}
+
 // override
 void LabSoundProvider::connect_bus_out_to_bus_in(ln_Node output_node_id, ln_Pin output_pin_id, ln_Node input_node_id)
 {
+    LAB_TIME_SCOPE("connect_bus_out_to_bus_in", "provider");
     if (!output_node_id.valid || !output_pin_id.valid || !input_node_id.valid)
         return;
 
@@ -298,13 +648,16 @@ void LabSoundProvider::connect_bus_out_to_bus_in(ln_Node output_node_id, ln_Pin
     if (!in || !out)
         return;
 
-    g_audio_context->connect(in, out, 0, 0);
+    _audio_context->connect(in, out, 0, 0);
+    if (_device_tap && in == _audio_context->device())
+        _audio_context->connect(_device_tap, out, 0, 0);
     printf("ConnectBusOutToBusIn %lld %lld\n", input_node_id.id, output_node_id.id);
 }
 
 // override
 void LabSoundProvider::connect_bus_out_to_param_in(ln_Node output_node_id, ln_Pin output_pin_id, ln_Pin param_pin_id)
 {
+    LAB_TIME_SCOPE("connect_bus_out_to_param_in", "provider");
     if (!output_node_id.valid || !output_pin_id.valid || !param_pin_id.valid)
         return;
     
@@ -332,13 +685,14 @@ void LabSoundProvider::connect_bus_out_to_param_in(ln_Node output_node_id, ln_Pi
     }
 
     LabSoundPinData& param_pin = param_pin_it->second;
-    g_audio_context->connectParam(param_pin.param, out, output_index);
+    _audio_context->connectParam(param_pin.param, out, output_index);
     printf("ConnectBusOutToParamIn %lld %lld, index %d\n", param_pin_id.id, output_node_id.id, output_index);
 }
 
 // override
 void LabSoundProvider::disconnect(ln_Connection connection_id_)
 {
+    LAB_TIME_SCOPE("disconnect", "provider");
     lab::noodle::NoodleConnection const* const conn = find_connection(connection_id_);
     if (!conn)
         return;
@@ -376,12 +730,14 @@ void LabSoundProvider::disconnect(ln_Connection connection_id_)
 
             if ((in_pin->kind == lab::noodle::NoodlePin::Kind::BusIn) && (out_pin->kind == lab::noodle::NoodlePin::Kind::BusOut))
             {
-                g_audio_context->disconnect(input_node, output_node, 0, 0);
+                _audio_context->disconnect(input_node, output_node, 0, 0);
+                if (_device_tap && input_node == _audio_context->device())
+                    _audio_context->disconnect(_device_tap, output_node, 0, 0);
                 printf("DisconnectInFromOut (bus from bus) %lld %lld\n", input_node_id.id, output_node_id.id);
             }
             else if ((in_pin->kind == lab::noodle::NoodlePin::Kind::Param) && (out_pin->kind == lab::noodle::NoodlePin::Kind::BusOut))
             {
-                g_audio_context->disconnectParam(a_in_pin.param, output_node, 0);
+                _audio_context->disconnectParam(a_in_pin.param, output_node, 0);
                 printf("DisconnectInFromOut (param from bus) %lld %lld\n", input_node_id.id, output_node_id.id);
             }
         }
@@ -392,12 +748,37 @@ void LabSoundProvider::disconnect(ln_Connection connection_id_)
 // override
 ln_Context LabSoundProvider::create_runtime_context(ln_Node id)
 {
-    const auto defaultAudioDeviceConfigurations = GetDefaultAudioDeviceConfiguration(true);
+    LAB_TIME_SCOPE("create_runtime_context", "provider");
+    if (!_audio_context)
+    {
+        if (_open_context)
+            _audio_context = _open_context(_device_settings);
+        else
+        {
+            const auto configurations = AudioDeviceConfiguration(_device_settings);
+            _audio_context = lab::MakeRealtimeAudioContext(configurations.second, configurations.first);
+        }
+        _owns_device = true;
 
-    if (!g_audio_context)
-        g_audio_context = lab::MakeRealtimeAudioContext(defaultAudioDeviceConfigurations.second, defaultAudioDeviceConfigurations.first);
+        if (_create_device_tap)
+        {
+            _device_tap = _create_device_tap(*_audio_context.get());
+            _audio_context->addAutomaticPullNode(_device_tap);
+        }
+    }
 
-    _audioNodes[id] = LabSoundNodeData{ g_audio_context->device() };
+    if (!_timing_capture)
+    {
+        _timing_capture = std::make_shared<QuantumTimingCapture>(*_audio_context.get());
+        _audio_context->addAutomaticPullNode(_timing_capture);
+
+        // the render lock is taken every quantum, see lab_rt_guard.h
+        lab::noodle::rt_guard::AllowLocks allow;
+        lab::ContextRenderLock r(_audio_context.get(), "create_runtime_context");
+    }
+    _timing_nodes_changed = true;
+
+    _audioNodes[id] = LabSoundNodeData{ _audio_context->device() };
 
     lab::noodle::NoodleNode * const node = find_node(id);
     if (!node) {
@@ -405,14 +786,179 @@ ln_Context LabSoundProvider::create_runtime_context(ln_Node id)
         return ln_Context_null();
     }
 
-    create_noodle_data_for_node(g_audio_context->device(), node);
+    create_noodle_data_for_node(_audio_context->device(), node);
     printf("CreateRuntimeContext %lld\n", id.id);
     return ln_Context{id.id};
 }
 
+// override
+void LabSoundProvider::set_device_settings(const lab::noodle::AudioDeviceSettings& settings)
+{
+    LAB_TIME_SCOPE("set_device_settings", "provider");
+    _device_settings = settings;
+    if (!_owns_device || !_audio_context)
+        return;
+
+    // nodes must be released before the context that renders them. The next
+    // create_runtime_context opens the devices again, with the new settings.
+    _audioPins.clear();
+    _audioNodes.clear();
+    _node_reverse_lookups.clear();
+    _osc_node = ln_Node_null();
+    _device_tap.reset();
+    _timing_capture.reset();
+    _audio_context.reset();
+    _owns_device = false;
+}
+
+// override
+std::vector<lab::noodle::AudioDeviceDescription> LabSoundProvider::audio_devices()
+{
+    std::vector<lab::noodle::AudioDeviceDescription> result;
+    for (const lab::AudioDeviceInfo& info : lab::MakeAudioDeviceList())
+    {
+        lab::noodle::AudioDeviceDescription d;
+        d.name = info.identifier;
+        d.input_channels = info.num_input_channels;
+        d.output_channels = info.num_output_channels;
+        d.sample_rates = info.supported_samplerates;
+        d.nominal_sample_rate = info.nominal_samplerate;
+        d.default_input = info.is_default_input;
+        d.default_output = info.is_default_output;
+        result.emplace_back(std::move(d));
+    }
+    return result;
+}
+
+// override
+float LabSoundProvider::context_sample_rate()
+{
+    return _audio_context ? _audio_context->sampleRate() : 0.f;
+}
+
+// override
+void LabSoundProvider::drain_quantum_timings(std::vector<lab::noodle::QuantumTiming>& timings, uint64_t& dropped)
+{
+    LAB_TIME_SCOPE("drain_quantum_timings", "provider");
+    dropped = 0;
+    if (!_timing_capture)
+        return;
+
+    if (_timing_nodes_changed)
+    {
+        _timing_nodes_changed = false;
+
+        // nodes that were deleted keep their audio data, but not their noodle node
+        QuantumTimingCapture::NodeList::Nodes nodes;
+        std::shared_ptr<lab::AudioNode> device;
+        for (auto& i : _audioNodes)
+        {
+            if (!i.second.node || !find_node(i.first))
+                continue;
+            if (i.second.node.get() == _audio_context->device().get())
+                device = i.second.node;
+            else
+                nodes.push_back({ i.first.id, i.second.node });
+            lab::noodle::trace::name_node(i.first.id, find_node(i.first)->name);
+        }
+        _timing_capture->set_nodes(new QuantumTimingCapture::NodeList(std::move(nodes), std::move(device)));
+    }
+
+    _timing_capture->drain(timings);
+    dropped = _timing_capture->dropped.exchange(0, std::memory_order_relaxed);
+}
+
+// override
+bool LabSoundProvider::deadline_statistics(lab::noodle::DeadlineStatistics& statistics)
+{
+    if (!_timing_capture)
+        return false;
+
+    statistics.budget_seconds = _timing_capture->budget_seconds.load(std::memory_order_relaxed);
+    statistics.quanta = _timing_capture->quanta.load(std::memory_order_relaxed);
+    statistics.misses = _timing_capture->deadline_misses.load(std::memory_order_relaxed);
+    statistics.underruns = _timing_capture->underruns.load(std::memory_order_relaxed);
+    statistics.render_time = &_timing_capture->render_time;
+    statistics.interval = &_timing_capture->intervals;
+    return true;
+}
+
+// override
+void LabSoundProvider::drain_deadline_misses(std::vector<lab::noodle::DeadlineMiss>& misses)
+{
+    if (_timing_capture)
+        _timing_capture->misses.drain(misses);
+}
+
+// override
+void LabSoundProvider::reset_deadline_statistics()
+{
+    if (!_timing_capture || !_audio_context)
+        return;
+
+    // the histograms can't be cleared while the audio thread records into them
+    lab::ContextRenderLock r(_audio_context.get(), "reset_deadline_statistics");
+    _timing_capture->render_time.reset();
+    _timing_capture->intervals.reset();
+    _timing_capture->quanta = 0;
+    _timing_capture->deadline_misses = 0;
+    _timing_capture->underruns = 0;
+}
+
+// override
+void LabSoundProvider::memory_report(lab::noodle::MemoryReport& report)
+{
+    LAB_TIME_SCOPE("memory_report", "provider");
+    Provider::memory_report(report);
+
+    // the provider's own records of each node and its pins
+    auto entry = [](auto& m) { return sizeof(typename std::decay<decltype(m)>::type::value_type) + 4 * sizeof(void*); };
+    for (auto& n : report.nodes)
+    {
+        ln_Node node_id{ n.first, true };
+        size_t bytes = 0;
+        if (_audioNodes.count(node_id))
+            bytes += entry(_audioNodes);
+        auto reverse_it = _node_reverse_lookups.find(node_id);
+        if (reverse_it != _node_reverse_lookups.end())
+        {
+            const NodeReverseLookup& reverse = reverse_it->second;
+            bytes += entry(_node_reverse_lookups);
+            bytes += (reverse.input_pin_map.size() + reverse.output_pin_map.size() + reverse.param_pin_map.size())
+                * entry(reverse.input_pin_map);
+        }
+        if (lab::noodle::NoodleNode* node = find_node(node_id))
+            for (const ln_Pin& pin : node->pins)
+                if (_audioPins.count(pin))
+                    bytes += entry(_audioPins);
+
+        n.second.bookkeeping += bytes;
+        report.bookkeeping += bytes;
+    }
+
+    if (!_audio_context)
+        return;
+
+    // deleted nodes keep their audio data, so it counts towards the total,
+    // though not towards any node
+    lab::ContextRenderLock r(_audio_context.get(), "memory_report");
+    for (auto& i : _audioNodes)
+    {
+        if (!i.second.node)
+            continue;
+
+        size_t bytes = lab::noodle::node_audio_bytes(r, *i.second.node);
+        auto it = report.nodes.find(i.first.id);
+        if (it != report.nodes.end())
+            it->second.audio = bytes;
+        report.audio += bytes;
+    }
+}
+
 // override
 void LabSoundProvider::node_start_stop(ln_Node node_id, float when)
 {
+    LAB_TIME_SCOPE("node_start_stop", "provider");
     if (node_id.id == ln_Node_null().id)
         return;
 
@@ -449,6 +995,7 @@ void LabSoundProvider::node_start_stop(ln_Node node_id, float when)
 // override
 void LabSoundProvider::node_bang(ln_Node node_id)
 {
+    LAB_TIME_SCOPE("node_bang", "provider");
     if (node_id.id == ln_Node_null().id)
         return;
 
@@ -463,8 +1010,8 @@ void LabSoundProvider::node_bang(ln_Node node_id)
     shared_ptr<lab::AudioParam> gate = in_node->param("gate");
     if (gate)
     {
-        gate->setValueAtTime(1.f, static_cast<float>(g_audio_context->currentTime()) + 0.f);
-        gate->setValueAtTime(0.f, static_cast<float>(g_audio_context->currentTime()) + 1.f);
+        gate->setValueAtTime(1.f, static_cast<float>(_audio_context->currentTime()) + 0.f);
+        gate->setValueAtTime(0.f, static_cast<float>(_audio_context->currentTime()) + 1.f);
     }
 
     printf("Bang %lld\n", node_id.id);
@@ -484,8 +1031,8 @@ ln_Pin LabSoundProvider::node_output_named(ln_Node node_id, const std::string& o
     if (!node)
         return ln_Pin_null();
 
-    auto reverse_it = g_node_reverse_lookups.find(node_id);
-    if (reverse_it == g_node_reverse_lookups.end())
+    auto reverse_it = _node_reverse_lookups.find(node_id);
+    if (reverse_it == _node_reverse_lookups.end())
         return ln_Pin_null();
 
     auto& reverse = reverse_it->second;
@@ -514,8 +1061,8 @@ ln_Pin LabSoundProvider::node_input_with_index(ln_Node node_id, int output)
     if (!node)
         return ln_Pin_null();
 
-    auto reverse_it = g_node_reverse_lookups.find(node_id);
-    if (reverse_it == g_node_reverse_lookups.end())
+    auto reverse_it = _node_reverse_lookups.find(node_id);
+    if (reverse_it == _node_reverse_lookups.end())
         return ln_Pin_null();
 
     auto& reverse = reverse_it->second;
@@ -544,8 +1091,8 @@ ln_Pin LabSoundProvider::node_output_with_index(ln_Node node_id, int output)
     if (!node)
         return ln_Pin_null();
 
-    auto reverse_it = g_node_reverse_lookups.find(node_id);
-    if (reverse_it == g_node_reverse_lookups.end())
+    auto reverse_it = _node_reverse_lookups.find(node_id);
+    if (reverse_it == _node_reverse_lookups.end())
         return ln_Pin_null();
 
     auto& reverse = reverse_it->second;
@@ -574,8 +1121,8 @@ ln_Pin LabSoundProvider::node_param_named(ln_Node node_id, const std::string& ou
     if (!node)
         return ln_Pin_null();
 
-    auto reverse_it = g_node_reverse_lookups.find(node_id);
-    if (reverse_it == g_node_reverse_lookups.end())
+    auto reverse_it = _node_reverse_lookups.find(node_id);
+    if (reverse_it == _node_reverse_lookups.end())
         return ln_Pin_null();
 
     auto& reverse = reverse_it->second;
@@ -593,15 +1140,17 @@ ln_Pin LabSoundProvider::node_param_named(ln_Node node_id, const std::string& ou
 // override
 ln_Node LabSoundProvider::node_create(const std::string& kind, ln_Node id)
 {
+    LAB_TIME_SCOPE("node_create", "provider");
     if (kind == "OSC")
     {
-        shared_ptr<OSCNode> n = std::make_shared<OSCNode>(*g_audio_context.get());
+        shared_ptr<OSCNode> n = std::make_shared<OSCNode>(*_audio_context.get());
         _audioNodes[id] = LabSoundNodeData{ n };
         _osc_node = id;
+        _timing_nodes_changed = true;
         return id;
     }
 
-    shared_ptr<lab::AudioNode> n = NodeFactory(kind);
+    shared_ptr<lab::AudioNode> n = NodeFactory(*_audio_context.get(), kind);
     if (n)
     {
         lab::noodle::NoodleNode * const node = find_node(id);
@@ -610,7 +1159,19 @@ ln_Node LabSoundProvider::node_create(const std::string& kind, ln_Node id)
             node->bang_controller = !!n->param("gate");
             _audioNodes[id] = LabSoundNodeData{ n };
             create_noodle_data_for_node(n, node);
+            _timing_nodes_changed = true;
             printf("CreateNode [%s] %lld\n", kind.c_str(), id.id);
+
+            // the probe listens to the device's input, which isn't otherwise part of the graph
+            if (auto probe = std::dynamic_pointer_cast<LatencyProbeNode>(n))
+            {
+                lab::ContextRenderLock r(_audio_context.get(), "LatencyProbe");
+                probe->hardware_input = lab::MakeAudioHardwareInputNode(r);
+                if (probe->hardware_input)
+                    _audio_context->connect(probe, probe->hardware_input, 0, 0);
+                else
+                    printf("LatencyProbe [%lld] has no device input to listen to\n", id.id);
+            }
         }
     }
     else
@@ -624,17 +1185,19 @@ ln_Node LabSoundProvider::node_create(const std::string& kind, ln_Node id)
 // override
 void LabSoundProvider::node_delete(ln_Node node_id)
 {
+    LAB_TIME_SCOPE("node_delete", "provider");
     if (node_id.id == ln_Node_null().id)
         return;
 
     printf("DeleteNode %lld\n", node_id.id);
+    _timing_nodes_changed = true;
 
     // force full disconnection
     auto it = _audioNodes.find(node_id);
     if (it != _audioNodes.end())
     {
         shared_ptr<lab::AudioNode> in_node = it->second.node;
-        g_audio_context->disconnect(in_node);
+        _audio_context->disconnect(in_node);
     }
 
     for (auto i = _audioPins.begin(), last = _audioPins.end(); i != last; ) {
@@ -646,9 +1209,9 @@ void LabSoundProvider::node_delete(ln_Node node_id)
         }
     }
 
-    auto reverse_it = g_node_reverse_lookups.find(node_id);
-    if (reverse_it != g_node_reverse_lookups.end())
-        g_node_reverse_lookups.erase(reverse_it);
+    auto reverse_it = _node_reverse_lookups.find(node_id);
+    if (reverse_it != _node_reverse_lookups.end())
+        _node_reverse_lookups.erase(reverse_it);
 }
 
 // override
@@ -670,6 +1233,7 @@ char const* const* LabSoundProvider::node_names() const
 // override
 void LabSoundProvider::pin_set_param_value(const std::string& node_name, const std::string& param_name, float v)
 {
+    LAB_TIME_SCOPE("pin_set_param_value", "provider");
     ln_Node node = entity_for_node_named(node_name);
     if (!node.valid)
         return;
@@ -690,6 +1254,7 @@ void LabSoundProvider::pin_set_param_value(const std::string& node_name, const s
 // override
 void LabSoundProvider::pin_set_setting_float_value(const std::string& node_name, const std::string& setting_name, float v)
 {
+    LAB_TIME_SCOPE("pin_set_setting_float_value", "provider");
     ln_Node node = entity_for_node_named(node_name);
     if (!node.valid)
         return;
@@ -710,6 +1275,7 @@ void LabSoundProvider::pin_set_setting_float_value(const std::string& node_name,
 // override
 void LabSoundProvider::pin_set_float_value(ln_Pin pin, float v)
 {
+    LAB_TIME_SCOPE("pin_set_float_value", "provider");
     if (!pin.valid)
         return;
     
@@ -752,6 +1318,7 @@ float LabSoundProvider::pin_float_value(ln_Pin pin)
 // override
 void LabSoundProvider::pin_set_setting_int_value(const std::string& node_name, const std::string& setting_name, int v)
 {
+    LAB_TIME_SCOPE("pin_set_setting_int_value", "provider");
     ln_Node node = entity_for_node_named(node_name);
     if (!node.valid)
         return;
@@ -772,6 +1339,7 @@ void LabSoundProvider::pin_set_setting_int_value(const std::string& node_name, c
 // override
 void LabSoundProvider::pin_set_int_value(ln_Pin pin, int v)
 {
+    LAB_TIME_SCOPE("pin_set_int_value", "provider");
     if (!pin.valid)
         return;
 
@@ -814,6 +1382,7 @@ int LabSoundProvider::pin_int_value(ln_Pin pin)
 // override
 void LabSoundProvider::pin_set_enumeration_value(ln_Pin pin, const std::string& value)
 {
+    LAB_TIME_SCOPE("pin_set_enumeration_value", "provider");
     if (!pin.valid)
         return;
 
@@ -836,6 +1405,7 @@ void LabSoundProvider::pin_set_enumeration_value(ln_Pin pin, const std::string&
 // override
 void LabSoundProvider::pin_set_setting_enumeration_value(const std::string& node_name, const std::string& setting_name, const std::string& value)
 {
+    LAB_TIME_SCOPE("pin_set_setting_enumeration_value", "provider");
     ln_Node node = entity_for_node_named(node_name);
     if (!node.valid)
         return;
@@ -863,6 +1433,7 @@ void LabSoundProvider::pin_set_setting_enumeration_value(const std::string& node
 // override
 void LabSoundProvider::pin_set_setting_bool_value(const std::string& node_name, const std::string& setting_name, bool v)
 {
+    LAB_TIME_SCOPE("pin_set_setting_bool_value", "provider");
     ln_Node node = entity_for_node_named(node_name);
     if (!node.valid)
         return;
@@ -883,6 +1454,7 @@ void LabSoundProvider::pin_set_setting_bool_value(const std::string& node_name,
 // override
 void LabSoundProvider::pin_set_bool_value(ln_Pin pin, bool v)
 {
+    LAB_TIME_SCOPE("pin_set_bool_value", "provider");
     if (!pin.valid)
         return;
 
@@ -925,6 +1497,7 @@ bool LabSoundProvider::pin_bool_value(ln_Pin pin)
 // override
 void LabSoundProvider::pin_create_output(const std::string& node_name, const std::string& output_name, int channels)
 {
+    LAB_TIME_SCOPE("pin_create_output", "provider");
     ln_Node node_e = entity_for_node_named(node_name);
     if (!node_e.valid)
         return;
@@ -939,11 +1512,11 @@ void LabSoundProvider::pin_create_output(const std::string& node_name, const std
 
     if (!n->output(output_name.c_str()))
     {
-        auto reverse_it = g_node_reverse_lookups.find(node_e);
-        if (reverse_it == g_node_reverse_lookups.end())
+        auto reverse_it = _node_reverse_lookups.find(node_e);
+        if (reverse_it == _node_reverse_lookups.end())
         {
-            g_node_reverse_lookups[node_e] = NodeReverseLookup{};
-            reverse_it = g_node_reverse_lookups.find(node_e);
+            _node_reverse_lookups[node_e] = NodeReverseLookup{};
+            reverse_it = _node_reverse_lookups.find(node_e);
         }
         auto& reverse = reverse_it->second;
 
@@ -968,7 +1541,7 @@ void LabSoundProvider::pin_create_output(const std::string& node_name, const std
  
         _audioPins[pin_id] = LabSoundPinData{ n->numberOfOutputs() - 1, node_e };
 
-        lab::ContextGraphLock glock(g_audio_context.get(), "AudioHardwareDeviceNode");
+        lab::ContextGraphLock glock(_audio_context.get(), "AudioHardwareDeviceNode");
         n->addOutput(glock, std::unique_ptr<lab::AudioNodeOutput>(new lab::AudioNodeOutput(n.get(), output_name.c_str(), channels)));
     }
 }
@@ -1001,7 +1574,7 @@ float LabSoundProvider::node_get_self_timing(ln_Node node)
     return (n->totalTime.microseconds.count() - n->graphTime.microseconds.count()) * 1.e-6f;
 }
 
-void LabSoundProvider::add_osc_addr(char const* const addr, int addr_id, int channels, float* data)
+void LabSoundProvider::add_osc_addr(char const* const addr, int addr_id, int channels, float* data, int64_t arrival)
 {
     if (_osc_node.id == ln_Node_null().id)
         return;
@@ -1014,7 +1587,7 @@ void LabSoundProvider::add_osc_addr(char const* const addr, int addr_id, int cha
     if (!n)
         return;
 
-    if (!n->addAddress(addr, addr_id, channels, data))
+    if (!n->addAddress(addr, addr_id, channels, data, arrival))
         return;
 
     auto it = n->key_to_addrData.find(addr_id);
@@ -1038,3 +1611,38 @@ void LabSoundProvider::add_osc_addr(char const* const addr, int addr_id, int cha
         _audioPins[pin_id] = LabSoundPinData{ it->second.output_index, _osc_node };
     }
 }
+
+LabSoundProvider::LatencyReport LabSoundProvider::latency_report()
+{
+    LatencyReport report;
+    for (auto& i : _audioNodes)
+    {
+        if (!report.has_probe)
+        {
+            if (auto probe = dynamic_cast<LatencyProbeNode*>(i.second.node.get()))
+            {
+                report.has_probe = true;
+                report.round_trip_count = probe->round_trip.count.load();
+                report.round_trip_timeouts = probe->timeouts.load();
+                report.round_trip_last = probe->round_trip.last.load();
+                report.round_trip_min = probe->round_trip.min.load();
+                report.round_trip_mean = probe->round_trip.mean();
+                report.round_trip_max = probe->round_trip.max.load();
+            }
+        }
+    }
+
+    auto osc_it = _audioNodes.find(_osc_node);
+    if (osc_it != _audioNodes.end())
+    {
+        if (auto osc = dynamic_cast<OSCNode*>(osc_it->second.node.get()))
+        {
+            report.control_count = osc->control_latency.count.load();
+            report.control_last = osc->control_latency.last.load();
+            report.control_min = osc->control_latency.min.load();
+            report.control_mean = osc->control_latency.mean();
+            report.control_max = osc->control_latency.max.load();
+        }
+    }
+    return report;
+}
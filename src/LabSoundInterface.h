@@ -8,12 +8,13 @@
 
 #include "lab_noodle.h"
 
+#include <functional>
 #include <map>
 #include <memory>
 #include <string>
 #include <vector>
 
-namespace lab { class AudioNode; class AudioParam; class AudioSetting; }
+namespace lab { class AudioContext; class AudioNode; class AudioParam; class AudioSetting; }
 
 
 
@@ -33,17 +34,71 @@ struct LabSoundNodeData
     std::shared_ptr<lab::AudioNode> node;
 };
 
+struct NodeReverseLookup
+{
+    std::map<std::string, ln_Pin> input_pin_map;
+    std::map<std::string, ln_Pin> output_pin_map;
+    std::map<std::string, ln_Pin> param_pin_map;
+};
+
+
+struct QuantumTimingCapture;
 
 class LabSoundProvider final : public lab::noodle::Provider
 {
     std::map<ln_Pin, LabSoundPinData, cmp_ln_Pin> _audioPins;
     std::map<ln_Node, LabSoundNodeData, cmp_ln_Node> _audioNodes;
+    std::map<ln_Node, NodeReverseLookup, cmp_ln_Node> _node_reverse_lookups;
+    std::unique_ptr<lab::AudioContext> _audio_context;
+    lab::noodle::AudioDeviceSettings _device_settings;
+    bool _owns_device = false;  // the context was opened from _device_settings
 
 public:
-    virtual ~LabSoundProvider() override = default;
+    // opens a context for the device settings, in place of the audio devices
+    using ContextFactory = std::function<std::unique_ptr<lab::AudioContext>(const lab::noodle::AudioDeviceSettings&)>;
+
+    // creates a node, on each context opened, that receives everything
+    // connected to the Device node. The context pulls it every quantum.
+    using DeviceTapFactory = std::function<std::shared_ptr<lab::AudioNode>(lab::AudioContext&)>;
+
+private:
+    ContextFactory _open_context;
+    DeviceTapFactory _create_device_tap;
+    std::shared_ptr<lab::AudioNode> _device_tap;
+
+    // pulled by the context once per quantum, after the graph has rendered
+    std::shared_ptr<QuantumTimingCapture> _timing_capture;
+    bool _timing_nodes_changed = true;
+
+public:
+    // by default, create_runtime_context opens the audio devices named by
+    // the device settings, which default to the system's default devices.
+    // A provider may instead be given a context, such as an offline context,
+    // to run, or a factory that opens one from the device settings, such as
+    // those of a loaded patch. Each provider is independent, so several may
+    // exist at once.
+    LabSoundProvider();
+    explicit LabSoundProvider(const lab::noodle::AudioDeviceSettings& settings);
+    explicit LabSoundProvider(std::unique_ptr<lab::AudioContext> context);
+    explicit LabSoundProvider(ContextFactory open_context, DeviceTapFactory create_device_tap = {});
+    virtual ~LabSoundProvider() override;
+
+    lab::AudioContext* audio_context() const { return _audio_context.get(); }
+    std::shared_ptr<lab::AudioNode> device_tap() const { return _device_tap; }
 
     virtual ln_Context create_runtime_context(ln_Node id) override;
 
+    // a context given to the constructor is not reopened, only those the provider opened itself
+    virtual void set_device_settings(const lab::noodle::AudioDeviceSettings& settings) override;
+    virtual lab::noodle::AudioDeviceSettings device_settings() const override { return _device_settings; }
+    virtual std::vector<lab::noodle::AudioDeviceDescription> audio_devices() override;
+    virtual float context_sample_rate() override;
+    virtual void drain_quantum_timings(std::vector<lab::noodle::QuantumTiming>& timings, uint64_t& dropped) override;
+    virtual bool deadline_statistics(lab::noodle::DeadlineStatistics& statistics) override;
+    virtual void drain_deadline_misses(std::vector<lab::noodle::DeadlineMiss>& misses) override;
+    virtual void reset_deadline_statistics() override;
+    virtual void memory_report(lab::noodle::MemoryReport& report) override;
+
     // node creation and deletion
     virtual char const* const* node_names() const override;
     virtual ln_Node node_create(const std::string& name, ln_Node id) override;
@@ -75,6 +130,8 @@ public:
     virtual void  pin_set_bus_from_file(ln_Pin pin, const std::string& path) override;
     virtual void  pin_set_enumeration_value(ln_Pin pin, const std::string& value) override;
     virtual void  pin_set_setting_enumeration_value(const std::string& node_name, const std::string& setting_name, const std::string& value) override;
+    virtual bool  pin_bus_value(ln_Pin pin, lab::noodle::BusData& result) override;
+    virtual void  pin_set_setting_bus_samples(const std::string& node_name, const std::string& setting_name, const lab::noodle::BundleSample& sample) override;
 
     // string based interfaces
     virtual void pin_create_output(const std::string& node_name, const std::string& output_name, int channels) override;
@@ -84,7 +141,20 @@ public:
     virtual void connect_bus_out_to_param_in(ln_Node output_node_id, ln_Pin output_pin_id, ln_Pin pin_id) override;
     virtual void disconnect(ln_Connection connection_id) override;
 
-    void add_osc_addr(char const* const addr, int addr_id, int channels, float* data);
+    // arrival is when the message reached the OSC server, as for OSCNode::pending_arrival
+    void add_osc_addr(char const* const addr, int addr_id, int channels, float* data, int64_t arrival = 0);
+
+    // latencies measured by the first LatencyProbe in the graph, and by the
+    // OSC node, in seconds. Statistics with no samples have a count of zero.
+    struct LatencyReport
+    {
+        bool has_probe = false;
+        int round_trip_count = 0, round_trip_timeouts = 0;
+        float round_trip_last = 0, round_trip_min = 0, round_trip_mean = 0, round_trip_max = 0;
+        int control_count = 0;
+        float control_last = 0, control_min = 0, control_mean = 0, control_max = 0;
+    };
+    LatencyReport latency_report();
 
 private:
     void create_noodle_data_for_node(std::shared_ptr<lab::AudioNode> audio_node, lab::noodle::NoodleNode *const node);
@@ -0,0 +1,81 @@
+
+#include "LatencyProbeNode.hpp"
+
+#include <LabSound/core/AudioBus.h>
+#include <LabSound/core/AudioContext.h>
+#include <LabSound/core/AudioNodeInput.h>
+#include <LabSound/core/AudioNodeOutput.h>
+
+#include <cmath>
+
+LatencyProbeNode::LatencyProbeNode(lab::AudioContext& ac)
+    : AudioNode(ac)
+{
+    addInput(std::unique_ptr<lab::AudioNodeInput>(new lab::AudioNodeInput(this)));
+    addOutput(std::unique_ptr<lab::AudioNodeOutput>(new lab::AudioNodeOutput(this, 1)));
+    initialize();
+}
+
+void LatencyProbeNode::process(lab::ContextRenderLock& r, int bufferSize)
+{
+    lab::AudioBus* out_bus = output(0)->bus(r);
+    if (!out_bus)
+        return;
+
+    out_bus->zero();
+    float* out = out_bus->channel(0)->mutableData();
+
+    const float* in = nullptr;
+    lab::AudioBus* in_bus = input(0)->isConnected() ? input(0)->bus(r) : nullptr;
+    if (in_bus && in_bus->numberOfChannels() > 0)
+        in = in_bus->channel(0)->data();
+
+    const double sample_rate = r.context()->sampleRate();
+    const uint64_t interval_frames = static_cast<uint64_t>(interval * sample_rate);
+    const uint64_t timeout_frames = static_cast<uint64_t>(timeout * sample_rate);
+
+    for (int i = 0; i < bufferSize; ++i)
+    {
+        const uint64_t frame = _frame + i;
+        if (!_listening)
+        {
+            if (frame >= _next_impulse)
+            {
+                _emitted_at = frame;
+                _listening = true;
+            }
+        }
+
+        if (_listening && frame < _emitted_at + impulse_frames)
+        {
+            out[i] = 1.f;
+            continue;
+        }
+
+        if (_listening)
+        {
+            // the input is examined once the impulse has been written, the
+            // first loud sample after that is taken to be its return
+            if (in && std::fabs(in[i]) > threshold)
+            {
+                round_trip.add(static_cast<float>((frame - _emitted_at) / sample_rate));
+                _listening = false;
+                _next_impulse = frame + interval_frames;
+            }
+            else if (frame - _emitted_at > timeout_frames)
+            {
+                timeouts.fetch_add(1, std::memory_order_relaxed);
+                _listening = false;
+                _next_impulse = frame + interval_frames;
+            }
+        }
+    }
+
+    _frame += bufferSize;
+}
+
+void LatencyProbeNode::reset(lab::ContextRenderLock&)
+{
+    _listening = false;
+    _next_impulse = _frame;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+//--------------------------------------------------------------
+
+#include <LabSound/core/AudioNode.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+// A running summary of latencies, in seconds. It is written by the audio
+// thread, and read by the UI, so each value is individually atomic; a reader
+// may see a sample counted in one value and not yet in another.
+struct LatencyStatistic
+{
+    std::atomic<int> count{ 0 };
+    std::atomic<float> last{ 0 };
+    std::atomic<float> min{ 0 };
+    std::atomic<float> max{ 0 };
+    std::atomic<float> sum{ 0 };
+
+    void add(float seconds)
+    {
+        int n = count.load(std::memory_order_relaxed);
+        if (n == 0 || seconds < min.load(std::memory_order_relaxed))
+            min.store(seconds, std::memory_order_relaxed);
+        if (n == 0 || seconds > max.load(std::memory_order_relaxed))
+            max.store(seconds, std::memory_order_relaxed);
+        sum.store(sum.load(std::memory_order_relaxed) + seconds, std::memory_order_relaxed);
+        last.store(seconds, std::memory_order_relaxed);
+        count.store(n + 1, std::memory_order_release);
+    }
+
+    float mean() const
+    {
+        int n = count.load(std::memory_order_acquire);
+        return n ? sum.load(std::memory_order_relaxed) / n : 0.f;
+    }
+};
+
+// LatencyProbe measures the round trip through the audio device. It emits a
+// short impulse on its output, which should be connected to the Device, and
+// listens for it on its input, which the provider connects to the device's
+// input when the probe is created. A loopback cable, or a microphone near a
+// speaker, closes the loop. The time between emitting and hearing the
+// impulse is the round trip latency, including the device's buffers.
+struct LatencyProbeNode : public lab::AudioNode
+{
+    LatencyProbeNode(lab::AudioContext& ac);
+    virtual ~LatencyProbeNode() = default;
+
+    LatencyStatistic round_trip;
+    std::atomic<int> timeouts{ 0 };     // impulses that were never heard
+
+    float threshold = 0.25f;            // input level that counts as hearing the impulse
+    double interval = 0.5;              // seconds between impulses
+    double timeout = 1.0;               // seconds to wait for an impulse to return
+
+    // keeps the device input alive while the probe listens to it
+    std::shared_ptr<lab::AudioNode> hardware_input;
+
+    //--------------------------------------------------
+    // required interface
+    //
+    static const char* static_name() { return "LatencyProbe"; }
+    virtual const char* name() const override { return static_name(); }
+
+    virtual void process(lab::ContextRenderLock& r, int bufferSize) override;
+    virtual void reset(lab::ContextRenderLock&) override;
+    virtual double tailTime(lab::ContextRenderLock& r) const override { return 0.; }
+    virtual double latencyTime(lab::ContextRenderLock& r) const override { return 0.; }
+
+private:
+    static const int impulse_frames = 8;
+
+    uint64_t _frame = 0;        // frames processed since the probe was created
+    uint64_t _emitted_at = 0;
+    uint64_t _next_impulse = 0;
+    bool _listening = false;
+};
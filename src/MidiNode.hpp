@@ -61,7 +61,7 @@ struct MidiNode : public lab::AudioNode
     virtual void process(lab::ContextRenderLock& r, int bufferSize) override
     {
         /// @TODO make the value changes sample accurate
-        for (auto i : key_to_addrData)
+        for (const auto& i : key_to_addrData)
         {
             for (int j = 0; j < i.second.value_count; ++j)
             {
@@ -1,7 +1,7 @@
 
 #pragma once
 
-#include "queue_spsc.hpp"
+#include <cstdint>
 #include <string>
 
 struct OSCMsg
@@ -10,4 +10,5 @@ struct OSCMsg
     int addr_id = 0;
     int argc = 0;
     float data[4] = { 0,0,0,0 };
+    int64_t arrival = 0;    // see OSCNode::pending_arrival
 };
@@ -5,6 +5,10 @@
 #include <LabSound/core/AudioBus.h>
 #include <LabSound/core/AudioNode.h>
 #include <LabSound/core/AudioNodeOutput.h>
+#include "LatencyProbeNode.hpp"
+
+#include <atomic>
+#include <chrono>
 #include <map>
 
 struct OSCNode : public lab::AudioNode
@@ -26,9 +30,27 @@ struct OSCNode : public lab::AudioNode
     };
     std::map<int, AddrData> key_to_addrData;
 
-    // returns true if the address was added
-    bool addAddress(char const* const addr, int addr_id, int channels, float* data)
+    // from the arrival of a message at the server, to the start of the
+    // quantum that renders its value, in seconds
+    LatencyStatistic control_latency;
+
+    // when the oldest message not yet rendered arrived, in steady_clock
+    // nanoseconds, or zero if every message has been rendered
+    std::atomic<int64_t> pending_arrival{ 0 };
+
+    static int64_t now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // returns true if the address was added. arrival is as for pending_arrival, zero if unknown
+    bool addAddress(char const* const addr, int addr_id, int channels, float* data, int64_t arrival = 0)
     {
+        int64_t none = 0;
+        if (arrival)
+            pending_arrival.compare_exchange_strong(none, arrival, std::memory_order_release);
+
         auto it = key_to_addrData.find(addr_id);
         bool must_add = it == key_to_addrData.end();
 
@@ -61,8 +83,12 @@ struct OSCNode : public lab::AudioNode
     // Called from context's audio thread.
     virtual void process(lab::ContextRenderLock& r, int bufferSize) override
     {
+        int64_t arrival = pending_arrival.exchange(0, std::memory_order_acquire);
+        if (arrival)
+            control_latency.add(static_cast<float>((now() - arrival) * 1.e-9));
+
         /// @TODO make the value changes sample accurate
-        for (auto i : key_to_addrData)
+        for (const auto& i : key_to_addrData)
         {
             for (int j = 0; j < i.second.value_count; ++j)
             {
@@ -0,0 +1,78 @@
+
+// LabSoundGraphToyBench measures the cost of the audio engine, with no
+// window, and no audio device.
+
+#include "lab_bench.h"
+#include "MidiNode.hpp"
+#include "OSCNode.hpp"
+
+#include <LabSound/LabSound.h>
+
+#include <CLI/CLI.hpp>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+int main(int argc, char** argv)
+{
+    // the application's own nodes are measured along with LabSound's
+    lab::NodeRegistry::Instance().Register(OSCNode::static_name(),
+        [](lab::AudioContext& ac)->lab::AudioNode* { return new OSCNode(ac); },
+        [](lab::AudioNode* n) { delete n; });
+    lab::NodeRegistry::Instance().Register(MidiNode::static_name(),
+        [](lab::AudioContext& ac)->lab::AudioNode* { return new MidiNode(ac); },
+        [](lab::AudioNode* n) { delete n; });
+
+    CLI::App app{ "Benchmark the LabSoundGraphToy audio engine offline" };
+    app.require_subcommand(1);
+
+    lab::noodle::NodeCostOptions node_options;
+    std::string node_output = "node_costs.csv";
+    CLI::App* nodes = app.add_subcommand("nodes", "measure the cost per sample, and the allocations per quantum, of every node type");
+    nodes->add_option("-o,--output", node_output, "table of results, JSON if the name ends in .json, otherwise CSV")->capture_default_str();
+    nodes->add_option("-c,--channels", node_options.channels, "channel counts to measure")->capture_default_str();
+    nodes->add_option("-r,--sample-rates", node_options.sample_rates, "sample rates to measure")->capture_default_str();
+    nodes->add_option("-d,--duration", node_options.seconds, "seconds rendered per measurement")->capture_default_str()->check(CLI::PositiveNumber);
+    nodes->add_option("--repeats", node_options.repeats, "measurements per node, the fastest is kept")->capture_default_str()->check(CLI::PositiveNumber);
+    nodes->add_option("--only", node_options.only, "node types to measure, defaults to all");
+    nodes->add_option("--skip", node_options.skip, "node types not to measure");
+
+    lab::noodle::GraphScaleOptions scale_options;
+    std::string scale_output = "graph_scale.csv";
+    CLI::App* scale = app.add_subcommand("scale", "measure quantum time against graph size, for graphs built through the Provider");
+    scale->add_option("-o,--output", scale_output, "table of results, JSON if the name ends in .json, otherwise CSV")->capture_default_str();
+    scale->add_option("-t,--topologies", scale_options.topologies, "graph shapes to measure")->capture_default_str()
+        ->check(CLI::IsMember(lab::noodle::graph_scale_topologies()));
+    scale->add_option("-n,--sizes", scale_options.sizes, "values of N to measure")->capture_default_str();
+    scale->add_option("-d,--duration", scale_options.seconds, "seconds rendered per graph")->capture_default_str()->check(CLI::PositiveNumber);
+    scale->add_option("-r,--sample-rate", scale_options.sample_rate, "sample rate in Hz")->capture_default_str()->check(CLI::PositiveNumber);
+
+    CLI11_PARSE(app, argc, argv);
+
+    if (*nodes)
+    {
+        std::vector<lab::noodle::NodeCost> costs = lab::noodle::benchmark_node_costs(node_options);
+        if (costs.empty())
+        {
+            printf("No node types were measured\n");
+            return 1;
+        }
+        if (!lab::noodle::write_node_costs(node_output, costs))
+            return 1;
+        printf("wrote %d measurements to %s\n", (int) costs.size(), node_output.c_str());
+    }
+    if (*scale)
+    {
+        std::vector<lab::noodle::GraphScaleResult> results = lab::noodle::benchmark_graph_scale(scale_options);
+        if (results.empty())
+        {
+            printf("No graphs were measured\n");
+            return 1;
+        }
+        if (!lab::noodle::write_graph_scale(scale_output, results))
+            return 1;
+        printf("wrote %d measurements to %s\n", (int) results.size(), scale_output.c_str());
+    }
+    return 0;
+}
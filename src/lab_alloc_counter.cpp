@@ -0,0 +1,86 @@
+
+#include "lab_alloc_counter.h"
+#include "lab_rt_guard.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+namespace {
+    std::atomic<uint64_t> g_allocations{ 0 };
+
+    void* counted_alloc(std::size_t size)
+    {
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+        lab::noodle::rt_guard::on_allocation();
+        void* p = std::malloc(size ? size : 1);
+        if (!p)
+            throw std::bad_alloc();
+        return p;
+    }
+
+    void counted_free(void* p)
+    {
+        if (p)
+            lab::noodle::rt_guard::on_free();
+        std::free(p);
+    }
+
+    // over-aligned types, such as SIMD buffers, are allocated through the
+    // std::align_val_t overloads, which must be freed to match
+    void* counted_aligned_alloc(std::size_t size, std::align_val_t alignment)
+    {
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+        lab::noodle::rt_guard::on_allocation();
+        std::size_t a = static_cast<std::size_t>(alignment);
+        if (a < sizeof(void*))
+            a = sizeof(void*);
+#ifdef _WIN32
+        void* p = _aligned_malloc(size ? size : 1, a);
+#else
+        void* p = nullptr;
+        if (posix_memalign(&p, a, size ? size : 1) != 0)
+            p = nullptr;
+#endif
+        if (!p)
+            throw std::bad_alloc();
+        return p;
+    }
+
+    void counted_aligned_free(void* p)
+    {
+        if (p)
+            lab::noodle::rt_guard::on_free();
+#ifdef _WIN32
+        _aligned_free(p);
+#else
+        std::free(p);
+#endif
+    }
+}
+
+namespace lab { namespace noodle {
+
+    uint64_t allocation_count()
+    {
+        return g_allocations.load(std::memory_order_relaxed);
+    }
+
+} } // lab::noodle
+
+void* operator new(std::size_t size) { return counted_alloc(size); }
+void* operator new[](std::size_t size) { return counted_alloc(size); }
+void operator delete(void* p) noexcept { counted_free(p); }
+void operator delete[](void* p) noexcept { counted_free(p); }
+void operator delete(void* p, std::size_t) noexcept { counted_free(p); }
+void operator delete[](void* p, std::size_t) noexcept { counted_free(p); }
+void* operator new(std::size_t size, std::align_val_t a) { return counted_aligned_alloc(size, a); }
+void* operator new[](std::size_t size, std::align_val_t a) { return counted_aligned_alloc(size, a); }
+void operator delete(void* p, std::align_val_t) noexcept { counted_aligned_free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { counted_aligned_free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { counted_aligned_free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { counted_aligned_free(p); }
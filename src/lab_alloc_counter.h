@@ -0,0 +1,24 @@
+#ifndef included_lab_alloc_counter_h
+#define included_lab_alloc_counter_h
+
+/*
+    Counts allocations made through the global operator new.
+
+    A program that links lab_alloc_counter.cpp has its global operator new
+    and delete, including the aligned overloads, replaced by versions that
+    forward to malloc and free, and count every allocation on every thread. Benchmarks read the count
+    before and after the work they measure. When the guard is compiled in,
+    the allocations and frees are also reported to lab_rt_guard.h, which
+    flags those on the audio thread.
+*/
+
+#include <cstdint>
+
+namespace lab { namespace noodle {
+
+    // the number of allocations made since the program started
+    uint64_t allocation_count();
+
+} } // lab::noodle
+
+#endif
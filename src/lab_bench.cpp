@@ -0,0 +1,554 @@
+
+#include "lab_bench.h"
+#include "lab_alloc_counter.h"
+#include "lab_noodle_core.h"
+#include "LabSoundInterface.h"
+#include "MidiNode.hpp"
+#include "OSCNode.hpp"
+
+#include <LabSound/LabSound.h>
+
+#include <rapidjson/prettywriter.h>
+#include <rapidjson/stringbuffer.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <thread>
+
+namespace lab { namespace noodle {
+
+    namespace {
+
+        // LabSound renders in quanta of a fixed size, set when it is compiled
+        const int quantum_frames = 128;
+
+        // pulls its input, and discards it
+        struct BenchmarkSink : public lab::AudioNode
+        {
+            explicit BenchmarkSink(lab::AudioContext& ac)
+                : AudioNode(ac)
+            {
+                addInput(std::unique_ptr<lab::AudioNodeInput>(new lab::AudioNodeInput(this)));
+                initialize();
+            }
+
+            static const char* static_name() { return "BenchmarkSink"; }
+            virtual const char* name() const override { return static_name(); }
+
+            virtual void process(lab::ContextRenderLock& r, int bufferSize) override { }
+            virtual void reset(lab::ContextRenderLock&) override { }
+            virtual double tailTime(lab::ContextRenderLock& r) const override { return 0.; }
+            virtual double latencyTime(lab::ContextRenderLock& r) const override { return 0.; }
+        };
+
+        // deterministic white noise, so every run is driven identically
+        std::shared_ptr<lab::AudioBus> noise_bus(int channels, size_t frames, float sample_rate)
+        {
+            std::shared_ptr<lab::AudioBus> bus = std::make_shared<lab::AudioBus>(channels, frames);
+            uint32_t seed = 0x2545f491;
+            for (int c = 0; c < channels; ++c)
+            {
+                float* data = bus->channel(c)->mutableData();
+                for (size_t i = 0; i < frames; ++i)
+                {
+                    seed = seed * 1664525u + 1013904223u;
+                    data[i] = (static_cast<float>(seed >> 8) / 16777216.f - 0.5f);
+                }
+            }
+            bus->setSampleRate(sample_rate);
+            return bus;
+        }
+
+        std::shared_ptr<lab::AudioNode> create_node(lab::AudioContext& ac, const std::string& kind, int channels)
+        {
+            if (kind == "OSC")
+            {
+                // with no address an OSCNode has no outputs, give it one to drive
+                std::shared_ptr<OSCNode> n = std::make_shared<OSCNode>(ac);
+                float values[3] = { 0.25f, 0.5f, 0.75f };
+                n->addAddress("/benchmark", 0, std::min(channels, 3), values);
+                return n;
+            }
+            if (kind == "Midi")
+            {
+                std::shared_ptr<MidiNode> n = std::make_shared<MidiNode>(ac);
+                float values[3] = { 0.25f, 0.5f, 0.75f };
+                n->addAddress("/benchmark", 0, std::min(channels, 3), values);
+                return n;
+            }
+
+            lab::AudioNode* node = lab::NodeRegistry::Instance().Create(kind, ac);
+            return std::shared_ptr<lab::AudioNode>(node);
+        }
+
+        lab::AudioStreamConfig offline_config(int channels, float sample_rate)
+        {
+            lab::AudioStreamConfig config;
+            config.device_index = 0;
+            config.desired_channels = channels;
+            config.desired_samplerate = sample_rate;
+            return config;
+        }
+
+        struct Measurement
+        {
+            double wall_seconds = std::numeric_limits<double>::max();
+            uint64_t allocations = std::numeric_limits<uint64_t>::max();
+        };
+
+        enum class Harness { SinkOnly, SourceToSink, SourceToNodeToSink, NodeToSink };
+
+        // renders one configuration, and keeps the fastest time, and the
+        // fewest allocations, seen so far in m
+        bool measure(Harness harness, const std::string& kind, int channels, float sample_rate,
+            double seconds, Measurement& m)
+        {
+            std::unique_ptr<lab::AudioContext> context = lab::MakeOfflineAudioContext(offline_config(channels, sample_rate), seconds * 1000.0);
+            lab::AudioContext& ac = *context.get();
+
+            std::shared_ptr<BenchmarkSink> sink = std::make_shared<BenchmarkSink>(ac);
+            std::shared_ptr<lab::SampledAudioNode> source;
+            std::shared_ptr<lab::AudioNode> node;
+
+            if (harness == Harness::SourceToNodeToSink || harness == Harness::NodeToSink)
+            {
+                node = create_node(ac, kind, channels);
+                if (!node)
+                    return false;
+            }
+
+            {
+                lab::ContextRenderLock r(context.get(), "benchmark_node_costs");
+                if (harness == Harness::SourceToSink || harness == Harness::SourceToNodeToSink)
+                {
+                    source = std::make_shared<lab::SampledAudioNode>(ac);
+                    source->setBus(r, noise_bus(channels, static_cast<size_t>(seconds * sample_rate) + quantum_frames, sample_rate));
+                }
+            }
+
+            context->addAutomaticPullNode(sink);
+            switch (harness)
+            {
+            case Harness::SinkOnly:
+                break;
+            case Harness::SourceToSink:
+                ac.connect(sink, source);
+                break;
+            case Harness::SourceToNodeToSink:
+                ac.connect(node, source);
+                if (node->numberOfOutputs() > 0)
+                    ac.connect(sink, node);
+                else
+                    context->addAutomaticPullNode(node);
+                break;
+            case Harness::NodeToSink:
+                if (node->numberOfOutputs() > 0)
+                    ac.connect(sink, node);
+                else
+                    context->addAutomaticPullNode(node);
+                break;
+            }
+
+            if (source)
+                source->schedule(0);
+            if (node && node->isScheduledNode())
+            {
+                lab::AudioScheduledSourceNode* s = dynamic_cast<lab::AudioScheduledSourceNode*>(node.get());
+                if (s)
+                    s->start(0.f);
+            }
+
+            std::atomic<bool> complete{ false };
+            context->offlineRenderCompleteCallback = [&complete]() { complete = true; };
+
+            uint64_t allocations = allocation_count();
+            auto start = std::chrono::steady_clock::now();
+            context->startOfflineRendering();
+            while (!complete)
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            allocations = allocation_count() - allocations;
+
+            m.wall_seconds = std::min(m.wall_seconds, wall);
+            m.allocations = std::min(m.allocations, allocations);
+            return true;
+        }
+
+        // records a sample once per quantum; it is pulled after the
+        // Device, so the Device's timing for the quantum is complete
+        struct QuantumProbe : public lab::AudioNode
+        {
+            QuantumProbe(lab::AudioContext& ac, size_t expected_quanta, std::function<float()> sample)
+                : AudioNode(ac), sample(sample)
+            {
+                samples.reserve(expected_quanta);
+                initialize();
+            }
+
+            static const char* static_name() { return "QuantumProbe"; }
+            virtual const char* name() const override { return static_name(); }
+
+            virtual void process(lab::ContextRenderLock& r, int bufferSize) override
+            {
+                if (samples.size() < samples.capacity())
+                    samples.push_back(sample());
+            }
+
+            virtual void reset(lab::ContextRenderLock&) override { }
+            virtual double tailTime(lab::ContextRenderLock& r) const override { return 0.; }
+            virtual double latencyTime(lab::ContextRenderLock& r) const override { return 0.; }
+
+            std::function<float()> sample;
+            std::vector<float> samples;
+        };
+
+        void queue_node(GraphCore& core, const std::string& kind, const std::string& name)
+        {
+            Work work(core.provider, core.root);
+            work.type = WorkType::CreateNode;
+            work.kind = kind;
+            work.name = name;
+            core.pending_work.emplace_back(std::move(work));
+        }
+
+        void queue_param(GraphCore& core, const std::string& node, const std::string& param, float value)
+        {
+            Work work(core.provider, core.root);
+            work.type = WorkType::SetParam;
+            work.kind = node;
+            work.name = param;
+            work.float_value = value;
+            core.pending_work.emplace_back(std::move(work));
+        }
+
+        // connects the first output of from, to the input of to, or to its param if one is named
+        void queue_connection(GraphCore& core, const std::string& from, const std::string& to, const std::string& param = "")
+        {
+            Work work(core.provider, core.root);
+            work.pendingConnection = std::make_unique<WorkPendingConnection>();
+            work.pendingConnection->from_node = from;
+            work.pendingConnection->to_node = to;
+            work.pendingConnection->to_pin = param;
+            work.pendingConnection->to_pin_kind = param.length() ? "param" : "bus";
+            work.type = param.length() ? WorkType::ConnectBusOutToParamIn : WorkType::ConnectBusOutToBusIn;
+            core.pending_work.emplace_back(std::move(work));
+        }
+
+        // queues the graph, and returns the names of the nodes to start
+        std::vector<std::string> queue_graph(GraphCore& core, const std::string& topology, int n, const std::string& device)
+        {
+            std::vector<std::string> oscillators;
+            if (topology == "fan-in")
+            {
+                queue_node(core, "Gain", "Mix");
+                queue_connection(core, "Mix", device);
+                for (int i = 0; i < n; ++i)
+                {
+                    std::string osc = "Osc " + std::to_string(i);
+                    std::string gain = "Gain " + std::to_string(i);
+                    queue_node(core, "Oscillator", osc);
+                    queue_node(core, "Gain", gain);
+                    queue_param(core, osc, "frequency", 110.f + i);
+                    queue_param(core, gain, "gain", 1.f / n);
+                    queue_connection(core, osc, gain);
+                    queue_connection(core, gain, "Mix");
+                    oscillators.push_back(osc);
+                }
+            }
+            else if (topology == "chain")
+            {
+                queue_node(core, "Oscillator", "Osc");
+                oscillators.push_back("Osc");
+                std::string previous = "Osc";
+                for (int i = 0; i < n; ++i)
+                {
+                    std::string gain = "Gain " + std::to_string(i);
+                    queue_node(core, "Gain", gain);
+                    queue_connection(core, previous, gain);
+                    previous = gain;
+                }
+                queue_connection(core, previous, device);
+            }
+            else if (topology == "fan-out")
+            {
+                queue_node(core, "Oscillator", "LFO");
+                queue_param(core, "LFO", "frequency", 2.f);
+                queue_node(core, "Gain", "Mix");
+                queue_param(core, "Mix", "gain", 1.f / n);
+                queue_connection(core, "Mix", device);
+                oscillators.push_back("LFO");
+                for (int i = 0; i < n; ++i)
+                {
+                    std::string osc = "Osc " + std::to_string(i);
+                    queue_node(core, "Oscillator", osc);
+                    queue_param(core, osc, "frequency", 110.f + i);
+                    queue_connection(core, "LFO", osc, "frequency");
+                    queue_connection(core, osc, "Mix");
+                    oscillators.push_back(osc);
+                }
+            }
+            return oscillators;
+        }
+
+        bool write_table(const std::string& path, const std::string& csv_header,
+            const std::function<void(rapidjson::PrettyWriter<rapidjson::StringBuffer>&)>& json,
+            const std::function<void(std::ofstream&)>& csv)
+        {
+            std::ofstream file(path, std::ios::binary);
+            if (!file)
+            {
+                printf("Could not write %s\n", path.c_str());
+                return false;
+            }
+
+            size_t ext = path.find_last_of('.');
+            if (ext != std::string::npos && path.substr(ext) == ".json")
+            {
+                rapidjson::StringBuffer s;
+                rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(s);
+                writer.StartArray();
+                json(writer);
+                writer.EndArray();
+                file << s.GetString() << "\n";
+                return true;
+            }
+
+            file << csv_header << "\n";
+            csv(file);
+            return true;
+        }
+
+    } // anon
+
+    std::vector<NodeCost> benchmark_node_costs(const NodeCostOptions& options)
+    {
+        std::vector<std::string> kinds = lab::NodeRegistry::Instance().Names();
+        std::sort(kinds.begin(), kinds.end());
+
+        auto listed = [](const std::vector<std::string>& list, const std::string& kind)
+        {
+            return std::find(list.begin(), list.end(), kind) != list.end();
+        };
+
+        std::vector<NodeCost> result;
+        for (float sample_rate : options.sample_rates)
+        {
+            for (int channels : options.channels)
+            {
+                const double frames = options.seconds * sample_rate;
+                const double quanta = frames / quantum_frames;
+
+                Measurement sink_only, source_to_sink;
+                for (int i = 0; i < options.repeats; ++i)
+                {
+                    measure(Harness::SinkOnly, "", channels, sample_rate, options.seconds, sink_only);
+                    measure(Harness::SourceToSink, "", channels, sample_rate, options.seconds, source_to_sink);
+                }
+
+                for (const std::string& kind : kinds)
+                {
+                    if ((options.only.size() && !listed(options.only, kind)) || listed(options.skip, kind))
+                        continue;
+
+                    // sources are measured against a baseline without the noise source
+                    bool has_inputs = false;
+                    {
+                        std::unique_ptr<lab::AudioContext> probe_context = lab::MakeOfflineAudioContext(offline_config(channels, sample_rate), 1.0);
+                        std::shared_ptr<lab::AudioNode> probe = create_node(*probe_context.get(), kind, channels);
+                        if (!probe)
+                        {
+                            printf("Could not create %s, skipped\n", kind.c_str());
+                            continue;
+                        }
+                        has_inputs = probe->numberOfInputs() > 0;
+                    }
+
+                    Harness harness = has_inputs ? Harness::SourceToNodeToSink : Harness::NodeToSink;
+                    const Measurement& baseline = has_inputs ? source_to_sink : sink_only;
+
+                    Measurement m;
+                    bool measured = true;
+                    for (int i = 0; i < options.repeats && measured; ++i)
+                        measured = measure(harness, kind, channels, sample_rate, options.seconds, m);
+                    if (!measured)
+                        continue;
+
+                    NodeCost cost;
+                    cost.node = kind;
+                    cost.channels = channels;
+                    cost.sample_rate = sample_rate;
+                    cost.quantum_frames = quantum_frames;
+                    cost.ns_per_sample = std::max(0.0, m.wall_seconds - baseline.wall_seconds) * 1e9 / frames;
+                    cost.allocations_per_quantum = m.allocations > baseline.allocations ?
+                        (m.allocations - baseline.allocations) / quanta : 0.0;
+                    result.push_back(cost);
+
+                    printf("%-24s %d ch %6.0f Hz  %9.2f ns/sample  %6.2f allocs/quantum\n",
+                        kind.c_str(), channels, sample_rate, cost.ns_per_sample, cost.allocations_per_quantum);
+                }
+            }
+        }
+        return result;
+    }
+
+    bool write_node_costs(const std::string& path, const std::vector<NodeCost>& costs)
+    {
+        return write_table(path, "node,channels,sample_rate,quantum_frames,ns_per_sample,allocations_per_quantum",
+            [&](rapidjson::PrettyWriter<rapidjson::StringBuffer>& writer)
+            {
+                for (const NodeCost& cost : costs)
+                {
+                    writer.StartObject();
+                    writer.Key("node");
+                    writer.String(cost.node.c_str());
+                    writer.Key("channels");
+                    writer.Int(cost.channels);
+                    writer.Key("sample_rate");
+                    writer.Double(cost.sample_rate);
+                    writer.Key("quantum_frames");
+                    writer.Int(cost.quantum_frames);
+                    writer.Key("ns_per_sample");
+                    writer.Double(cost.ns_per_sample);
+                    writer.Key("allocations_per_quantum");
+                    writer.Double(cost.allocations_per_quantum);
+                    writer.EndObject();
+                }
+            },
+            [&](std::ofstream& file)
+            {
+                char buff[256];
+                for (const NodeCost& cost : costs)
+                {
+                    snprintf(buff, sizeof(buff), "%s,%d,%.0f,%d,%.3f,%.3f\n", cost.node.c_str(), cost.channels,
+                        cost.sample_rate, cost.quantum_frames, cost.ns_per_sample, cost.allocations_per_quantum);
+                    file << buff;
+                }
+            });
+    }
+
+    const std::vector<std::string>& graph_scale_topologies()
+    {
+        static const std::vector<std::string> topologies = { "fan-in", "chain", "fan-out" };
+        return topologies;
+    }
+
+    std::vector<GraphScaleResult> benchmark_graph_scale(const GraphScaleOptions& options)
+    {
+        std::vector<GraphScaleResult> result;
+        for (const std::string& topology : options.topologies)
+        {
+            for (int n : options.sizes)
+            {
+                const size_t quanta = static_cast<size_t>(options.seconds * options.sample_rate / quantum_frames);
+                const double quantum_us = 1e6 * quantum_frames / options.sample_rate;
+
+                // the provider must outlive the core, and the probe
+                LabSoundProvider provider(lab::MakeOfflineAudioContext(offline_config(2, options.sample_rate), options.seconds * 1000.0));
+                GraphCore core(provider);
+                core.init({ 0, 0 });
+                core.process_pending_work();
+
+                NoodleNode* device = provider.find_node(core.device_node);
+                if (!device)
+                {
+                    printf("Could not create a Device for %s %d\n", topology.c_str(), n);
+                    continue;
+                }
+
+                auto start = std::chrono::steady_clock::now();
+                std::vector<std::string> scheduled = queue_graph(core, topology, n, device->name);
+                core.process_pending_work();
+                for (const std::string& name : scheduled)
+                    provider.node_start_stop(provider.entity_for_node_named(name), 0.f);
+                double build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+                ln_Node device_node = core.device_node;
+                std::shared_ptr<QuantumProbe> probe = std::make_shared<QuantumProbe>(*provider.audio_context(), quanta + 1,
+                    [&provider, device_node]() { return provider.node_get_timing(device_node); });
+
+                lab::AudioContext* ac = provider.audio_context();
+                ac->addAutomaticPullNode(probe);
+
+                std::atomic<bool> complete{ false };
+                ac->offlineRenderCompleteCallback = [&complete]() { complete = true; };
+                ac->startOfflineRendering();
+                while (!complete)
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                ac->removeAutomaticPullNode(probe);
+
+                std::vector<float> q = probe->samples;
+                if (q.empty())
+                {
+                    printf("No quanta were rendered for %s %d\n", topology.c_str(), n);
+                    continue;
+                }
+                std::sort(q.begin(), q.end());
+                double mean = 0;
+                for (float t : q)
+                    mean += t;
+                mean /= q.size();
+
+                GraphScaleResult r;
+                r.topology = topology;
+                r.size = n;
+                r.nodes = static_cast<int>(core.root.nodes.size());
+                r.build_ms = build_ms;
+                r.quantum_mean_us = mean * 1e6;
+                r.quantum_p99_us = q[std::min(q.size() - 1, static_cast<size_t>(q.size() * 0.99))] * 1e6;
+                r.quantum_max_us = q.back() * 1e6;
+                r.budget_percent = 100.0 * r.quantum_mean_us / quantum_us;
+                result.push_back(r);
+
+                printf("%-8s N=%-6d %6d nodes  build %9.2f ms  quantum mean %9.2f us  p99 %9.2f us  %6.1f%% of budget\n",
+                    topology.c_str(), n, r.nodes, r.build_ms, r.quantum_mean_us, r.quantum_p99_us, r.budget_percent);
+            }
+        }
+        return result;
+    }
+
+    bool write_graph_scale(const std::string& path, const std::vector<GraphScaleResult>& results)
+    {
+        return write_table(path, "topology,size,nodes,build_ms,quantum_mean_us,quantum_p99_us,quantum_max_us,budget_percent",
+            [&](rapidjson::PrettyWriter<rapidjson::StringBuffer>& writer)
+            {
+                for (const GraphScaleResult& r : results)
+                {
+                    writer.StartObject();
+                    writer.Key("topology");
+                    writer.String(r.topology.c_str());
+                    writer.Key("size");
+                    writer.Int(r.size);
+                    writer.Key("nodes");
+                    writer.Int(r.nodes);
+                    writer.Key("build_ms");
+                    writer.Double(r.build_ms);
+                    writer.Key("quantum_mean_us");
+                    writer.Double(r.quantum_mean_us);
+                    writer.Key("quantum_p99_us");
+                    writer.Double(r.quantum_p99_us);
+                    writer.Key("quantum_max_us");
+                    writer.Double(r.quantum_max_us);
+                    writer.Key("budget_percent");
+                    writer.Double(r.budget_percent);
+                    writer.EndObject();
+                }
+            },
+            [&](std::ofstream& file)
+            {
+                char buff[256];
+                for (const GraphScaleResult& r : results)
+                {
+                    snprintf(buff, sizeof(buff), "%s,%d,%d,%.3f,%.3f,%.3f,%.3f,%.2f\n", r.topology.c_str(), r.size, r.nodes,
+                        r.build_ms, r.quantum_mean_us, r.quantum_p99_us, r.quantum_max_us, r.budget_percent);
+                    file << buff;
+                }
+            });
+    }
+
+} } // lab::noodle
@@ -0,0 +1,85 @@
+#ifndef included_lab_bench_h
+#define included_lab_bench_h
+
+/*
+    Benchmarks of the audio engine, run in offline contexts with no
+    window and no audio device.
+
+    Node costs are measured per node type in the NodeRegistry. Each type is
+    rendered between a noise source and a silent sink, and the same graph
+    without the node is rendered as a baseline. The difference, divided by
+    the number of sample frames rendered, is the node's cost per sample.
+    Allocations are counted the same way, if the program links
+    lab_alloc_counter.cpp.
+
+    Graph scale is measured by building graphs of increasing size through
+    GraphCore and a LabSoundProvider, exactly as the editor would, and
+    sampling the Device node's timing once per rendered quantum.
+*/
+
+#include <string>
+#include <vector>
+
+namespace lab { namespace noodle {
+
+    struct NodeCostOptions
+    {
+        std::vector<int> channels = { 1, 2 };
+        std::vector<float> sample_rates = { 48000.f };
+        double seconds = 2.0;       // rendered per measurement
+        int repeats = 3;            // the fastest of the repeats is kept
+        std::vector<std::string> only;  // if not empty, only these types are measured
+        std::vector<std::string> skip;  // types that are not measured
+    };
+
+    struct NodeCost
+    {
+        std::string node;
+        int channels = 0;
+        float sample_rate = 0;
+        int quantum_frames = 0;
+        double ns_per_sample = 0;   // per sample frame, across all channels
+        double allocations_per_quantum = 0;
+    };
+
+    // measures every registered node type, at every combination of
+    // channel count and sample rate. types that can't be created in an
+    // offline context are reported, and left out.
+    std::vector<NodeCost> benchmark_node_costs(const NodeCostOptions& options);
+
+    // writes JSON if the path ends in .json, and CSV otherwise
+    bool write_node_costs(const std::string& path, const std::vector<NodeCost>& costs);
+
+    // fan-in: N oscillators, each through a gain, into a mixer, into the Device
+    // chain: an oscillator through N gains in series, into the Device
+    // fan-out: an LFO driving the frequency of N oscillators, mixed into the Device
+    const std::vector<std::string>& graph_scale_topologies();
+
+    struct GraphScaleOptions
+    {
+        std::vector<std::string> topologies = graph_scale_topologies();
+        std::vector<int> sizes = { 1, 10, 100, 1000, 10000 };
+        double seconds = 1.0;       // rendered per graph
+        float sample_rate = 48000.f;
+    };
+
+    struct GraphScaleResult
+    {
+        std::string topology;
+        int size = 0;
+        int nodes = 0;
+        double build_ms = 0;            // time to create and connect the graph
+        double quantum_mean_us = 0;
+        double quantum_p99_us = 0;
+        double quantum_max_us = 0;
+        double budget_percent = 0;      // mean quantum time, as a percentage of the quantum's duration
+    };
+
+    std::vector<GraphScaleResult> benchmark_graph_scale(const GraphScaleOptions& options);
+
+    // writes JSON if the path ends in .json, and CSV otherwise
+    bool write_graph_scale(const std::string& path, const std::vector<GraphScaleResult>& results);
+
+} } // lab::noodle
+
+#endif
@@ -0,0 +1,564 @@
+#include "lab_bundle.h"
+#include "lab_hash.h"
+
+#include <cstring>
+#include <fstream>
+#include <stdio.h>
+
+#if defined(_WIN32)
+# include <Windows.h>
+#else
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
+
+namespace lab { namespace noodle {
+
+    static constexpr char bundle_magic[8] = { 'L', 'S', 'G', 'T', 'B', 'N', 'D', 'L' };
+    static constexpr uint32_t bundle_version = 1;
+    static constexpr uint64_t bundle_alignment = 64;
+
+    enum class BlobKind : uint32_t { Patch = 0, Sample = 1 };
+    enum class BlobCodec : uint32_t { Stored = 0, LZ = 1 };
+
+    struct BundleHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t entry_count;
+        uint64_t index_offset;
+        uint64_t reserved;
+    };
+
+    struct BundleEntry
+    {
+        uint64_t hash;
+        uint64_t offset;
+        uint64_t stored_size;
+        uint64_t raw_size;
+        uint32_t kind;
+        uint32_t codec;
+    };
+
+    // a sample blob is this header, followed by planar float PCM
+    struct BundleSampleHeader
+    {
+        uint32_t channels;
+        uint32_t frames;
+        float sample_rate;
+        uint32_t reserved;
+    };
+
+    static_assert(sizeof(BundleHeader) == 32, "bundle header must be packed");
+    static_assert(sizeof(BundleEntry) == 40, "bundle entry must be packed");
+    static_assert(sizeof(BundleSampleHeader) == 16, "sample header must keep PCM 16 byte aligned");
+
+    //--------------------------------------------------------------------------
+    // codec
+
+    namespace lz
+    {
+        static constexpr int hash_bits = 14;
+        static constexpr size_t min_match = 4;
+        static constexpr size_t last_literals = 5;
+        static constexpr size_t max_offset = 65535;
+
+        static inline uint32_t read32(const uint8_t* p)
+        {
+            uint32_t v;
+            memcpy(&v, p, 4);
+            return v;
+        }
+
+        static inline bool write_length(size_t len, uint8_t*& op, const uint8_t* op_end)
+        {
+            while (len >= 255)
+            {
+                if (op >= op_end)
+                    return false;
+                *op++ = 255;
+                len -= 255;
+            }
+            if (op >= op_end)
+                return false;
+            *op++ = static_cast<uint8_t>(len);
+            return true;
+        }
+
+        static bool write_sequence(const uint8_t* literals, size_t literal_len,
+            size_t match_len, size_t offset, bool last,
+            uint8_t*& op, const uint8_t* op_end)
+        {
+            if (op >= op_end)
+                return false;
+
+            uint8_t* token = op++;
+            *token = static_cast<uint8_t>((literal_len < 15 ? literal_len : 15) << 4);
+            if (literal_len >= 15 && !write_length(literal_len - 15, op, op_end))
+                return false;
+
+            if (static_cast<size_t>(op_end - op) < literal_len)
+                return false;
+            memcpy(op, literals, literal_len);
+            op += literal_len;
+
+            if (last)
+                return true;
+
+            if (op_end - op < 2)
+                return false;
+            *op++ = static_cast<uint8_t>(offset & 0xff);
+            *op++ = static_cast<uint8_t>(offset >> 8);
+
+            size_t ml = match_len - min_match;
+            *token |= static_cast<uint8_t>(ml < 15 ? ml : 15);
+            if (ml >= 15 && !write_length(ml - 15, op, op_end))
+                return false;
+
+            return true;
+        }
+
+        size_t compress_bound(size_t size)
+        {
+            return size + size / 255 + 16;
+        }
+
+        size_t compress(const uint8_t* src, size_t size, uint8_t* dst, size_t dst_capacity)
+        {
+            uint8_t* op = dst;
+            const uint8_t* op_end = dst + dst_capacity;
+            size_t anchor = 0;
+
+            if (size > min_match + last_literals)
+            {
+                std::vector<int64_t> table(size_t(1) << hash_bits, -1);
+                const size_t match_limit = size - last_literals;
+                size_t ip = 0;
+                while (ip + min_match <= match_limit)
+                {
+                    uint32_t seq = read32(src + ip);
+                    uint32_t h = (seq * 2654435761u) >> (32 - hash_bits);
+                    int64_t ref = table[h];
+                    table[h] = static_cast<int64_t>(ip);
+
+                    if (ref < 0 || ip - static_cast<size_t>(ref) > max_offset || read32(src + ref) != seq)
+                    {
+                        ++ip;
+                        continue;
+                    }
+
+                    size_t match_len = min_match;
+                    while (ip + match_len < match_limit && src[ref + match_len] == src[ip + match_len])
+                        ++match_len;
+
+                    if (!write_sequence(src + anchor, ip - anchor, match_len, ip - static_cast<size_t>(ref), false, op, op_end))
+                        return 0;
+
+                    ip += match_len;
+                    anchor = ip;
+                }
+            }
+
+            if (!write_sequence(src + anchor, size - anchor, 0, 0, true, op, op_end))
+                return 0;
+
+            return static_cast<size_t>(op - dst);
+        }
+
+        bool decompress(const uint8_t* src, size_t size, uint8_t* dst, size_t raw_size)
+        {
+            size_t ip = 0;
+            size_t op = 0;
+            while (ip < size)
+            {
+                uint8_t token = src[ip++];
+
+                size_t literal_len = token >> 4;
+                if (literal_len == 15)
+                {
+                    uint8_t b;
+                    do
+                    {
+                        if (ip >= size)
+                            return false;
+                        b = src[ip++];
+                        literal_len += b;
+                    } while (b == 255);
+                }
+
+                if (literal_len > size - ip || literal_len > raw_size - op)
+                    return false;
+                memcpy(dst + op, src + ip, literal_len);
+                ip += literal_len;
+                op += literal_len;
+
+                if (ip >= size)
+                    break; // the last sequence has no match
+
+                if (size - ip < 2)
+                    return false;
+                size_t offset = src[ip] | (static_cast<size_t>(src[ip + 1]) << 8);
+                ip += 2;
+                if (offset == 0 || offset > op)
+                    return false;
+
+                size_t match_len = token & 0xf;
+                if (match_len == 15)
+                {
+                    uint8_t b;
+                    do
+                    {
+                        if (ip >= size)
+                            return false;
+                        b = src[ip++];
+                        match_len += b;
+                    } while (b == 255);
+                }
+                match_len += min_match;
+                if (match_len > raw_size - op)
+                    return false;
+
+                // matches may overlap the bytes being written, so copy forward bytewise
+                const uint8_t* match = dst + op - offset;
+                for (size_t i = 0; i < match_len; ++i)
+                    dst[op + i] = match[i];
+                op += match_len;
+            }
+            return op == raw_size;
+        }
+    }
+
+    //--------------------------------------------------------------------------
+    // writing
+
+    uint64_t BundleWriter::add_sample(const BusData& bus)
+    {
+        BundleSampleHeader header = {
+            static_cast<uint32_t>(bus.channels),
+            static_cast<uint32_t>(bus.frames),
+            bus.sample_rate, 0 };
+
+        size_t pcm_size = sizeof(float) * static_cast<size_t>(bus.channels) * static_cast<size_t>(bus.frames);
+        if (pcm_size > bus.samples.size() * sizeof(float))
+            pcm_size = bus.samples.size() * sizeof(float);
+
+        Blob blob;
+        blob.kind = static_cast<uint32_t>(BlobKind::Sample);
+        blob.raw.resize(sizeof(header) + pcm_size);
+        memcpy(blob.raw.data(), &header, sizeof(header));
+        if (pcm_size)
+            memcpy(blob.raw.data() + sizeof(header), bus.samples.data(), pcm_size);
+
+        uint64_t hash = hash_bytes(blob.raw.data(), blob.raw.size());
+        if (_samples.find(hash) == _samples.end())
+            _samples[hash] = std::move(blob);
+
+        return hash;
+    }
+
+    void BundleWriter::set_patch(const std::string& patch_json)
+    {
+        _patch = patch_json;
+    }
+
+    bool BundleWriter::write(const std::string& path)
+    {
+        std::ofstream file(path, std::ios::binary);
+        if (!file.is_open())
+        {
+            printf("Could not open bundle %s for writing\n", path.c_str());
+            return false;
+        }
+
+        std::vector<BundleEntry> entries;
+        uint64_t offset = sizeof(BundleHeader);
+
+        BundleHeader header = {};
+        memcpy(header.magic, bundle_magic, sizeof(bundle_magic));
+        header.version = bundle_version;
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+        std::vector<uint8_t> compressed;
+        auto write_blob = [&](uint64_t hash, uint32_t kind, const uint8_t* raw, size_t raw_size, bool always_compress)
+        {
+            static const char zeroes[bundle_alignment] = { 0 };
+            uint64_t aligned = (offset + bundle_alignment - 1) & ~(bundle_alignment - 1);
+            file.write(zeroes, aligned - offset);
+            offset = aligned;
+
+            compressed.resize(lz::compress_bound(raw_size));
+            size_t compressed_size = lz::compress(raw, raw_size, compressed.data(), compressed.size());
+
+            // store PCM uncompressed unless compression pays for the decode on open;
+            // uncompressed blobs are played directly from the mapping.
+            bool use_lz = compressed_size > 0 &&
+                (always_compress ? compressed_size < raw_size : compressed_size < raw_size - raw_size / 4);
+
+            BundleEntry entry = {};
+            entry.hash = hash;
+            entry.offset = offset;
+            entry.raw_size = raw_size;
+            entry.kind = kind;
+            if (use_lz)
+            {
+                entry.codec = static_cast<uint32_t>(BlobCodec::LZ);
+                entry.stored_size = compressed_size;
+                file.write(reinterpret_cast<const char*>(compressed.data()), compressed_size);
+            }
+            else
+            {
+                entry.codec = static_cast<uint32_t>(BlobCodec::Stored);
+                entry.stored_size = raw_size;
+                file.write(reinterpret_cast<const char*>(raw), raw_size);
+            }
+            offset += entry.stored_size;
+            entries.push_back(entry);
+        };
+
+        write_blob(hash_string(_patch), static_cast<uint32_t>(BlobKind::Patch),
+            reinterpret_cast<const uint8_t*>(_patch.data()), _patch.size(), true);
+
+        for (auto& sample : _samples)
+            write_blob(sample.first, sample.second.kind, sample.second.raw.data(), sample.second.raw.size(), false);
+
+        header.entry_count = static_cast<uint32_t>(entries.size());
+        header.index_offset = offset;
+        file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(BundleEntry));
+        file.seekp(0);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.flush();
+
+        printf("Wrote bundle %s, %d samples, %llu bytes\n", path.c_str(), (int) _samples.size(),
+            (unsigned long long) (offset + entries.size() * sizeof(BundleEntry)));
+        return file.good();
+    }
+
+    bool write_wav(const std::string& path, const BusData& bus)
+    {
+        const size_t sample_count = static_cast<size_t>(bus.channels) * static_cast<size_t>(bus.frames);
+        if (bus.channels <= 0 || bus.frames < 0 || bus.samples.size() < sample_count)
+            return false;
+
+        std::ofstream file(path, std::ios::binary);
+        if (!file.is_open())
+            return false;
+
+        auto put16 = [&file](uint16_t v) { file.write(reinterpret_cast<const char*>(&v), 2); };
+        auto put32 = [&file](uint32_t v) { file.write(reinterpret_cast<const char*>(&v), 4); };
+
+        const uint32_t data_size = static_cast<uint32_t>(sample_count * sizeof(float));
+        const uint32_t rate = static_cast<uint32_t>(bus.sample_rate);
+        const uint16_t channels = static_cast<uint16_t>(bus.channels);
+        file.write("RIFF", 4);
+        put32(36 + data_size);
+        file.write("WAVEfmt ", 8);
+        put32(16);
+        put16(3);   // IEEE float
+        put16(channels);
+        put32(rate);
+        put32(rate * channels * sizeof(float));
+        put16(static_cast<uint16_t>(channels * sizeof(float)));
+        put16(32);
+        file.write("data", 4);
+        put32(data_size);
+
+        // a bus is planar, a WAV file interleaved
+        std::vector<float> frame(bus.channels);
+        for (int f = 0; f < bus.frames; ++f)
+        {
+            for (int c = 0; c < bus.channels; ++c)
+                frame[c] = bus.samples[static_cast<size_t>(c) * bus.frames + f];
+            file.write(reinterpret_cast<const char*>(frame.data()), frame.size() * sizeof(float));
+        }
+
+        file.flush();
+        return file.good();
+    }
+
+    //--------------------------------------------------------------------------
+    // reading
+
+    struct Bundle::Mapping
+    {
+        const uint8_t* data = nullptr;
+        size_t size = 0;
+
+#if defined(_WIN32)
+        HANDLE file = INVALID_HANDLE_VALUE;
+        HANDLE map = nullptr;
+
+        bool open(const std::string& path)
+        {
+            file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (file == INVALID_HANDLE_VALUE)
+                return false;
+
+            LARGE_INTEGER file_size;
+            if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0)
+                return false;
+
+            map = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (!map)
+                return false;
+
+            data = reinterpret_cast<const uint8_t*>(MapViewOfFile(map, FILE_MAP_READ, 0, 0, 0));
+            size = static_cast<size_t>(file_size.QuadPart);
+            return data != nullptr;
+        }
+
+        ~Mapping()
+        {
+            if (data)
+                UnmapViewOfFile(data);
+            if (map)
+                CloseHandle(map);
+            if (file != INVALID_HANDLE_VALUE)
+                CloseHandle(file);
+        }
+#else
+        bool open(const std::string& path)
+        {
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0)
+                return false;
+
+            struct stat st;
+            if (fstat(fd, &st) != 0 || st.st_size == 0)
+            {
+                close(fd);
+                return false;
+            }
+
+            void* p = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            close(fd); // the mapping keeps the file alive
+            if (p == MAP_FAILED)
+                return false;
+
+            data = reinterpret_cast<const uint8_t*>(p);
+            size = static_cast<size_t>(st.st_size);
+            return true;
+        }
+
+        ~Mapping()
+        {
+            if (data)
+                munmap(const_cast<uint8_t*>(data), size);
+        }
+#endif
+    };
+
+    Bundle::~Bundle() = default;
+
+    std::shared_ptr<Bundle> Bundle::open(const std::string& path)
+    {
+        std::shared_ptr<Bundle> bundle(new Bundle());
+        bundle->_mapping.reset(new Mapping());
+        Mapping& m = *bundle->_mapping;
+        if (!m.open(path))
+        {
+            printf("Could not map bundle %s\n", path.c_str());
+            return {};
+        }
+
+        BundleHeader header;
+        if (m.size < sizeof(header))
+            return {};
+
+        memcpy(&header, m.data, sizeof(header));
+        if (memcmp(header.magic, bundle_magic, sizeof(bundle_magic)) != 0 || header.version != bundle_version)
+        {
+            printf("%s is not a LabSoundGraphToy bundle\n", path.c_str());
+            return {};
+        }
+
+        if (header.index_offset > m.size ||
+            (m.size - header.index_offset) / sizeof(BundleEntry) < header.entry_count)
+        {
+            printf("Bundle %s is truncated\n", path.c_str());
+            return {};
+        }
+
+        std::vector<BundleEntry> entries(header.entry_count);
+        memcpy(entries.data(), m.data + header.index_offset, entries.size() * sizeof(BundleEntry));
+
+        for (const BundleEntry& entry : entries)
+        {
+            if (entry.offset > m.size || entry.stored_size > m.size - entry.offset)
+            {
+                printf("Bundle %s has a corrupt entry\n", path.c_str());
+                return {};
+            }
+
+            const uint8_t* blob = m.data + entry.offset;
+            if (entry.codec == static_cast<uint32_t>(BlobCodec::LZ))
+            {
+                // a raw size the stream couldn't decode to would allocate for nothing
+                if (entry.raw_size > entry.stored_size * lz::max_expansion + bundle_alignment)
+                {
+                    printf("Bundle %s has a corrupt compressed entry\n", path.c_str());
+                    return {};
+                }
+
+                // decode into float storage so that PCM keeps its alignment
+                bundle->_decoded.emplace_back((entry.raw_size + sizeof(float) - 1) / sizeof(float));
+                uint8_t* dst = reinterpret_cast<uint8_t*>(bundle->_decoded.back().data());
+                if (!lz::decompress(blob, entry.stored_size, dst, entry.raw_size))
+                {
+                    printf("Bundle %s has a corrupt compressed entry\n", path.c_str());
+                    return {};
+                }
+                blob = dst;
+            }
+            else if (entry.codec != static_cast<uint32_t>(BlobCodec::Stored))
+            {
+                printf("Bundle %s uses an unknown codec\n", path.c_str());
+                return {};
+            }
+            else if (entry.raw_size != entry.stored_size)
+            {
+                printf("Bundle %s has a corrupt entry\n", path.c_str());
+                return {};
+            }
+
+            if (entry.kind == static_cast<uint32_t>(BlobKind::Patch))
+            {
+                bundle->_patch.assign(reinterpret_cast<const char*>(blob), entry.raw_size);
+            }
+            else if (entry.kind == static_cast<uint32_t>(BlobKind::Sample))
+            {
+                BundleSampleHeader sh;
+                if (entry.raw_size < sizeof(sh))
+                    continue;
+
+                memcpy(&sh, blob, sizeof(sh));
+                size_t pcm_size = sizeof(float) * static_cast<size_t>(sh.channels) * sh.frames;
+                if (pcm_size > entry.raw_size - sizeof(sh))
+                    continue;
+
+                BundleSample sample;
+                sample.channels = static_cast<int>(sh.channels);
+                sample.frames = static_cast<int>(sh.frames);
+                sample.sample_rate = sh.sample_rate;
+                sample.samples = reinterpret_cast<const float*>(blob + sizeof(sh));
+                bundle->_samples[entry.hash] = sample;
+            }
+        }
+
+        return bundle;
+    }
+
+    bool Bundle::find_sample(uint64_t hash, BundleSample& result) const
+    {
+        auto it = _samples.find(hash);
+        if (it == _samples.end())
+            return false;
+
+        result = it->second;
+        result.owner = shared_from_this();
+        return true;
+    }
+
+} } // lab::noodle
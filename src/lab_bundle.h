@@ -0,0 +1,114 @@
+#ifndef included_lab_bundle_h
+#define included_lab_bundle_h
+
+/*
+    A bundle is a single file holding a patch, and all of the sample data
+    the patch references. Samples are stored as decoded planar float PCM,
+    addressed by the hash of their content, so a sample used by several
+    nodes is stored once.
+
+    Bundles are memory mapped when opened. Sample blobs that were stored
+    uncompressed are handed to the audio engine directly from the mapping;
+    blobs that were worth compressing are decoded once, when the bundle
+    is opened.
+
+    The layout is
+
+        header | blob | blob | ... | index
+
+    Blobs are 64 byte aligned within the file, so PCM data in a mapping is
+    suitably aligned for the audio engine. All values are little endian.
+*/
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace lab { namespace noodle {
+
+    // BusData is an owned copy of a bus, as retrieved from a provider
+    struct BusData
+    {
+        int channels = 0;
+        int frames = 0;
+        float sample_rate = 0.f;
+        std::vector<float> samples; // planar, channels * frames
+    };
+
+    // BundleSample is a view of a bus stored in a bundle. owner keeps the
+    // backing storage alive for as long as the audio engine holds the view.
+    struct BundleSample
+    {
+        int channels = 0;
+        int frames = 0;
+        float sample_rate = 0.f;
+        const float* samples = nullptr; // planar, channels * frames
+        std::shared_ptr<const void> owner;
+    };
+
+    // the built in codec is a byte oriented LZ77 variant in the spirit of LZ4.
+    // it is not meant to compete with general purpose compressors, it is meant
+    // to be small, dependency free, and to decode at memory speed.
+    namespace lz
+    {
+        size_t compress_bound(size_t size);
+
+        // returns the compressed size, or zero if dst_capacity was insufficient
+        size_t compress(const uint8_t* src, size_t size, uint8_t* dst, size_t dst_capacity);
+
+        // returns true if exactly raw_size bytes were decoded
+        bool decompress(const uint8_t* src, size_t size, uint8_t* dst, size_t raw_size);
+
+        // no stream decodes to more than this many times its own size, plus a little
+        static constexpr uint64_t max_expansion = 255;
+    }
+
+    // writes the bus as a 32 bit float WAV file, which lab::MakeBusFromFile can read
+    bool write_wav(const std::string& path, const BusData& bus);
+
+    class BundleWriter
+    {
+    public:
+        // returns the content hash of the sample, which the patch uses to refer to it
+        uint64_t add_sample(const BusData& bus);
+        void set_patch(const std::string& patch_json);
+        bool write(const std::string& path);
+
+    private:
+        struct Blob
+        {
+            uint32_t kind;
+            std::vector<uint8_t> raw;
+        };
+
+        std::string _patch;
+        std::map<uint64_t, Blob> _samples;
+    };
+
+    class Bundle : public std::enable_shared_from_this<Bundle>
+    {
+        struct Mapping;
+
+    public:
+        ~Bundle();
+
+        static std::shared_ptr<Bundle> open(const std::string& path);
+
+        const std::string& patch() const { return _patch; }
+        bool find_sample(uint64_t hash, BundleSample& result) const;
+
+    private:
+        Bundle() = default;
+
+        std::unique_ptr<Mapping> _mapping;
+        std::map<uint64_t, BundleSample> _samples;
+        std::vector<std::vector<float>> _decoded;
+        std::string _patch;
+    };
+
+} } // lab::noodle
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef included_lab_hash_h
+#define included_lab_hash_h
+
+/*
+    A small, fast, non-cryptographic 64 bit hash for content addressing.
+    It is stable across platforms of the same endianness, and is used
+    wherever GraphToy needs to tell whether two blobs of data are the same.
+*/
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace lab { namespace noodle {
+
+    inline uint64_t hash_mix(uint64_t h)
+    {
+        // the murmur3 finalizer
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    inline uint64_t hash_bytes(const void* data, size_t len, uint64_t seed = 0x9e3779b97f4a7c15ULL)
+    {
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+        uint64_t h = seed ^ (static_cast<uint64_t>(len) * 0x87c37b91114253d5ULL);
+        while (len >= 8)
+        {
+            uint64_t k;
+            memcpy(&k, p, 8);
+            h ^= hash_mix(k);
+            h = ((h << 27) | (h >> 37)) * 5 + 0x52dce729;
+            p += 8;
+            len -= 8;
+        }
+        uint64_t k = 0;
+        memcpy(&k, p, len);
+        h ^= hash_mix(k ^ len);
+        return hash_mix(h);
+    }
+
+    inline uint64_t hash_string(const std::string& s, uint64_t seed = 0x9e3779b97f4a7c15ULL)
+    {
+        return hash_bytes(s.data(), s.size(), seed);
+    }
+
+    // content addresses are written into documents as # followed by 16 hex digits
+    inline std::string content_address(uint64_t hash)
+    {
+        static const char* digits = "0123456789abcdef";
+        std::string result(17, '#');
+        for (int i = 0; i < 16; ++i)
+            result[16 - i] = digits[(hash >> (i * 4)) & 0xf];
+        return result;
+    }
+
+    inline bool parse_content_address(const std::string& s, uint64_t& hash)
+    {
+        if (s.size() != 17 || s[0] != '#')
+            return false;
+
+        hash = 0;
+        for (int i = 1; i < 17; ++i)
+        {
+            char c = s[i];
+            uint64_t v;
+            if (c >= '0' && c <= '9') v = c - '0';
+            else if (c >= 'a' && c <= 'f') v = c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') v = c - 'A' + 10;
+            else return false;
+            hash = (hash << 4) | v;
+        }
+        return true;
+    }
+
+} } // lab::noodle
+
+#endif
@@ -0,0 +1,111 @@
+#ifndef included_lab_histogram_h
+#define included_lab_histogram_h
+
+/*
+    A histogram of durations in microseconds, with buckets that widen as the
+    values grow, so that every bucket has the same relative precision, in the
+    manner of an HDR histogram. Each power of two is divided into sixteen
+    buckets, so values are placed within about six percent, and values
+    under thirty two are exact.
+
+    Recording is lock-free and doesn't allocate, so the audio thread may
+    record while the UI reads. A reader may see a value counted in a bucket
+    before it is counted in the total.
+*/
+
+#include <atomic>
+#include <cstdint>
+
+namespace lab { namespace noodle {
+
+    class DurationHistogram
+    {
+    public:
+        static const int sub_bucket_bits = 4;
+        static const int sub_buckets = 1 << sub_bucket_bits;
+        static const int max_magnitude = 24;    // values up to 2^25 microseconds, about 33 seconds
+        static const int bucket_count = sub_buckets + (max_magnitude - sub_bucket_bits + 1) * sub_buckets;
+
+        void record(uint64_t us)
+        {
+            _counts[bucket_for(us)].fetch_add(1, std::memory_order_relaxed);
+            _total.fetch_add(1, std::memory_order_relaxed);
+
+            uint64_t prev = _max.load(std::memory_order_relaxed);
+            while (us > prev && !_max.compare_exchange_weak(prev, us, std::memory_order_relaxed)) {}
+        }
+
+        // not safe to call while another thread records
+        void reset()
+        {
+            for (auto& c : _counts)
+                c.store(0, std::memory_order_relaxed);
+            _total.store(0, std::memory_order_relaxed);
+            _max.store(0, std::memory_order_relaxed);
+        }
+
+        uint64_t total() const { return _total.load(std::memory_order_relaxed); }
+        uint64_t max() const { return _max.load(std::memory_order_relaxed); }
+        uint64_t count(int bucket) const { return _counts[bucket].load(std::memory_order_relaxed); }
+
+        // the upper bound of the bucket holding the given fraction of values,
+        // limited to the largest value recorded
+        uint64_t percentile(double fraction) const
+        {
+            uint64_t total = 0;
+            for (const auto& c : _counts)
+                total += c.load(std::memory_order_relaxed);
+            if (!total)
+                return 0;
+
+            uint64_t target = static_cast<uint64_t>(fraction * total + 0.5);
+            if (target < 1)
+                target = 1;
+            uint64_t seen = 0;
+            for (int i = 0; i < bucket_count; ++i)
+            {
+                seen += _counts[i].load(std::memory_order_relaxed);
+                if (seen >= target)
+                {
+                    uint64_t upper = i + 1 < bucket_count ? lower_bound(i + 1) - 1 : max();
+                    return upper < max() ? upper : max();
+                }
+            }
+            return max();
+        }
+
+        static int bucket_for(uint64_t us)
+        {
+            if (us < 2 * sub_buckets)
+                return static_cast<int>(us);
+
+            int magnitude = 0;
+            for (uint64_t v = us; v > 1; v >>= 1)
+                ++magnitude;
+            if (magnitude > max_magnitude)
+                return bucket_count - 1;
+
+            const int shift = magnitude - sub_bucket_bits;
+            const int sub = static_cast<int>((us >> shift) & (sub_buckets - 1));
+            return sub_buckets + shift * sub_buckets + sub;
+        }
+
+        static uint64_t lower_bound(int bucket)
+        {
+            if (bucket < 2 * sub_buckets)
+                return static_cast<uint64_t>(bucket);
+
+            const int shift = (bucket - sub_buckets) / sub_buckets;
+            const int sub = (bucket - sub_buckets) % sub_buckets;
+            return static_cast<uint64_t>(sub_buckets + sub) << shift;
+        }
+
+    private:
+        std::atomic<uint64_t> _counts[bucket_count] = {};
+        std::atomic<uint64_t> _total{ 0 };
+        std::atomic<uint64_t> _max{ 0 };
+    };
+
+} } // lab::noodle
+
+#endif
@@ -0,0 +1,107 @@
+#include "lab_instrument.h"
+#include "lab_trace.h"
+
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+namespace lab { namespace noodle { namespace instrument {
+
+    namespace {
+
+        // sites are never destroyed before the program ends, so the registry holds plain pointers
+        std::mutex& registry_mutex()
+        {
+            static std::mutex m;
+            return m;
+        }
+
+        std::vector<Site*>& registry()
+        {
+            static std::vector<Site*> sites;
+            return sites;
+        }
+
+    } // anon
+
+    Site::Site(const char* name, const char* category, bool timer)
+        : name(name), category(category), timer(timer)
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex());
+        registry().push_back(this);
+    }
+
+    Site& site(const char* name, const char* category, bool timer)
+    {
+        {
+            std::lock_guard<std::mutex> lock(registry_mutex());
+            for (Site* s : registry())
+                if (s->timer == timer && !strcmp(s->name, name) && !strcmp(s->category, category))
+                    return *s;
+        }
+
+        // registered by its constructor
+        return *new Site(name, category, timer);
+    }
+
+    void record(Site& site, double duration)
+    {
+        const uint64_t ns = static_cast<uint64_t>(duration * 1000.0);
+        site.count.fetch_add(1, std::memory_order_relaxed);
+        site.total_ns.fetch_add(ns, std::memory_order_relaxed);
+        uint64_t prev = site.max_ns.load(std::memory_order_relaxed);
+        while (ns > prev && !site.max_ns.compare_exchange_weak(prev, ns, std::memory_order_relaxed)) {}
+
+        if (trace::recording())
+            trace::complete(site.name, site.category, trace::now() - duration, duration);
+    }
+
+    void for_each(const std::function<void(const Site&)>& fn)
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex());
+        for (Site* s : registry())
+            fn(*s);
+    }
+
+    void reset()
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex());
+        for (Site* s : registry())
+        {
+            s->count = 0;
+            s->total_ns = 0;
+            s->max_ns = 0;
+        }
+    }
+
+    void dump(FILE* f)
+    {
+        fprintf(f, "%-12s %-36s %10s %12s %12s %12s\n", "category", "site", "count", "total ms", "mean us", "max us");
+        for_each([f](const Site& s)
+        {
+            const uint64_t count = s.count.load();
+            if (!count)
+                return;
+            if (!s.timer)
+            {
+                fprintf(f, "%-12s %-36s %10llu\n", s.category, s.name, (unsigned long long) count);
+                return;
+            }
+            const double total = s.total_ns.load() * 1e-3;
+            fprintf(f, "%-12s %-36s %10llu %12.3f %12.3f %12.3f\n", s.category, s.name, (unsigned long long) count,
+                total * 1e-3, total / count, s.max_ns.load() * 1e-3);
+        });
+    }
+
+    Timer::Timer(Site& site)
+        : _site(site), _start(std::chrono::steady_clock::now())
+    {
+    }
+
+    Timer::~Timer()
+    {
+        record(_site, std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - _start).count());
+    }
+
+} } } // lab::noodle::instrument
@@ -0,0 +1,108 @@
+#ifndef included_lab_instrument_h
+#define included_lab_instrument_h
+
+/*
+    Scoped timers and counters for the editor's pipeline.
+
+    Each instrumented site accumulates a count, a total, and a maximum,
+    which the profiler window shows and dump prints. While a trace is
+    recording, timed scopes are also recorded as trace events on the
+    calling thread.
+
+    The macros compile to nothing unless LAB_INSTRUMENT is defined as
+    nonzero, which the LABSOUNDGRAPHTOY_INSTRUMENT build option does.
+
+        LAB_TIME_SCOPE(name, category)          times the enclosing scope
+        LAB_TIME_SCOPE_NAMED(name, category)    as above, for a name chosen at run time
+        LAB_RECORD_NAMED(name, category, duration)
+                                                records an interval, just ended, timed elsewhere
+        LAB_COUNT(name, category, n)            adds n to a counter
+
+    Names and categories must be string literals, or otherwise live as long
+    as the program. Sites named at run time are looked up under a lock, so
+    they are for the UI thread only; the other forms may be used on any
+    thread, except that the audio thread must not be the first to reach a
+    site, as registering it locks.
+*/
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+
+#ifndef LAB_INSTRUMENT
+#define LAB_INSTRUMENT 0
+#endif
+
+namespace lab { namespace noodle { namespace instrument {
+
+    struct Site
+    {
+        Site(const char* name, const char* category, bool timer);
+
+        const char* name;
+        const char* category;
+        bool timer;                             // otherwise a counter
+        std::atomic<uint64_t> count{ 0 };       // scopes timed, or the counter's value
+        std::atomic<uint64_t> total_ns{ 0 };
+        std::atomic<uint64_t> max_ns{ 0 };
+    };
+
+    // the site for a name chosen at run time, created on first use
+    Site& site(const char* name, const char* category, bool timer);
+
+    // records an interval, in microseconds, that has just ended
+    void record(Site& site, double duration);
+
+    void for_each(const std::function<void(const Site&)>& fn);
+    void reset();
+
+    // prints every site that has been reached
+    void dump(FILE* f);
+
+    class Timer
+    {
+    public:
+        explicit Timer(Site& site);
+        ~Timer();
+
+    private:
+        Site& _site;
+        std::chrono::steady_clock::time_point _start;
+    };
+
+} } } // lab::noodle::instrument
+
+#if LAB_INSTRUMENT
+
+#define LAB_INSTRUMENT_CONCAT2(a, b) a##b
+#define LAB_INSTRUMENT_CONCAT(a, b) LAB_INSTRUMENT_CONCAT2(a, b)
+#define LAB_INSTRUMENT_ID(prefix) LAB_INSTRUMENT_CONCAT(prefix, __LINE__)
+
+#define LAB_TIME_SCOPE(name, category) \
+    static lab::noodle::instrument::Site LAB_INSTRUMENT_ID(lab_site_)(name, category, true); \
+    lab::noodle::instrument::Timer LAB_INSTRUMENT_ID(lab_timer_)(LAB_INSTRUMENT_ID(lab_site_))
+
+#define LAB_TIME_SCOPE_NAMED(name, category) \
+    lab::noodle::instrument::Timer LAB_INSTRUMENT_ID(lab_timer_)(lab::noodle::instrument::site(name, category, true))
+
+#define LAB_RECORD_NAMED(name, category, duration) \
+    lab::noodle::instrument::record(lab::noodle::instrument::site(name, category, true), duration)
+
+#define LAB_COUNT(name, category, n) \
+    do { \
+        static lab::noodle::instrument::Site lab_site(name, category, false); \
+        lab_site.count.fetch_add(static_cast<uint64_t>(n), std::memory_order_relaxed); \
+    } while (0)
+
+#else
+
+#define LAB_TIME_SCOPE(name, category) do {} while (0)
+#define LAB_TIME_SCOPE_NAMED(name, category) do {} while (0)
+#define LAB_RECORD_NAMED(name, category, duration) do {} while (0)
+#define LAB_COUNT(name, category, n) do {} while (0)
+
+#endif
+
+#endif
@@ -0,0 +1,33 @@
+#include "lab_memory.h"
+
+#include <LabSound/LabSound.h>
+
+namespace lab { namespace noodle {
+
+    size_t bus_bytes(const lab::AudioBus* bus)
+    {
+        if (!bus)
+            return 0;
+        return sizeof(lab::AudioBus) + sizeof(float) * bus->numberOfChannels() * bus->length();
+    }
+
+    size_t node_audio_bytes(lab::ContextRenderLock& r, lab::AudioNode& node)
+    {
+        size_t bytes = 0;
+        int c = (int) node.numberOfOutputs();
+        for (int i = 0; i < c; ++i)
+            bytes += bus_bytes(node.output(i)->bus(r));
+
+        for (auto& setting : node.settings())
+            if (setting->type() == lab::AudioSetting::Type::Bus)
+                bytes += bus_bytes(setting->valueBus().get());
+
+        // the analyser keeps an FFT frame and the smoothed magnitudes, each
+        // of about the FFT size in floats
+        if (lab::AnalyserNode* analyser = dynamic_cast<lab::AnalyserNode*>(&node))
+            bytes += sizeof(float) * analyser->fftSize() * 2;
+
+        return bytes;
+    }
+
+} } // lab::noodle
@@ -0,0 +1,30 @@
+#ifndef included_lab_memory_h
+#define included_lab_memory_h
+
+/*
+    The audio memory a LabSound node owns, as far as LabSound exposes it:
+    the buses of its outputs, the buses held by its settings, such as
+    decoded sound files, and an analyser's FFT buffers. Memory a node keeps
+    privately, such as a convolver's kernels, is not counted. A bus that
+    refers to a bundle's storage is counted as the node's, although the
+    bundle owns it.
+*/
+
+#include <cstddef>
+
+namespace lab {
+    class AudioBus;
+    class AudioNode;
+    class ContextRenderLock;
+}
+
+namespace lab { namespace noodle {
+
+    size_t bus_bytes(const lab::AudioBus* bus);
+
+    // the render lock is required, as output buses are only valid under it
+    size_t node_audio_bytes(lab::ContextRenderLock& r, lab::AudioNode& node);
+
+} } // lab::noodle
+
+#endif
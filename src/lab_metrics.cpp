@@ -0,0 +1,256 @@
+#include "lab_metrics.h"
+
+#include <cerrno>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace lab { namespace noodle {
+
+    namespace {
+
+        void lower_thread_priority()
+        {
+#if defined(_WIN32)
+            SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_LOWEST);
+#elif defined(__linux__)
+            sched_param param = {};
+            pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+#else
+            sched_param param = {};
+            param.sched_priority = sched_get_priority_min(SCHED_OTHER);
+            pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+#endif
+        }
+
+        void append(std::string& line, const char* format, ...)
+        {
+            char buffer[128];
+            va_list args;
+            va_start(args, format);
+            vsnprintf(buffer, sizeof(buffer), format, args);
+            va_end(args);
+            line += buffer;
+        }
+
+    } // anon
+
+    MetricsExporter::~MetricsExporter()
+    {
+        stop();
+    }
+
+    bool MetricsExporter::start(const MetricsOptions& options)
+    {
+        stop();
+        _options = options;
+        if (_options.interval <= 0)
+            _options.interval = 10.0;
+
+        if (_options.socket_path.length())
+        {
+#if defined(_WIN32)
+            printf("Metrics can't be served on a socket on Windows\n");
+            _options.socket_path.clear();
+#else
+            sockaddr_un addr = {};
+            addr.sun_family = AF_UNIX;
+            if (_options.socket_path.length() >= sizeof(addr.sun_path))
+            {
+                printf("The metrics socket path %s is too long\n", _options.socket_path.c_str());
+                _options.socket_path.clear();
+            }
+            else
+            {
+                strcpy(addr.sun_path, _options.socket_path.c_str());
+
+                // a socket left by a previous run would prevent binding
+                unlink(addr.sun_path);
+                _socket = socket(AF_UNIX, SOCK_STREAM, 0);
+                if (_socket < 0 || bind(_socket, (sockaddr*) &addr, sizeof(addr)) < 0 || listen(_socket, 8) < 0)
+                {
+                    printf("Could not serve metrics on %s: %s\n", _options.socket_path.c_str(), strerror(errno));
+                    if (_socket >= 0)
+                        close(_socket);
+                    _socket = -1;
+                    _options.socket_path.clear();
+                }
+            }
+#endif
+        }
+
+        if (!_options.file_path.length() && !_options.socket_path.length())
+            return false;
+
+        _stopping = false;
+        _last_osc_messages = 0;
+        _last_osc_datagrams = 0;
+        _last_line_time = std::chrono::steady_clock::now();
+        _thread = std::thread([this]() { run(); });
+        return true;
+    }
+
+    void MetricsExporter::stop()
+    {
+        if (!_thread.joinable())
+            return;
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stopping = true;
+        }
+        _wake.notify_all();
+        _thread.join();
+
+#if !defined(_WIN32)
+        if (_socket >= 0)
+        {
+            close(_socket);
+            unlink(_options.socket_path.c_str());
+            _socket = -1;
+        }
+#endif
+    }
+
+    void MetricsExporter::publish(const MetricsSample& sample)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _latest = sample;
+        _frame_sum += sample.frame_seconds;
+        if (sample.frame_seconds > _frame_max)
+            _frame_max = sample.frame_seconds;
+        ++_frames;
+    }
+
+    void MetricsExporter::run()
+    {
+        lower_thread_priority();
+
+        while (!_stopping)
+        {
+            const std::string line = format_line();
+            if (_options.file_path.length())
+                write_file(line);
+            wait(line, _options.interval);
+        }
+    }
+
+    std::string MetricsExporter::format_line()
+    {
+        MetricsSample sample;
+        double frame_mean = 0;
+        double frame_max = 0;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            sample = _latest;
+            frame_mean = _frames ? _frame_sum / _frames : 0;
+            frame_max = _frame_max;
+            _frame_sum = 0;
+            _frame_max = 0;
+            _frames = 0;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        double elapsed = std::chrono::duration<double>(now - _last_line_time).count();
+        double osc_rate = elapsed > 0 ? (sample.osc_messages - _last_osc_messages) / elapsed : 0;
+        double datagram_rate = elapsed > 0 ? (sample.osc_datagrams - _last_osc_datagrams) / elapsed : 0;
+        _last_line_time = now;
+        _last_osc_messages = sample.osc_messages;
+        _last_osc_datagrams = sample.osc_datagrams;
+
+        int64_t timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+
+        std::string line = "labsoundgraphtoy ";
+        append(line, "quantum_budget_us=%.1f,", sample.quantum_budget_us);
+        append(line, "quantum_p50_us=%.1f,", sample.quantum_p50_us);
+        append(line, "quantum_p99_us=%.1f,", sample.quantum_p99_us);
+        append(line, "quantum_max_us=%.1f,", sample.quantum_max_us);
+        append(line, "quanta=%llui,", (unsigned long long) sample.quanta);
+        append(line, "deadline_misses=%llui,", (unsigned long long) sample.deadline_misses);
+        append(line, "underruns=%llui,", (unsigned long long) sample.underruns);
+        append(line, "osc_datagrams=%llui,", (unsigned long long) sample.osc_datagrams);
+        append(line, "osc_datagrams_per_second=%.1f,", datagram_rate);
+        append(line, "osc_truncated=%llui,", (unsigned long long) sample.osc_truncated);
+        append(line, "osc_kernel_drops=%llui,", (unsigned long long) sample.osc_kernel_drops);
+        append(line, "osc_messages=%llui,", (unsigned long long) sample.osc_messages);
+        append(line, "osc_messages_per_second=%.1f,", osc_rate);
+        append(line, "osc_queue_depth=%llui,", (unsigned long long) sample.osc_queue_depth);
+        append(line, "osc_queue_overflows=%llui,", (unsigned long long) sample.osc_queue_overflows);
+        append(line, "timing_drops=%llui,", (unsigned long long) sample.timing_drops);
+        append(line, "frame_mean_ms=%.2f,", frame_mean * 1000.0);
+        append(line, "frame_max_ms=%.2f,", frame_max * 1000.0);
+        append(line, "audio_bytes=%llui,", (unsigned long long) sample.audio_bytes);
+        append(line, "bookkeeping_bytes=%llui,", (unsigned long long) sample.bookkeeping_bytes);
+        append(line, "nodes=%llui", (unsigned long long) sample.nodes);
+        append(line, " %lld\n", (long long) timestamp);
+        return line;
+    }
+
+    void MetricsExporter::write_file(const std::string& line)
+    {
+        std::string temp = _options.file_path + ".tmp";
+        FILE* f = fopen(temp.c_str(), "wb");
+        if (!f)
+        {
+            printf("Could not write %s\n", temp.c_str());
+            return;
+        }
+        fwrite(line.data(), 1, line.size(), f);
+        fclose(f);
+
+#if defined(_WIN32)
+        // rename doesn't replace an existing file on Windows
+        remove(_options.file_path.c_str());
+#endif
+        if (rename(temp.c_str(), _options.file_path.c_str()) != 0)
+            printf("Could not replace %s\n", _options.file_path.c_str());
+    }
+
+    void MetricsExporter::wait(const std::string& line, double seconds)
+    {
+        auto until = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(seconds));
+
+#if !defined(_WIN32)
+        // clients are served between lines, the stop flag is checked every tenth of a second
+        if (_socket >= 0)
+        {
+            while (!_stopping && std::chrono::steady_clock::now() < until)
+            {
+                pollfd fd = { _socket, POLLIN, 0 };
+                if (poll(&fd, 1, 100) <= 0 || !(fd.revents & POLLIN))
+                    continue;
+
+                int client = accept(_socket, nullptr, nullptr);
+                if (client < 0)
+                    continue;
+#if defined(MSG_NOSIGNAL)
+                send(client, line.data(), line.size(), MSG_NOSIGNAL);
+#else
+                int no_sigpipe = 1;
+                setsockopt(client, SOL_SOCKET, SO_NOSIGPIPE, &no_sigpipe, sizeof(no_sigpipe));
+                send(client, line.data(), line.size(), 0);
+#endif
+                close(client);
+            }
+            return;
+        }
+#endif
+
+        std::unique_lock<std::mutex> lock(_mutex);
+        _wake.wait_until(lock, until, [this]() { return _stopping.load(); });
+    }
+
+} } // lab::noodle
@@ -0,0 +1,109 @@
+#ifndef included_lab_metrics_h
+#define included_lab_metrics_h
+
+/*
+    An opt-in exporter of health metrics, for installations that run
+    unattended, to be scraped by whatever monitoring the machine already has.
+
+    The UI thread publishes a sample every frame, gathered from counters it
+    already reads, so the audio thread is never touched. An exporter thread,
+    at the lowest scheduling priority, formats the latest sample once per
+    interval as a single line of InfluxDB line protocol. The line either
+    replaces the contents of a file, written to a temporary file and renamed
+    so that a reader never sees part of it, or is served to each client that
+    connects to a UNIX domain socket, which is then closed.
+
+        labsoundgraphtoy quantum_p50_us=412,quantum_p99_us=980,... 1700000000000000000
+
+    Frame times are the mean and the largest over the interval, and the OSC
+    message and datagram rates are measured over the interval too; counts are totals since
+    launch. UNIX sockets are not available on Windows.
+*/
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace lab { namespace noodle {
+
+    struct MetricsOptions
+    {
+        std::string file_path;      // rewritten every interval, if not empty
+        std::string socket_path;    // served, if not empty
+        double interval = 10.0;     // in seconds
+    };
+
+    struct MetricsSample
+    {
+        // render time of a quantum, from the deadline statistics
+        double quantum_budget_us = 0;
+        double quantum_p50_us = 0;
+        double quantum_p99_us = 0;
+        double quantum_max_us = 0;
+        uint64_t quanta = 0;
+        uint64_t deadline_misses = 0;
+        uint64_t underruns = 0;
+
+        uint64_t osc_datagrams = 0;         // received since launch, see lab_udp_receiver.h
+        uint64_t osc_truncated = 0;
+        uint64_t osc_kernel_drops = 0;
+        uint64_t osc_messages = 0;          // received since launch
+        uint64_t osc_queue_depth = 0;       // received but not yet consumed by the UI
+        uint64_t osc_queue_overflows = 0;   // dropped because the queue was full
+        uint64_t timing_drops = 0;          // quanta lost from the timing ring
+
+        double frame_seconds = 0;           // the time since the previous frame
+
+        uint64_t audio_bytes = 0;
+        uint64_t bookkeeping_bytes = 0;
+        uint64_t nodes = 0;
+    };
+
+    class MetricsExporter
+    {
+    public:
+        MetricsExporter() = default;
+        ~MetricsExporter();
+        MetricsExporter(const MetricsExporter&) = delete;
+        MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+        // returns false and reports the problem if neither output could be opened
+        bool start(const MetricsOptions& options);
+        void stop();
+        bool running() const { return _thread.joinable(); }
+
+        // called by the UI thread, every frame
+        void publish(const MetricsSample& sample);
+
+    private:
+        void run();
+        std::string format_line();
+        void write_file(const std::string& line);
+        void wait(const std::string& line, double seconds);
+
+        MetricsOptions _options;
+        std::thread _thread;
+        std::mutex _mutex;
+        std::condition_variable _wake;
+        std::atomic<bool> _stopping{ false };
+
+        // guarded by _mutex
+        MetricsSample _latest;
+        double _frame_sum = 0;
+        double _frame_max = 0;
+        uint64_t _frames = 0;
+
+        // the exporter thread's own
+        uint64_t _last_osc_messages = 0;
+        uint64_t _last_osc_datagrams = 0;
+        std::chrono::steady_clock::time_point _last_line_time;
+        int _socket = -1;
+    };
+
+} } // lab::noodle
+
+#endif
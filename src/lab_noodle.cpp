@@ -1,17 +1,18 @@
 
 #include "lab_noodle.h"
+#include "lab_noodle_core.h"
 
+#include "lab_histogram.h"
 #include "lab_imgui_ext.hpp"
+#include "lab_instrument.h"
 #include "legit_profiler.hpp"
 
 #include "nfd.h"
 
-#include <rapidjson/document.h>
-#include <rapidjson/reader.h>
-#include <rapidjson/stringbuffer.h>
-#include <rapidjson/writer.h>
-
 #include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
 #include <set>
 #include <unordered_map>
 #include <unordered_set>
@@ -44,51 +45,6 @@ namespace noodle {
     static constexpr float style_padding_y = 16.f;    
     static constexpr float style_padding_x = 12.f;
 
-    static std::unordered_map<std::string, int> unique_bases;
-    static std::unordered_set<std::string> unique_names;
-    std::string unique_name(std::string name)
-    {
-
-        size_t pos = name.rfind("-");
-        std::string base;
-
-        // no dash, or leading dash, it's not a uniqued name
-        if (pos == std::string::npos || pos == 0)
-        {
-            base = name;
-            name += "-1";
-        }
-        else 
-            base = name.substr(0, pos);
-
-        // if base isn't already known, remember it, and return name
-        auto i = unique_bases.find(base);
-        if (i == unique_bases.end())
-        {
-            unique_bases[base] = 1;
-            unique_names.insert(name);
-            return name;
-        }
-
-        int id = i->second;
-        std::string candidate = base + "-" + std::to_string(id);
-        while (unique_names.find(candidate) != unique_names.end())
-        {
-            ++id;
-            candidate = base + "-" + std::to_string(id);
-        }
-        unique_bases[base] = id;
-        unique_names.insert(candidate);
-        return candidate;
-    }
-    void clear_unique_names()
-    {
-        unique_bases.clear();
-        unique_names.clear();
-    }
-
-
-
     vec2 NoodlePinGraphic::ul_ws(Canvas& canvas) const
     {
         float x = column_number * NoodleNodeGraphic::k_column_width();
@@ -147,38 +103,12 @@ namespace noodle {
         ln_Pin selected_pin = ln_Pin_null();
         ln_Node selected_node = ln_Node_null();
 
-        ln_Node _device_node = ln_Node_null();
-
         float pin_float = 0;
         int   pin_int = 0;
         bool  pin_bool = false;
 
-        void incr_work_epoch()
-        {
-            ++_work_epoch;
-        }
-        void reset_epochs()
-        {
-            _save_epoch = 1;
-            _work_epoch = 1;
-        }
-        void clear_epochs()
-        {
-            _save_epoch = 0;
-            _work_epoch = 0;
-        }
-        void unify_epochs()
-        {
-            _save_epoch = _work_epoch;
-        }
-        bool need_saving() const
-        {
-            return _save_epoch != _work_epoch;
-        }
-
-    private:
-        int _save_epoch = 0; // zero is reserved for empty
-        int _work_epoch = 0; // zero is reserved for empty
+        // the harness's, see ProviderHarness::file_dialog
+        const std::function<std::string(bool, const char*)>* file_dialog = nullptr;
     };
 
     struct HoverState
@@ -218,455 +148,15 @@ namespace noodle {
     };
 
 
-    enum class WorkType
-    {
-        Nop, 
-        ClearScene, 
-        CreateRuntimeContext, 
-        CreateGroup, CreateOutput,
-        CreateNode, DeleteNode, 
-        SetParam,
-        SetFloatSetting, SetIntSetting, SetBoolSetting, SetBusSetting,
-        SetEnumerationSetting,
-        ConnectBusOutToBusIn, ConnectBusOutToParamIn,
-        DisconnectInFromOut,
-        Start, Bang,
-        ResetSaveWorkEpoch
-    };
-
-    struct WorkPendingConnection
-    {
-        std::string from_node;
-        std::string from_pin;
-        std::string to_node;
-        std::string to_pin;
-        std::string to_pin_kind;
-    };
-
-
-    struct Work
-    {
-        Provider& provider;
-        CanvasGroup& root;
-        WorkType type = WorkType::Nop;
-
-        std::unique_ptr<WorkPendingConnection> pendingConnection;
-
-        std::string kind;
-        std::string name;
-
-        ln_Node group_node = ln_Node_null();
-        ln_Node input_node = ln_Node_null();
-        ln_Node output_node = ln_Node_null();
-        ln_Pin output_pin = ln_Pin_null();
-        ln_Pin param_pin = ln_Pin_null();
-        ln_Pin setting_pin = ln_Pin_null();
-        ln_Connection connection_id = ln_Connection_null();
-
-        float float_value = 0.f;
-        int int_value = 0;
-        bool bool_value = false;
-        std::string string_value;
-        ImVec2 canvas_pos = { 0, 0 };
-
-        Work() = delete;
-        ~Work() = default;
-
-        explicit Work(Provider& provider, CanvasGroup& root)
-            : provider(provider), root(root)
-        {
-        }
-
-        explicit Work(Work&& rh) noexcept
-        : provider(rh.provider), root(rh.root)
-        , type(rh.type), kind(rh.kind), name(rh.name)
-        , group_node(rh.group_node), input_node(rh.input_node), output_node(rh.output_node)
-        , output_pin(rh.output_pin)
-        , param_pin(rh.param_pin)
-        , setting_pin(rh.setting_pin)
-        , connection_id(rh.connection_id)
-        , float_value(rh.float_value), int_value(rh.int_value), bool_value(rh.bool_value)
-        , string_value(rh.string_value), canvas_pos(rh.canvas_pos)
-        {
-            std::swap(pendingConnection, rh.pendingConnection);
-
-        }
-
-        void delete_connections_and_pins(ln_Node id) {
-            for (auto i = provider._connections.begin(), last = provider._connections.end(); i != last; ) {
-                if (i->second.node_from.id == id.id || i->second.node_to.id == id.id) {
-                    i = provider._connections.erase(i);
-                }
-                else {
-                    ++i;
-                }
-            }
-
-            for (auto i = provider._noodlePins.begin(), last = provider._noodlePins.end(); i != last; ) {
-                if (i->second.node_id.id == id.id) {
-                    i = provider._noodlePins.erase(i);
-                }
-                else {
-                    ++i;
-                }
-            }
-
-        }
-
-        void eval(EditState& edit)
-        {
-            switch (type)
-            {
-            case WorkType::Nop:
-                break;
-
-            case WorkType::ResetSaveWorkEpoch:
-                edit.reset_epochs();
-                break;
-
-            case WorkType::CreateRuntimeContext:
-            {
-                edit._device_node = ln_Node{ provider.create_entity(), true };
-                kind = "Device";
-                [[fallthrough]];
-            }
-            case WorkType::CreateNode:
-            {
-                std::string conformed_name;
-                if (name.length())
-                    conformed_name = name;
-                else
-                    conformed_name = unique_name(kind);
-
-                if (kind == "Device")
-                {
-                    if (!edit._device_node.valid)
-                        edit._device_node = ln_Node{ provider.create_entity(), true };
-
-                    provider._noodleNodes[edit._device_node] = NoodleNode("Device", conformed_name, edit._device_node);
-
-                    provider.create_runtime_context(edit._device_node);
-
-                    provider._nodeGraphics[edit._device_node] = 
-                        NoodleNodeGraphic{ nullptr, NoodleGraphicLayer::Nodes, { canvas_pos.x, canvas_pos.y } };
-
-                    provider.associate(edit._device_node, conformed_name);
-
-                    root.nodes.insert(edit._device_node);
-                    edit.incr_work_epoch();
-                    break;
-                }
-
-                ln_Node new_node = ln_Node{ provider.create_entity(), true };
-                provider._noodleNodes[new_node] = NoodleNode(kind, conformed_name, new_node);
-                provider.node_create(kind, new_node);
-
-                CanvasGroup* cn = nullptr;
-                if (group_node.id != ln_Node_null().id)
-                {
-                    auto it = provider._canvasNodes.find(group_node);
-                    if (it != provider._canvasNodes.end())
-                        cn = &it->second;
-                }
-
-                provider._nodeGraphics[new_node] =
-                    NoodleNodeGraphic{cn, NoodleGraphicLayer::Nodes, { canvas_pos.x, canvas_pos.y } };
-
-                provider.associate(new_node, conformed_name);
-
-                if (cn)
-                    cn->nodes.insert(new_node);
-                else
-                    root.nodes.insert(new_node);
-
-                edit.incr_work_epoch();
-                break;
-            }
-            case WorkType::CreateOutput:
-            {
-                provider.pin_create_output(kind, name, int_value);
-                edit.incr_work_epoch();
-                break;
-            }
-            case WorkType::CreateGroup:
-            {
-                std::string conformed_name;
-                if (name.length())
-                    conformed_name = name;
-                else
-                    conformed_name = unique_name(kind);
-
-                ln_Node new_ln_node = { provider.create_entity(), true };
-                provider._noodleNodes[new_ln_node] = NoodleNode(kind, conformed_name, new_ln_node);
-
-                provider._nodeGraphics[new_ln_node] = 
-                    NoodleNodeGraphic{ nullptr, NoodleGraphicLayer::Groups, 
-                        { canvas_pos.x, canvas_pos.y },
-                        { canvas_pos.x + NoodleNodeGraphic::k_column_width() * 2, canvas_pos.y + NoodlePinGraphic::k_height() * 8},
-                        true };
-
-                provider._canvasNodes[new_ln_node] = CanvasGroup{};
-                edit.incr_work_epoch();
-                break;
-            }
-            case WorkType::SetParam:
-            {
-                if (setting_pin.id != ln_Pin_null().id)
-                    provider.pin_set_float_value(param_pin, float_value);
-                else
-                    provider.pin_set_param_value(kind, name, float_value);
-                edit.incr_work_epoch();
-                break;
-            }
-            case WorkType::SetFloatSetting:
-            {
-                if (setting_pin.id != ln_Pin_null().id)
-                    provider.pin_set_float_value(setting_pin, float_value);
-                else
-                    provider.pin_set_setting_float_value(kind, name, float_value);
-                edit.incr_work_epoch();
-                break;
-            }
-            case WorkType::SetIntSetting:
-            {
-                if (setting_pin.id != ln_Pin_null().id)
-                    provider.pin_set_int_value(setting_pin, int_value);
-                else
-                    provider.pin_set_setting_int_value(kind, name, int_value);
-                edit.incr_work_epoch();
-                break;
-            }
-            case WorkType::SetBoolSetting:
-            {
-                if (setting_pin.id != ln_Pin_null().id)
-                    provider.pin_set_bool_value(setting_pin, bool_value);
-                else
-                    provider.pin_set_setting_bool_value(kind, name, bool_value);
-                edit.incr_work_epoch();
-                break;
-            }
-            case WorkType::SetBusSetting:
-            {
-                if (setting_pin.id != ln_Pin_null().id)
-                    provider.pin_set_bus_from_file(setting_pin, string_value);
-                else
-                    provider.pin_set_setting_bus_value(kind, name, string_value);
-                edit.incr_work_epoch();
-                break;
-            }
-            case WorkType::SetEnumerationSetting:
-            {
-                if (setting_pin.id != ln_Pin_null().id)
-                    provider.pin_set_enumeration_value(setting_pin, string_value);
-                else
-                    provider.pin_set_setting_enumeration_value(kind, name, string_value);
-                edit.incr_work_epoch();
-                edit.incr_work_epoch();
-                break;
-            }
-
-            case WorkType::ConnectBusOutToBusIn:
-            {
-                ln_Node from_node_e = ln_Node_null();
-                ln_Node to_node_e = ln_Node_null();
-                ln_Pin from_pin_e = ln_Pin_null();
-                ln_Pin to_pin_e = ln_Pin_null();
-                if (pendingConnection)
-                {
-                    from_node_e = provider.entity_for_node_named(pendingConnection->from_node);
-                    to_node_e = provider.entity_for_node_named(pendingConnection->to_node);
-                    if (!from_node_e.valid || !to_node_e.valid)
-                        break;
-
-                    if (pendingConnection->from_pin.length())
-                        from_pin_e = provider.node_output_named(from_node_e, pendingConnection->from_pin);
-                    else
-                        from_pin_e = provider.node_output_with_index(from_node_e, 0);
-
-                    to_pin_e = provider.node_input_with_index(to_node_e, 0);
-
-                    provider.connect_bus_out_to_bus_in(from_node_e, from_pin_e, to_node_e);
-                }
-                else
-                {
-                    provider.connect_bus_out_to_bus_in(output_node, output_pin, input_node);
-                    from_node_e = output_node;
-                    from_pin_e = output_pin;
-                    to_node_e = input_node;
-                    to_pin_e = param_pin;
-                }
-
-                ln_Connection new_id{ provider.create_entity() };
-                provider._connections[new_id] = lab::noodle::NoodleConnection(
-                    new_id,
-                    from_pin_e, from_node_e,
-                    to_pin_e, to_node_e,
-                    lab::noodle::NoodleConnection::Kind::ToBus);
-
-                edit.incr_work_epoch();
-                break;
-            }
-
-            case WorkType::ConnectBusOutToParamIn:
-            {
-                ln_Node from_node_e = ln_Node_null();
-                ln_Node to_node_e = ln_Node_null();
-                ln_Pin  from_pin_e = ln_Pin_null();
-                ln_Pin  to_pin_e = ln_Pin_null();
-
-                if (pendingConnection)
-                {
-                    from_node_e = provider.entity_for_node_named(pendingConnection->from_node);
-                    to_node_e = provider.entity_for_node_named(pendingConnection->to_node);
-                    if (!from_node_e.valid || !to_node_e.valid)
-                        break;
-
-                    from_pin_e = ln_Pin_null();
-                    if (pendingConnection->from_pin.length())
-                        from_pin_e = provider.node_output_named(from_node_e, pendingConnection->from_pin);
-                    else
-                        from_pin_e = provider.node_output_with_index(from_node_e, 0);
-
-                    to_pin_e = ln_Pin_null();
-                    if (pendingConnection->to_pin.length())
-                        to_pin_e = provider.node_param_named(to_node_e, pendingConnection->to_pin);
-                    else
-                        break;  // nothing to connect from
-
-                    if (!from_pin_e.valid || !to_pin_e.valid)
-                        break;
-
-                    provider.connect_bus_out_to_param_in(from_node_e, from_pin_e, to_pin_e);
-                }
-                else
-                {
-                    provider.connect_bus_out_to_param_in(output_node, output_pin, param_pin);
-                    from_node_e = output_node;
-                    from_pin_e = output_pin;
-                    to_node_e = input_node;
-                    to_pin_e = param_pin;
-                }
-
-                ln_Connection new_id{ provider.create_entity() };
-                provider._connections[new_id] = lab::noodle::NoodleConnection(
-                    new_id,
-                    from_pin_e, from_node_e,
-                    to_pin_e, to_node_e,
-                    lab::noodle::NoodleConnection::Kind::ToParam);
-
-                edit.incr_work_epoch();
-                break;
-            }
-
-            case WorkType::DisconnectInFromOut:
-            {
-                auto id = ln_Connection{ connection_id };
-                auto conn_it = provider._connections.find(id);
-                if (conn_it != provider._connections.end())
-                {
-                    provider.disconnect(id);
-                    provider._connections.erase(conn_it);
-                }
-                edit.incr_work_epoch();
-                break;
-            }
-
-            case WorkType::DeleteNode:
-            {
-                auto gnl = provider._nodeGraphics.find(input_node);
-                auto it = provider._canvasNodes.find(input_node);
-                if (it != provider._canvasNodes.end())
-                {
-                    // if it's a canvas, also delete the contained nodes.
-                    CanvasGroup& cn = it->second;
-                    for (auto en : cn.nodes)
-                    {
-                        provider.node_delete(en);
-                        delete_connections_and_pins(en);
-                    }
-                    cn.nodes.clear();
-                }
-                else
-                {
-                    if (gnl != provider._nodeGraphics.end() && gnl->second.parent_canvas)
-                    {
-                        // if the node is on a canvas, remove it from the canvas
-                        auto it = gnl->second.parent_canvas->nodes.find(input_node);
-                        if (it != gnl->second.parent_canvas->nodes.end())
-                            gnl->second.parent_canvas->nodes.erase(it);
-                    }
-                    provider.node_delete(input_node);
-                    delete_connections_and_pins(input_node);
-                }
-
-                if (gnl != provider._nodeGraphics.end())
-                    provider._nodeGraphics.erase(gnl);
-
-                auto n_it = provider._noodleNodes.find(input_node);
-                if (n_it != provider._noodleNodes.end())
-                    provider._noodleNodes.erase(n_it);
-
-                edit.incr_work_epoch();
-                break;
-            }
-            case WorkType::Start:
-            {
-                provider.node_start_stop(input_node, 0.f);
-                break;
-            }
-            case WorkType::Bang:
-            {
-                provider.node_bang(input_node);
-                break;
-            }
-            case WorkType::ClearScene:
-            {
-                for (auto& noodleNode : provider._noodleNodes) {
-                    auto cg = provider._canvasNodes.find(noodleNode.second.id);
-                    if (cg != provider._canvasNodes.end())
-                    {
-                        // if it's canvas, clear the contained nodes
-                        for (auto en : cg->second.nodes)
-                        {
-                            provider.node_delete(en);
-                        }
-                        cg->second.nodes.clear();
-                    }
-                    else
-                    {
-                        auto gnl = provider._nodeGraphics.find(noodleNode.second.id);
-                        if (gnl != provider._nodeGraphics.end() && gnl->second.parent_canvas)
-                        {
-                            // if it's on a canvas, remove it.
-                            /// @TODO it probably makes sense to recurse the graph and
-                            /// delete from the leaves, rather than using this more complex algorithm
-                            auto it = gnl->second.parent_canvas->nodes.find(noodleNode.second.id);
-                            if (it != gnl->second.parent_canvas->nodes.end())
-                                gnl->second.parent_canvas->nodes.erase(it);
-                        }
-                        provider.node_delete(noodleNode.second.id);
-                    }
-                }
-
-                provider._connections.clear();
-                provider._noodleNodes.clear();
-                provider._nodeGraphics.clear();
-                provider._pinGraphics.clear();
-                provider._canvasNodes.clear();
-
-                edit.clear_epochs();
-                clear_unique_names();
-                provider.clear_entity_node_associations();
-            }
-            break;
-            } // switch
-        }
-    };
-
     struct ProviderHarness::State
     {
-        State() : profiler_graph(100)
+        explicit State(Provider& provider) : core(provider), profiler_graph(100)
         {
+            profiler_graph.taskName = [&provider](uint64_t id) -> const char*
+            {
+                auto it = provider._noodleNodes.find(ln_Node{ id, true });
+                return it != provider._noodleNodes.end() ? it->second.name.c_str() : "(deleted)";
+            };
         }
 
         ~State() = default;
@@ -675,23 +165,56 @@ namespace noodle {
         void update_mouse_state(Provider& provider);
         void update_hovers(Provider& provider);
         bool context_menu(Provider& provider, ImVec2 canvas_pos);
-        void run(Provider& provider, bool show_profiler, bool show_debug, bool show_ids);
-
+        void run(Provider& provider, bool show_profiler, bool show_debug, bool show_ids, bool show_deadlines, bool show_heat_map, bool show_memory);
+        void refresh_memory(Provider& provider);
+        void log_deadline_miss(Provider& provider, const DeadlineMiss& miss, float budget);
+        void deadline_window(Provider& provider);
+        void update_heat(float budget);
+        ImU32 heat_color(uint64_t node, float alpha) const;
+        void heat_window(Provider& provider);
+
+        GraphCore core;
+        FrameTimings timings;
         legit::ProfilerGraph profiler_graph;
-        CanvasGroup root;
         MouseState mouse;
         EditState edit;
         HoverState hover;
-        std::vector<Work> pending_work;
-        std::vector<legit::ProfilerTask> profiler_data;
+        std::vector<legit::ProfilerTask> profiler_data;     // one quantum's tasks
+        std::vector<QuantumTiming> quantum_timings;         // drained from the audio thread
+        std::unordered_map<uint64_t, float> node_self_time; // in the latest quantum, by entity id
+        uint64_t dropped_quanta = 0;
+        std::vector<DeadlineMiss> deadline_misses;          // drained from the audio thread
+        std::chrono::steady_clock::time_point miss_log_start;
+        int misses_logged = 0;                              // since miss_log_start
+        int misses_suppressed = 0;
+
+        // each node's self time as a fraction of the quantum's duration
+        struct NodeHeat
+        {
+            float last = 0;
+            float average = 0;      // exponential, over about heat_quanta quanta
+            float peak = 0;         // the largest in the previous window of heat_quanta quanta
+            float window_peak = 0;  // the largest in the current window
+            int window_count = 0;
+        };
+        std::unordered_map<uint64_t, NodeHeat> node_heat;
+        int heat_quanta = 256;
+        float heat_full_scale = 0.1f;   // the fraction of the budget drawn as hottest
+        int heat_sort_column = 1;
 
-        float total_profile_duration = 1; // in microseconds
+        MemoryReport memory;
+        std::chrono::steady_clock::time_point memory_time;
+        bool memory_valid = false;
+
+        bool initialized = false;
+        float total_profile_duration = 1; // in seconds
         ImGuiID main_window_id = 0;
         ImGuiID graph_interactive_region_id = 0;
     };
 
     bool ProviderHarness::State::context_menu(Provider& provider, ImVec2 canvas_pos)
     {
+        LAB_TIME_SCOPE("context_menu", "ui");
         static bool result = false;
         static ImGuiID id = ImGui::GetID(&result);
         result = false;
@@ -700,11 +223,11 @@ namespace noodle {
             ImGui::PushID(id);
             if (ImGui::MenuItem("Create Group Node"))
             {
-                Work work(provider, root);
+                Work work(provider, core.root);
                 work.type = WorkType::CreateGroup;
-                work.canvas_pos = canvas_pos;
+                work.canvas_pos = { canvas_pos.x, canvas_pos.y };
                 work.kind = "Group";
-                pending_work.emplace_back(std::move(work));
+                core.pending_work.emplace_back(std::move(work));
             }
             result = ImGui::BeginMenu("Create Node");
             if (result)
@@ -723,12 +246,12 @@ namespace noodle {
                 ImGui::EndMenu();
                 if (pressed.size() > 0)
                 {
-                    Work work(provider, root);
+                    Work work(provider, core.root);
                     work.type = WorkType::CreateNode;
-                    work.canvas_pos = canvas_pos;
+                    work.canvas_pos = { canvas_pos.x, canvas_pos.y };
                     work.kind = pressed;
                     work.group_node = hover.group_id;
-                    pending_work.emplace_back(std::move(work));
+                    core.pending_work.emplace_back(std::move(work));
                 }
             }
             ImGui::PopID();
@@ -817,20 +340,28 @@ namespace noodle {
             {
                 if (ImGui::Button("Load Audio File..."))
                 {
-                    char* file = nullptr;
-                    nfdresult_t open_result = NFD_OpenDialog("", "", &file);
-                    if (file)
+                    std::string file;
+                    if (file_dialog && *file_dialog)
+                        file = (*file_dialog)(false, "");
+                    else
+                    {
+                        char* path = nullptr;
+                        if (NFD_OpenDialog("", "", &path) == NFD_OKAY && path)
+                            file = path;
+                        free(path);
+                    }
+                    if (file.length())
                     {
                         {
                             Work work(provider, root);
                             work.setting_pin = pin_id;
-                            work.string_value.assign(file);
+                            work.string_value = file;
                             work.type = WorkType::SetBusSetting;
                             pending_work.emplace_back(std::move(work));
                         }
                         selected_pin = ln_Pin_null();
 
-                        std::string path(file);
+                        std::string path = file;
                         size_t o = path.rfind('/');
                         if (o != std::string::npos)
                             path = path.substr(++o);
@@ -966,36 +497,26 @@ namespace noodle {
 
     void ProviderHarness::State::init(Provider& provider)
     {
-        static bool once = true;
-        if (!once)
+        if (initialized)
             return;
 
-        once = false;
+        initialized = true;
         main_window_id = ImGui::GetID(&main_window_id);
         graph_interactive_region_id = ImGui::GetID(&graph_interactive_region_id);
         hover.reset_hover();
 
-        profiler_data.resize(1000);
+        profiler_data.reserve(1000);
 
         ImGuiWindow* win = ImGui::GetCurrentWindow();
         ImRect edit_rect = win->ContentRegionRect;
         float y = (edit_rect.Max.y + edit_rect.Min.y) * 0.5f - 64;
-        {
-            Work work(provider, root);
-            work.type = WorkType::CreateRuntimeContext;
-            work.canvas_pos = ImVec2{ edit_rect.Max.x - 300, y };
-            pending_work.emplace_back(std::move(work));
-        }
-        {
-            Work work(provider, root);
-            work.type = WorkType::ResetSaveWorkEpoch; // reset so that quitting immediately doesn't prompt a save
-            pending_work.emplace_back(std::move(work));
-        }
+        core.init(vec2{ edit_rect.Max.x - 300, y });
     }
 
 
     void ProviderHarness::State::update_mouse_state(Provider& provider)
     {
+        LAB_TIME_SCOPE("update_mouse_state", "ui");
         //---------------------------------------------------------------------
         // determine hovered, dragging, pressed, and released, as well as
         // window local coordinate and canvas local coordinate
@@ -1024,10 +545,10 @@ namespace noodle {
 
             if (mouse.in_canvas)
             {
-                ImVec2 o_off = { root.canvas.origin_offset_ws.x, root.canvas.origin_offset_ws.y };
+                ImVec2 o_off = { core.root.canvas.origin_offset_ws.x, core.root.canvas.origin_offset_ws.y };
 
                 mouse.mouse_ws = io.MousePos - ImGui::GetCurrentWindow()->Pos;
-                mouse.mouse_cs = (mouse.mouse_ws - o_off) / root.canvas.scale;
+                mouse.mouse_cs = (mouse.mouse_ws - o_off) / core.root.canvas.scale;
 
                 if (io.MouseDown[0] && io.MouseDownOwned[0])
                 {
@@ -1057,6 +578,7 @@ namespace noodle {
 
     void Provider::lay_out_pins()
     {
+        LAB_TIME_SCOPE("lay_out_pins", "ui");
         // may the counting begin
 
         for (auto& node : _noodleNodes)
@@ -1180,6 +702,7 @@ namespace noodle {
 
     void ProviderHarness::State::update_hovers(Provider& provider)
     {
+        LAB_TIME_SCOPE("update_hovers", "ui");
         //bool currently_hovered = _hover.node_id != ln_Node_null().id;
 
         // refresh highlights if dragging a wire, or if a node is not being dragged
@@ -1200,7 +723,7 @@ namespace noodle {
                 if (pnl == provider._pinGraphics.end())
                     continue; // can occur during constructions
 
-                if (pnl->second.pin_contains_cs_point(root.canvas, mouse_x_cs, mouse_y_cs))
+                if (pnl->second.pin_contains_cs_point(core.root.canvas, mouse_x_cs, mouse_y_cs))
                 {
                     if (pin.kind == NoodlePin::Kind::Setting)
                     {
@@ -1213,7 +736,7 @@ namespace noodle {
                         hover.node_id = pin.node_id;
                     }
                 }
-                else if (pnl->second.label_contains_cs_point(root.canvas, mouse_x_cs, mouse_y_cs))
+                else if (pnl->second.label_contains_cs_point(core.root.canvas, mouse_x_cs, mouse_y_cs))
                 {
                     if (pin.kind == NoodlePin::Kind::Setting || pin.kind == NoodlePin::Kind::Param)
                     {
@@ -1317,20 +840,20 @@ namespace noodle {
                     auto from_gpl = provider._pinGraphics.find(from_pin);
                     auto to_gpl = provider._pinGraphics.find(to_pin);
 
-                    vec2 ul_ = from_gpl->second.ul_ws(root.canvas);
+                    vec2 ul_ = from_gpl->second.ul_ws(core.root.canvas);
                     ImVec2 ul = { ul_.x, ul_.y };
-                    ImVec2 from_pos = ul + ImVec2(style_padding_y, style_padding_x) * root.canvas.scale;
+                    ImVec2 from_pos = ul + ImVec2(style_padding_y, style_padding_x) * core.root.canvas.scale;
 
-                    ul_ = to_gpl->second.ul_ws(root.canvas);
+                    ul_ = to_gpl->second.ul_ws(core.root.canvas);
                     ul = { ul_.x, ul_.y };
-                    ImVec2 to_pos = ul + ImVec2(0, style_padding_x) * root.canvas.scale;
+                    ImVec2 to_pos = ul + ImVec2(0, style_padding_x) * core.root.canvas.scale;
 
                     ImVec2 p0 = from_pos;
                     ImVec2 p3 = to_pos;
                     ImVec2 p1, p2;
-                    noodle_bezier(p0, p1, p2, p3, root.canvas.scale);
+                    noodle_bezier(p0, p1, p2, p3, core.root.canvas.scale);
 
-                    ImVec2 w_off = { root.canvas.window_origin_offset_ws.x, root.canvas.window_origin_offset_ws.y };
+                    ImVec2 w_off = { core.root.canvas.window_origin_offset_ws.x, core.root.canvas.window_origin_offset_ws.y };
 
                     ImVec2 test = mouse.mouse_ws + w_off;
                     ImVec2 closest = ImBezierCubicClosestPointCasteljau(p0, p1, p2, p3, test, 10);
@@ -1348,45 +871,319 @@ namespace noodle {
     }
 
 
-    void ProviderHarness::State::run(Provider& provider, bool show_profiler, bool show_debug, bool show_ids)
+    void ProviderHarness::State::log_deadline_miss(Provider& provider, const DeadlineMiss& miss, float budget)
     {
-        int profile_idx = 0;
+        LAB_TIME_SCOPE("log_deadline_miss", "ui");
+        // when the graph is overloaded every quantum misses, so only a few are logged each second
+        auto now = std::chrono::steady_clock::now();
+        if (now - miss_log_start > std::chrono::seconds(1))
+        {
+            if (misses_suppressed)
+                printf("%d further deadline misses were not logged\n", misses_suppressed);
+            miss_log_start = now;
+            misses_logged = 0;
+            misses_suppressed = 0;
+        }
+        if (misses_logged >= 5)
+        {
+            ++misses_suppressed;
+            return;
+        }
+        ++misses_logged;
+
+        // the quantum's timings were drained along with the miss
+        std::vector<std::pair<float, uint64_t>> slowest;
+        for (const QuantumTiming& t : quantum_timings)
+            if (t.quantum == miss.quantum && t.node != 0)
+                slowest.push_back({ t.seconds, t.node });
+        std::sort(slowest.begin(), slowest.end(), [](auto& a, auto& b) { return a.first > b.first; });
+
+        if (miss.underrun)
+            printf("quantum %llu probably underran: rendered in %.1f uS of %.1f uS, its callback began %.1f uS after the previous one, %d nodes, %d connections\n",
+                (unsigned long long) miss.quantum,
+                miss.render_seconds * 1e6f, budget * 1e6f, miss.callback_seconds * 1e6f,
+                (int) provider._noodleNodes.size(), (int) provider._connections.size());
+        else
+            printf("quantum %llu missed its deadline: rendered in %.1f uS of %.1f uS, %.1f uS after the previous quantum, %d nodes, %d connections\n",
+                (unsigned long long) miss.quantum,
+                miss.render_seconds * 1e6f, budget * 1e6f, miss.interval_seconds * 1e6f,
+                (int) provider._noodleNodes.size(), (int) provider._connections.size());
+        for (size_t i = 0; i < slowest.size() && i < 5; ++i)
+        {
+            auto node_it = provider._noodleNodes.find(ln_Node{ slowest[i].second, true });
+            printf("    %.1f uS %s\n", slowest[i].first * 1e6f,
+                node_it != provider._noodleNodes.end() ? node_it->second.name.c_str() : "(deleted)");
+        }
+    }
 
-        init(provider);
+    void ProviderHarness::State::deadline_window(Provider& provider)
+    {
+        DeadlineStatistics stats;
+        ImGui::Begin("Deadlines");
+        if (!provider.deadline_statistics(stats) || !stats.render_time)
+        {
+            ImGui::TextUnformatted("no statistics available");
+            ImGui::End();
+            return;
+        }
 
-        ImGui::BeginChild("###Noodles");
+        ImGui::Text("budget %.1f uS per quantum", stats.budget_seconds * 1e6f);
+        ImGui::Text("%llu quanta, %llu deadline misses, %llu underruns", (unsigned long long) stats.quanta,
+            (unsigned long long) stats.misses, (unsigned long long) stats.underruns);
 
-        //---------------------------------------------------------------------
-        // ensure coordinate systems are initialized properly
+        auto percentiles = [](const char* label, const DurationHistogram& h)
+        {
+            ImGui::Text("%-8s p50 %6llu  p99 %6llu  p99.9 %6llu  max %6llu uS", label,
+                (unsigned long long) h.percentile(0.5), (unsigned long long) h.percentile(0.99),
+                (unsigned long long) h.percentile(0.999), (unsigned long long) h.max());
+        };
+        percentiles("render", *stats.render_time);
+        if (stats.interval)
+            percentiles("interval", *stats.interval);
+
+        // the histogram is plotted up to the last occupied bucket, so the budget is visible in context
+        const int budget_bucket = DurationHistogram::bucket_for(static_cast<uint64_t>(stats.budget_seconds * 1e6f));
+        int last = budget_bucket + 1;
+        for (int i = 0; i < DurationHistogram::bucket_count; ++i)
+            if (stats.render_time->count(i))
+                last = std::max(last, i + 1);
+        last = std::min(last, (int) DurationHistogram::bucket_count);
+
+        float counts[DurationHistogram::bucket_count];
+        for (int i = 0; i < last; ++i)
+            counts[i] = (float) stats.render_time->count(i);
+        char overlay[64];
+        snprintf(overlay, sizeof(overlay), "0 to %llu uS", (unsigned long long) DurationHistogram::lower_bound(last - 1));
+        ImGui::PlotHistogram("render time", counts, last, 0, overlay, 0.f, FLT_MAX, ImVec2(400, 120));
+
+        if (ImGui::Button("Reset"))
+            provider.reset_deadline_statistics();
+        ImGui::End();
+    }
 
-        ImGuiIO& io = ImGui::GetIO();
-        ImGuiWindow* win = ImGui::GetCurrentWindow();
-        ImRect edit_rect = win->ContentRegionRect;
-        ImVec2 woff = ImGui::GetWindowPos() + ImGui::GetWindowContentRegionMin();
-        root.canvas.window_origin_offset_ws = { woff.x, woff.y };
-        ImVec2 ooff = { root.canvas.origin_offset_ws.x, root.canvas.origin_offset_ws.y };
+    void ProviderHarness::State::update_heat(float budget)
+    {
+        LAB_TIME_SCOPE("update_heat", "ui");
+        if (budget <= 0)
+            return;
 
-        //---------------------------------------------------------------------
-        // ensure node sizes are up to date
+        const float alpha = 2.f / (heat_quanta + 1);
+        for (const QuantumTiming& t : quantum_timings)
+        {
+            if (t.node == 0)
+                continue;
 
-        provider.lay_out_pins();
+            NodeHeat& heat = node_heat[t.node];
+            const float fraction = t.seconds / budget;
+            heat.last = fraction;
+            heat.average += alpha * (fraction - heat.average);
+            heat.window_peak = std::max(heat.window_peak, fraction);
+            if (++heat.window_count >= heat_quanta)
+            {
+                heat.peak = heat.window_peak;
+                heat.window_peak = 0;
+                heat.window_count = 0;
+            }
+        }
+    }
 
-        //---------------------------------------------------------------------
-        // Create a canvas
+    ImU32 ProviderHarness::State::heat_color(uint64_t node, float alpha) const
+    {
+        auto it = node_heat.find(node);
+        float heat = it != node_heat.end() ? it->second.average / heat_full_scale : 0.f;
+        heat = std::min(std::max(heat, 0.f), 1.f);
 
-        float height = edit_rect.Max.y - edit_rect.Min.y;
-        float width = edit_rect.Max.x - edit_rect.Min.y;
-        //- ImGui::GetTextLineHeightWithSpacing()   // space for the time bar
-        //- ImGui::GetTextLineHeightWithSpacing();  // space for horizontal scroller
-        
-        ImGui::BeginChild(main_window_id, ImVec2(0, height), false,
-            ImGuiWindowFlags_NoBringToFrontOnFocus |
-            ImGuiWindowFlags_NoMove |
-            ImGuiWindowFlags_NoScrollbar |
-            ImGuiWindowFlags_NoScrollWithMouse);
+        // from blue when idle, to red at full scale
+        return ImColor::HSV(0.66f * (1.f - heat), 0.85f, 0.9f, alpha);
+    }
 
-        //---------------------------------------------------------------------
-        // draw the grid on the canvas
+    void ProviderHarness::State::heat_window(Provider& provider)
+    {
+        struct Row
+        {
+            uint64_t node;
+            const std::string* name;
+            float average;
+            float peak;
+        };
+        std::vector<Row> rows;
+        for (auto it = node_heat.begin(); it != node_heat.end();)
+        {
+            auto node_it = provider._noodleNodes.find(ln_Node{ it->first, true });
+            if (node_it == provider._noodleNodes.end())
+            {
+                it = node_heat.erase(it);
+                continue;
+            }
+            const NodeHeat& heat = it->second;
+            rows.push_back({ it->first, &node_it->second.name, heat.average, std::max(heat.peak, heat.window_peak) });
+            ++it;
+        }
+
+        switch (heat_sort_column)
+        {
+        case 0: std::sort(rows.begin(), rows.end(), [](const Row& a, const Row& b) { return *a.name < *b.name; }); break;
+        case 1: std::sort(rows.begin(), rows.end(), [](const Row& a, const Row& b) { return a.average > b.average; }); break;
+        case 2: std::sort(rows.begin(), rows.end(), [](const Row& a, const Row& b) { return a.peak > b.peak; }); break;
+        }
+
+        ImGui::Begin("Node Heat");
+        ImGui::SliderInt("quanta", &heat_quanta, 16, 4096);
+        float full_scale = heat_full_scale * 100.f;
+        if (ImGui::SliderFloat("hottest at % of budget", &full_scale, 1.f, 100.f, "%.0f"))
+            heat_full_scale = full_scale / 100.f;
+
+        // clicking a heading sorts by that column
+        ImGui::Columns(3, "node_heat_rows");
+        const char* headings[] = { "node", "average %", "peak %" };
+        for (int i = 0; i < 3; ++i)
+        {
+            if (ImGui::Selectable(headings[i], heat_sort_column == i))
+                heat_sort_column = i;
+            ImGui::NextColumn();
+        }
+        ImGui::Separator();
+        for (const Row& row : rows)
+        {
+            ImGui::PushStyleColor(ImGuiCol_Text, heat_color(row.node, 1.f));
+            ImGui::TextUnformatted(row.name->c_str());
+            ImGui::PopStyleColor();
+            ImGui::NextColumn();
+            ImGui::Text("%.2f", row.average * 100.f);
+            ImGui::NextColumn();
+            ImGui::Text("%.2f", row.peak * 100.f);
+            ImGui::NextColumn();
+        }
+        ImGui::Columns(1);
+        ImGui::End();
+    }
+
+    void ProviderHarness::State::refresh_memory(Provider& provider)
+    {
+        auto now = std::chrono::steady_clock::now();
+        if (memory_valid && now - memory_time < std::chrono::seconds(1))
+            return;
+
+        LAB_TIME_SCOPE("memory_report", "ui");
+        provider.memory_report(memory);
+        memory_time = now;
+        memory_valid = true;
+    }
+
+    static std::string format_bytes(size_t bytes)
+    {
+        char buff[32];
+        if (bytes >= 1024 * 1024)
+            snprintf(buff, sizeof(buff), "%.1f MB", bytes / (1024.0 * 1024.0));
+        else if (bytes >= 1024)
+            snprintf(buff, sizeof(buff), "%.1f KB", bytes / 1024.0);
+        else
+            snprintf(buff, sizeof(buff), "%d B", (int) bytes);
+        return buff;
+    }
+
+    // the sites of lab_instrument.h that have been reached, by category
+    static void instrument_table()
+    {
+        if (!ImGui::CollapsingHeader("Instrumentation"))
+            return;
+#if !LAB_INSTRUMENT
+        ImGui::TextUnformatted("built without LABSOUNDGRAPHTOY_INSTRUMENT");
+#endif
+        if (ImGui::Button("Reset"))
+            instrument::reset();
+        ImGui::SameLine();
+        if (ImGui::Button("Dump"))
+            instrument::dump(stdout);
+
+        ImGui::Columns(5, "instrument_rows");
+        const char* headings[] = { "site", "count", "mean uS", "max uS", "total mS" };
+        for (const char* heading : headings)
+        {
+            ImGui::TextUnformatted(heading);
+            ImGui::NextColumn();
+        }
+        ImGui::Separator();
+        instrument::for_each([](const instrument::Site& site)
+        {
+            const uint64_t count = site.count.load(std::memory_order_relaxed);
+            if (!count)
+                return;
+            ImGui::Text("%s %s", site.category, site.name);
+            ImGui::NextColumn();
+            ImGui::Text("%llu", (unsigned long long) count);
+            ImGui::NextColumn();
+            if (site.timer)
+            {
+                const double total_us = site.total_ns.load(std::memory_order_relaxed) * 1e-3;
+                ImGui::Text("%.2f", total_us / count);
+                ImGui::NextColumn();
+                ImGui::Text("%.2f", site.max_ns.load(std::memory_order_relaxed) * 1e-3);
+                ImGui::NextColumn();
+                ImGui::Text("%.2f", total_us * 1e-3);
+                ImGui::NextColumn();
+            }
+            else
+            {
+                ImGui::NextColumn();
+                ImGui::NextColumn();
+                ImGui::NextColumn();
+            }
+        });
+        ImGui::Columns(1);
+    }
+
+    void ProviderHarness::State::run(Provider& provider, bool show_profiler, bool show_debug, bool show_ids, bool show_deadlines, bool show_heat_map, bool show_memory)
+    {
+        // each phase's time runs from the end of the previous phase
+        using clock = std::chrono::steady_clock;
+        LAB_COUNT("frames", "ui", 1);
+        const clock::time_point frame_start = clock::now();
+        clock::time_point phase_start = frame_start;
+        auto end_phase = [&phase_start](double& phase, const char* name)
+        {
+            clock::time_point now = clock::now();
+            phase = std::chrono::duration<double, std::micro>(now - phase_start).count();
+            phase_start = now;
+            LAB_RECORD_NAMED(name, "ui", phase);
+        };
+
+        init(provider);
+
+        ImGui::BeginChild("###Noodles");
+
+        //---------------------------------------------------------------------
+        // ensure coordinate systems are initialized properly
+
+        ImGuiIO& io = ImGui::GetIO();
+        ImGuiWindow* win = ImGui::GetCurrentWindow();
+        ImRect edit_rect = win->ContentRegionRect;
+        ImVec2 woff = ImGui::GetWindowPos() + ImGui::GetWindowContentRegionMin();
+        core.root.canvas.window_origin_offset_ws = { woff.x, woff.y };
+        ImVec2 ooff = { core.root.canvas.origin_offset_ws.x, core.root.canvas.origin_offset_ws.y };
+
+        //---------------------------------------------------------------------
+        // ensure node sizes are up to date
+
+        provider.lay_out_pins();
+        end_phase(timings.layout, "layout");
+
+        //---------------------------------------------------------------------
+        // Create a canvas
+
+        float height = edit_rect.Max.y - edit_rect.Min.y;
+        float width = edit_rect.Max.x - edit_rect.Min.y;
+        //- ImGui::GetTextLineHeightWithSpacing()   // space for the time bar
+        //- ImGui::GetTextLineHeightWithSpacing();  // space for horizontal scroller
+        
+        ImGui::BeginChild(main_window_id, ImVec2(0, height), false,
+            ImGuiWindowFlags_NoBringToFrontOnFocus |
+            ImGuiWindowFlags_NoMove |
+            ImGuiWindowFlags_NoScrollbar |
+            ImGuiWindowFlags_NoScrollWithMouse);
+
+        //---------------------------------------------------------------------
+        // draw the grid on the canvas
 
         ImDrawList* drawList = ImGui::GetWindowDrawList();
         drawList->ChannelsSplit((int) NoodleGraphicLayer::Count);
@@ -1394,8 +1191,8 @@ namespace noodle {
         {
             drawList->ChannelsSetCurrent((int) NoodleGraphicLayer::Grid);
 
-            const float grid_step_x = 100.0f * root.canvas.scale;
-            const float grid_step_y = 100.0f * root.canvas.scale;
+            const float grid_step_x = 100.0f * core.root.canvas.scale;
+            const float grid_step_y = 100.0f * core.root.canvas.scale;
             const ImVec2 grid_origin = ImGui::GetWindowPos();
             const ImVec2 grid_size = ImGui::GetWindowSize();
 
@@ -1435,7 +1232,7 @@ namespace noodle {
             else if (edit.selected_pin.id != ln_Pin_null().id)
             {
                 ImGui::SetNextWindowPos(mouse.initial_click_pos_ws);
-                edit.edit_pin(provider, root, edit.selected_pin, pending_work);
+                edit.edit_pin(provider, core.root, edit.selected_pin, core.pending_work);
                 mouse.dragging = false;
                 hover.node_id = ln_Node_null();
                 hover.reset_hover();
@@ -1443,7 +1240,7 @@ namespace noodle {
             else if (edit.selected_connection.id != ln_Connection_null().id)
             {
                 ImGui::SetNextWindowPos(mouse.initial_click_pos_ws);
-                edit.edit_connection(provider, root, edit.selected_connection, pending_work);
+                edit.edit_connection(provider, core.root, edit.selected_connection, core.pending_work);
                 mouse.dragging = false;
                 hover.node_id = ln_Node_null();
                 hover.reset_hover();
@@ -1451,7 +1248,7 @@ namespace noodle {
             else if (edit.selected_node.id != ln_Node_null().id)
             {
                 ImGui::SetNextWindowPos(mouse.initial_click_pos_ws);
-                edit.edit_node(provider, root, edit.selected_node, pending_work);
+                edit.edit_node(provider, core.root, edit.selected_node, core.pending_work);
                 mouse.dragging = false;
             }
             else
@@ -1522,7 +1319,7 @@ namespace noodle {
                 }
                 else
                 {
-                    Work work(provider, root);
+                    Work work(provider, core.root);
                     work.input_node = to_pin.node_id;
                     work.output_node = from_pin.node_id;
                     work.output_pin = from_pin.pin_id;
@@ -1531,7 +1328,7 @@ namespace noodle {
                         work.type = WorkType::ConnectBusOutToBusIn;
                     else if (to_kind == NoodlePin::Kind::Param)
                         work.type = WorkType::ConnectBusOutToParamIn;
-                    pending_work.emplace_back(std::move(work));
+                    core.pending_work.emplace_back(std::move(work));
                 }
             }
             mouse.resizing_node = false;
@@ -1558,17 +1355,17 @@ namespace noodle {
             {
                 if (hover.bang)
                 {
-                    Work work(provider, root);
+                    Work work(provider, core.root);
                     work.type = WorkType::Bang;
                     work.input_node = hover.node_id;
-                    pending_work.emplace_back(std::move(work));
+                    core.pending_work.emplace_back(std::move(work));
                 }
                 if (hover.play)
                 {
-                    Work work(provider, root);
+                    Work work(provider, core.root);
                     work.type = WorkType::Start;
                     work.input_node = hover.node_id;
-                    pending_work.emplace_back(std::move(work));
+                    core.pending_work.emplace_back(std::move(work));
                 }
                 if (hover.pin_id.id != ln_Pin_null().id)
                 {
@@ -1657,6 +1454,7 @@ namespace noodle {
                     gnl.ul_cs = { new_pos.x, new_pos.y };
                     new_pos = new_pos + sz;
                     gnl.lr_cs = { new_pos.x, new_pos.y };
+                    core.hash.touch_node(hover.node_id);
 
                     /// @TODO force the color to be highlighting
 
@@ -1674,6 +1472,7 @@ namespace noodle {
                                     gnl.ul_cs = { new_pos.x, new_pos.y };
                                     new_pos = new_pos + sz;
                                     gnl.lr_cs = { new_pos.x, new_pos.y };
+                                    core.hash.touch_node(i);
                                 }
                             }
                         }
@@ -1691,6 +1490,7 @@ namespace noodle {
                     gnl.lr_cs = { new_pos.x, new_pos.y };
                     gnl.lr_cs.x = std::max(gnl.ul_cs.x + 100, gnl.lr_cs.x);
                     gnl.lr_cs.y = std::max(gnl.ul_cs.y + 50, gnl.lr_cs.y);
+                    core.hash.touch_node(hover.node_id);
                 }
             }
         }
@@ -1705,7 +1505,7 @@ namespace noodle {
                     {
                         // pull the pivot around
                         ooff = mouse.canvas_clicked_pixel_offset_ws - mouse.initial_click_pos_ws + io.MousePos;
-                        root.canvas.origin_offset_ws = { ooff.x, ooff.y };
+                        core.root.canvas.origin_offset_ws = { ooff.x, ooff.y };
                     }
                 }
                 else if (mouse.in_canvas)
@@ -1713,20 +1513,22 @@ namespace noodle {
                     if (fabsf(io.MouseWheel) > 0.f)
                     {
                         // scale using where the mouse is currently hovered as the pivot
-                        float prev_scale = root.canvas.scale;
-                        root.canvas.scale += std::copysign(0.25f, io.MouseWheel);
-                        root.canvas.scale = std::max(root.canvas.scale, 0.25f);
+                        float prev_scale = core.root.canvas.scale;
+                        core.root.canvas.scale += std::copysign(0.25f, io.MouseWheel);
+                        core.root.canvas.scale = std::max(core.root.canvas.scale, 0.25f);
 
                         // solve for off2
                         // (mouse - off1) / scale1 = (mouse - off2) / scale2 
 
-                        ooff = mouse.mouse_ws - (mouse.mouse_ws - ooff) * (root.canvas.scale / prev_scale);
-                        root.canvas.origin_offset_ws = { ooff.x, ooff.y };
+                        ooff = mouse.mouse_ws - (mouse.mouse_ws - ooff) * (core.root.canvas.scale / prev_scale);
+                        core.root.canvas.origin_offset_ws = { ooff.x, ooff.y };
                     }
                 }
             }
         }
 
+        end_phase(timings.interaction, "interaction");
+
         //---------------------------------------------------------------------
         // draw graph
 
@@ -1737,8 +1539,8 @@ namespace noodle {
 
         uint32_t text_color = 0xffffff;
         uint32_t text_color_highlighted = 0x00ffff;
-        text_color |= (uint32_t)(255 * 2 * (root.canvas.scale - 0.5f)) << 24;
-        text_color_highlighted |= (uint32_t)(255 * 2 * (root.canvas.scale - 0.5f)) << 24;
+        text_color |= (uint32_t)(255 * 2 * (core.root.canvas.scale - 0.5f)) << 24;
+        text_color_highlighted |= (uint32_t)(255 * 2 * (core.root.canvas.scale - 0.5f)) << 24;
 
         ///////////////////////////////////////////
         //   Noodles Bezier Lines Curves Pulled  //
@@ -1755,20 +1557,22 @@ namespace noodle {
 
             auto from_gpl = provider._pinGraphics.find(from_pin);
             auto to_gpl = provider._pinGraphics.find(to_pin);
-            vec2 ul_ = from_gpl->second.ul_ws(root.canvas);
+            vec2 ul_ = from_gpl->second.ul_ws(core.root.canvas);
             ImVec2 ul = { ul_.x, ul_.y };
-            ImVec2 from_pos = ul + ImVec2(style_padding_y, style_padding_x) * root.canvas.scale;
+            ImVec2 from_pos = ul + ImVec2(style_padding_y, style_padding_x) * core.root.canvas.scale;
 
-            ul_ = to_gpl->second.ul_ws(root.canvas);
+            ul_ = to_gpl->second.ul_ws(core.root.canvas);
             ul = { ul_.x, ul_.y };
 
-            ImVec2 to_pos = ul + ImVec2(0, style_padding_x) * root.canvas.scale;
+            ImVec2 to_pos = ul + ImVec2(0, style_padding_x) * core.root.canvas.scale;
 
             ImVec2 p0 = from_pos;
             ImVec2 p3 = to_pos;
             ImVec2 p1, p2;
-            noodle_bezier(p0, p1, p2, p3, root.canvas.scale);
+            noodle_bezier(p0, p1, p2, p3, core.root.canvas.scale);
             ImU32 color = i.second.id.id == hover.connection_id.id ? noodle_bezier_hovered : noodle_bezier_neutral;
+            if (show_heat_map && i.second.id.id != hover.connection_id.id)
+                color = heat_color(i.second.node_to.id, 1.f);   // wires take the heat of the node they feed
             drawList->AddBezierCurve(p0, p1, p2, p3, color, 2.f);
         }
 
@@ -1776,33 +1580,102 @@ namespace noodle {
         {
             auto from_gpl = provider._pinGraphics.find(hover.originating_pin_id);
 
-            vec2 ul_ = from_gpl->second.ul_ws(root.canvas);
+            vec2 ul_ = from_gpl->second.ul_ws(core.root.canvas);
             ImVec2 ul = { ul_.x, ul_.y };
 
-            ImVec2 p0 = ul + ImVec2(style_padding_y, style_padding_x) * root.canvas.scale;
+            ImVec2 p0 = ul + ImVec2(style_padding_y, style_padding_x) * core.root.canvas.scale;
             ImVec2 p3 = mouse.mouse_ws + woff;
             ImVec2 p1, p2;
-            noodle_bezier(p0, p1, p2, p3, root.canvas.scale);
+            noodle_bezier(p0, p1, p2, p3, core.root.canvas.scale);
             ImU32 color = hover.valid_connection ? noodle_bezier_neutral : noodle_bezier_cancel;
             drawList->AddBezierCurve(p0, p1, p2, p3, color, 2.f);
         }
 
+        end_phase(timings.wires, "wires");
+
         ///////////////////////////////////////
-        //   Node Body / Drawing / Profiler  //
+        //   Profiler                        //
         ///////////////////////////////////////
 
-        total_profile_duration = provider.node_get_timing(edit._device_node);
+        // the audio thread captures every quantum, and each becomes a frame
+        // of the profiler graph, so spikes in individual quanta are visible.
+        // draining also keeps the audio thread's list of nodes up to date,
+        // which the trace and the deadline detector need, so it happens every frame.
+        // misses are drained first, so that the timings of any quantum that
+        // missed have been pushed by the time the timings are drained
+        {
+            deadline_misses.clear();
+            provider.drain_deadline_misses(deadline_misses);
 
-        for (auto& node: provider._noodleNodes)
+            uint64_t dropped = 0;
+            quantum_timings.clear();
+            provider.drain_quantum_timings(quantum_timings, dropped);
+            dropped_quanta += dropped;
+
+            if (!deadline_misses.empty())
+            {
+                DeadlineStatistics stats;
+                provider.deadline_statistics(stats);
+                for (const DeadlineMiss& miss : deadline_misses)
+                    log_deadline_miss(provider, miss, stats.budget_seconds);
+            }
+        }
+        if (show_heat_map)
         {
-            float node_profile_duration = provider.node_get_self_timing(node.second.id);
-            node_profile_duration = std::abs(node_profile_duration); /// @TODO, the destination node doesn't yet have a totalTime, so abs is a hack in the nonce
+            const float sample_rate = provider.context_sample_rate();
+            update_heat(sample_rate > 0 ? 128.f / sample_rate : 0.f);
+        }
+        if (show_profiler)
+        {
+            size_t i = 0;
+            while (i < quantum_timings.size())
+            {
+                const uint64_t quantum = quantum_timings[i].quantum;
+                profiler_data.clear();
+                double start = 0;
+                for (; i < quantum_timings.size() && quantum_timings[i].quantum == quantum; ++i)
+                {
+                    const QuantumTiming& t = quantum_timings[i];
+                    if (t.node == 0)
+                    {
+                        total_profile_duration = t.seconds;
+                        continue;
+                    }
+
+                    node_self_time[t.node] = t.seconds;
+
+                    // tasks are keyed by entity id, and named only if the legend shows them
+                    legit::ProfilerTask task;
+                    task.color = legit::colors[(t.node * 5) & 0xf]; // shuffle the colors so like colors are not together
+                    task.id = t.node;
+                    task.startTime = start;
+                    task.endTime = start + t.seconds;
+                    start = task.endTime;
+                    profiler_data.push_back(task);
+                }
+                if (!profiler_data.empty())
+                    profiler_graph.LoadFrameData(profiler_data.data(), profiler_data.size());
+            }
+        }
+        else
+            total_profile_duration = provider.node_get_timing(core.device_node);
+
+        if (show_memory)
+            refresh_memory(provider);
+
+        double profiler_bookkeeping = 0;
+        end_phase(profiler_bookkeeping, "profiler bookkeeping");
 
-            profiler_data[profile_idx].color = legit::colors[((profile_idx + 4 * profile_idx) & 0xf)]; // shuffle the colors so like colors are not together
-            profiler_data[profile_idx].name = node.second.name;
-            profiler_data[profile_idx].startTime = (profile_idx > 0) ? profiler_data[profile_idx - 1].endTime : 0;
-            profiler_data[profile_idx].endTime = profiler_data[profile_idx].startTime + provider.node_get_self_timing(edit._device_node);
-            profile_idx = (profile_idx + 1) % profiler_data.size();
+        ///////////////////////////////////////
+        //   Node Body / Drawing             //
+        ///////////////////////////////////////
+
+        for (auto& node: provider._noodleNodes)
+        {
+            float node_profile_duration = 0;
+            auto self_time_it = node_self_time.find(node.second.id.id);
+            if (self_time_it != node_self_time.end())
+                node_profile_duration = self_time_it->second;
 
             auto gnl_it = provider._nodeGraphics.find(node.second.id);
             if (gnl_it != provider._nodeGraphics.end()) {
@@ -1812,11 +1685,13 @@ namespace noodle {
                 ImVec2 ul_ws = { gnl.ul_cs.x, gnl.ul_cs.y };
                 ImVec2 lr_ws = { gnl.lr_cs.x, gnl.lr_cs.y };
 
-                ul_ws = woff + ul_ws * root.canvas.scale + ooff;
-                lr_ws = woff + lr_ws * root.canvas.scale + ooff;
+                ul_ws = woff + ul_ws * core.root.canvas.scale + ooff;
+                lr_ws = woff + lr_ws * core.root.canvas.scale + ooff;
 
                 // draw node
                 drawList->AddRectFilled(ul_ws, lr_ws, node_background_fill, node_border_radius);
+                if (show_heat_map)
+                    drawList->AddRectFilled(ul_ws, lr_ws, heat_color(node.second.id.id, 0.5f), node_border_radius);
                 drawList->AddRect(ul_ws, lr_ws, (hover.node_id.id == node.second.id.id) ? node_outline_hovered : node_outline_neutral, node_border_radius, 15, 2);
 
                 if (gnl.group)
@@ -1829,28 +1704,41 @@ namespace noodle {
                 if (show_profiler)
                 {
                     ImVec2 p1{ ul_ws.x, lr_ws.y };
-                    ImVec2 p2{ lr_ws.x, lr_ws.y + root.canvas.scale * style_padding_y };
+                    ImVec2 p2{ lr_ws.x, lr_ws.y + core.root.canvas.scale * style_padding_y };
                     drawList->AddRect(p1, p2, ImColor(128, 255, 128, 255));
                     p2.x = p1.x + (p2.x - p1.x) * node_profile_duration / total_profile_duration;
                     drawList->AddRectFilled(p1, p2, ImColor(255, 255, 255, 128));
                 }
 
+                if (show_memory && core.root.canvas.scale > 0.5f)
+                {
+                    // below the profiler's bar, if it is shown
+                    auto it = memory.nodes.find(node.second.id.id);
+                    if (it != memory.nodes.end())
+                    {
+                        std::string label = format_bytes(it->second.audio) + " audio, " + format_bytes(it->second.bookkeeping) + " editor";
+                        ImVec2 pos{ ul_ws.x, lr_ws.y + (show_profiler ? core.root.canvas.scale * style_padding_y : 0.f) };
+                        drawList->AddText(NULL, style_padding_y * core.root.canvas.scale * 0.75f, pos, text_color,
+                            label.c_str(), label.c_str() + label.length());
+                    }
+                }
+
                 if (node.second.render.render)
                 {
                     node.second.render.render(node.second.id,
                         { ul_ws.x, ul_ws.y }, { lr_ws.x, lr_ws.y },
-                        root.canvas.scale, drawList);
+                        core.root.canvas.scale, drawList);
                 }
 
                 ///////////////////////////////////////////
                 //   Node Header / Banner / Top / Menu   //
                 ///////////////////////////////////////////
 
-                if (root.canvas.scale > 0.5f)
+                if (core.root.canvas.scale > 0.5f)
                 {
-                    const float label_font_size = style_padding_y * root.canvas.scale;
+                    const float label_font_size = style_padding_y * core.root.canvas.scale;
                     ImVec2 label_pos = ul_ws;
-                    label_pos.y -= 20 * root.canvas.scale;
+                    label_pos.y -= 20 * core.root.canvas.scale;
 
                     // UI elements
                     if (node.second.play_controller)
@@ -1929,19 +1817,19 @@ namespace noodle {
 
                 auto pin_gpl = provider._pinGraphics.find(j);
 
-                vec2 ul_ = pin_gpl->second.ul_ws(root.canvas);
+                vec2 ul_ = pin_gpl->second.ul_ws(core.root.canvas);
                 ImVec2 pin_ul = { ul_.x, ul_.y };
                 uint32_t fill = (j.id == hover.pin_id.id || j.id == hover.originating_pin_id.id) ? 0xffffff : 0x000000;
                 fill |= (uint32_t)(128 + 128 * sinf(pulse * 8)) << 24;
 
                 DrawIcon(drawList, pin_ul,
-                    ImVec2{ pin_ul.x + NoodlePinGraphic::k_width() * root.canvas.scale, pin_ul.y + NoodlePinGraphic::k_height() * root.canvas.scale },
+                    ImVec2{ pin_ul.x + NoodlePinGraphic::k_width() * core.root.canvas.scale, pin_ul.y + NoodlePinGraphic::k_height() * core.root.canvas.scale },
                     icon_type, false, color, fill);
 
                 // Only draw text if we can likely see it
-                if (root.canvas.scale > 0.5f)
+                if (core.root.canvas.scale > 0.5f)
                 {
-                    float font_size = style_padding_y * root.canvas.scale;
+                    float font_size = style_padding_y * core.root.canvas.scale;
                     ImVec2 label_pos = pin_ul;
 
                     if (show_ids)
@@ -1956,7 +1844,7 @@ namespace noodle {
 
 
                     label_pos.y += 2;
-                    label_pos.x += 20 * root.canvas.scale;
+                    label_pos.x += 20 * core.root.canvas.scale;
 
                     if (pin_it.shortName.size())
                     {
@@ -1968,7 +1856,7 @@ namespace noodle {
                     {
                         if (pin_it.kind == NoodlePin::Kind::BusOut)
                         {
-                            label_pos.x -= (ImGui::CalcTextSize(pin_it.name.c_str()).x + 30) * root.canvas.scale;
+                            label_pos.x -= (ImGui::CalcTextSize(pin_it.name.c_str()).x + 30) * core.root.canvas.scale;
                         }
                         drawList->AddText(NULL, font_size, label_pos, text_color,
                             pin_it.name.c_str(), pin_it.name.c_str() + pin_it.name.length());
@@ -1976,16 +1864,26 @@ namespace noodle {
 
                     if (has_value)
                     {
-                        label_pos.x += 50 * root.canvas.scale;
+                        label_pos.x += 50 * core.root.canvas.scale;
                         drawList->AddText(NULL, font_size, label_pos, text_color,
                             pin_it.value_as_string.c_str(), pin_it.value_as_string.c_str() + pin_it.value_as_string.length());
                     }
                 }
 
-                pin_ul.y += 20 * root.canvas.scale;
+                pin_ul.y += 20 * core.root.canvas.scale;
             }
         }
 
+        // the totals, in the canvas's corner
+        if (show_memory)
+        {
+            drawList->ChannelsSetCurrent((int) NoodleGraphicLayer::Nodes);
+            char buff[128];
+            snprintf(buff, sizeof(buff), "memory: %s audio, %s editor, %d nodes",
+                format_bytes(memory.audio).c_str(), format_bytes(memory.bookkeeping).c_str(), (int) memory.nodes.size());
+            drawList->AddText(ImGui::GetWindowPos() + ImVec2(8, 8), 0xffffffff, buff);
+        }
+
         // finish
 
         drawList->ChannelsMerge();
@@ -2026,25 +1924,41 @@ namespace noodle {
             ImGui::End();
         }
 
+        end_phase(timings.nodes, "nodes");
+
         if (show_profiler)
         {
+            // the graph's full height is the quantum's duration, the time available to render it
+            const float sample_rate = provider.context_sample_rate();
+            const float quantum_budget = sample_rate > 0 ? 128.f / sample_rate : 0.000005f;
+
             ImGui::Begin("Profiler");
-            profiler_graph.LoadFrameData(&profiler_data[0], profile_idx);
-            profiler_graph.RenderTimings(400, 300, 200, 0.000005f, 0);// std::max(0, profile_idx - 100));
+            ImGui::Text("quantum %.1f uS of %.1f uS, %llu quanta dropped", total_profile_duration * 1e6f,
+                quantum_budget * 1e6f, (unsigned long long) dropped_quanta);
+            profiler_graph.RenderTimings(400, 300, 200, quantum_budget, 0);
+            instrument_table();
             ImGui::End();
         }
+        if (show_deadlines)
+            deadline_window(provider);
+        if (show_heat_map)
+            heat_window(provider);
         ImGui::EndChild();
 
-        for (Work& work : pending_work)
-            work.eval(edit);
+        end_phase(timings.profiler, "profiler");
+        timings.profiler += profiler_bookkeeping;
+
+        core.process_pending_work();
+        end_phase(timings.work, "work");
 
-        pending_work.clear();
+        timings.total = std::chrono::duration<double, std::micro>(clock::now() - frame_start).count();
     }
 
 
     ProviderHarness::ProviderHarness(Provider& p)
-        : provider(p), _s(new State)
+        : provider(p), _s(new State(p))
     {
+        _s->edit.file_dialog = &file_dialog;
         _s->init(p);
     }
 
@@ -2056,570 +1970,94 @@ namespace noodle {
 
     bool ProviderHarness::run()
     {
-        _s->run(provider, show_profiler, show_debug, show_ids);
+        _s->run(provider, show_profiler, show_debug, show_ids, show_deadlines, show_heat_map, show_memory);
         return true;
     }
 
-    void ProviderHarness::save(const std::string& path)
+    GraphCore& ProviderHarness::core()
     {
-        save_json(path);
+        return _s->core;
     }
-    
-    void ProviderHarness::export_cpp(const std::string& path)
-    {
-        using lab::noodle::NoodlePin;
-        
-        auto clean_name = [](const std::string& s) -> std::string
-        {
-            std::string res = s;
-            int len = (int) s.size();
-            for (int i = 0; i < len; ++i)
-            {
-                char c = s[i];
-                if ((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'))
-                    continue;
-                res[i] = '_';
-            }
-            return res;
-        };
-        
-        std::ofstream file(path, std::ios::binary);
-        
-        file << "// " << path;
-        file << R"(
-
-// Automatic export from LabSoundGraphToy, output is licensed under BSD-2 clause.
-
-#include <LabSound/LabSound.h>
-#include <memory>
-
-void create_graph(lab::AudioContext& ctx)
-{
-    // Nodes:
-            
-)";
-        for (auto& node : provider._noodleNodes)
-        {
-            std::string node_name_clean = clean_name(node.second.name);
-            file << "\n    //--------------------\n    // Node: "
-                 << node.second.name << " Kind: " << node.second.kind << "\n";
-            file << "    std::shared_ptr<" << node.second.kind << "Node> "
-                 << node_name_clean << " = std::make_shared<" << node.second.kind << "Node>(ac);\n";
-
-            auto gnl_it = provider._nodeGraphics.find(node.second.id);
-            if (gnl_it != provider._nodeGraphics.end())
-            {
-                NoodleNodeGraphic& gnl = gnl_it->second;
-                file << "    // position: " << gnl.ul_cs.x << ", " << gnl.ul_cs.y << "\n\n";
-            }
-
-            file << "    // Pins:\n\n";
-            for (const ln_Pin& entity : node.second.pins)
-            {
-                auto pin_it = provider._noodlePins.find(entity);
-                if (pin_it == provider._noodlePins.end())
-                    continue;
-
-                NoodlePin& pin = pin_it->second;
-
-                switch (pin.kind)
-                {
-                case NoodlePin::Kind::BusIn:
-                    break;
-
-                case NoodlePin::Kind::BusOut:
-                    file << "    // bus out: " << pin.name << "\n";
-                    break;
-
-                case NoodlePin::Kind::Param:
-                    file << "    // param\n";
-                    file << "    {\n        auto param = " << node_name_clean << "->param(" << pin.name << ");\n";
-                    file << "        if (param)\n        {\n            param->setValue(" << pin.value_as_string << ");\n        }\n    }\n";
-                    break;
-
-                case NoodlePin::Kind::Setting:
-                    file << "    // setting\n";
-                    file << "    {\n        auto setting = " << node_name_clean << "->setting(" << pin.name << ");\n";
-                    file << "        if (setting)\n        {\n";
-                    switch (pin.dataType)
-                    {
-                    default:
-                    case NoodlePin::DataType::None: break;
-                    case NoodlePin::DataType::Bus: break;
-                    case NoodlePin::DataType::Bool: file <<        "            setting->setBool(" << pin.value_as_string << ");\n        }\n"; break;
-                    case NoodlePin::DataType::Integer: file <<     "            setting->setUint32(" << pin.value_as_string << ");\n        }\n"; break;
-                    case NoodlePin::DataType::Enumeration: file << "            setting->setEnumeration(\"" << pin.value_as_string << "\");\n        }\n"; break;
-                    case NoodlePin::DataType::Float: file <<       "            setting->setFloat(" << pin.value_as_string << ");\n        }\n"; break;
-                    case NoodlePin::DataType::String: file <<      "            setting->setString(\"" << pin.value_as_string << "\");\n        }\n"; break;
-                    }
-                    file << "    }\n";
-                    break;
-                }
-            }
-        } // node loop
-
-        file << "    // Connections:\n\n";
-        for (const auto& connection : provider._connections)
-        {
-            ln_Pin from_pin = provider.copy(connection.second.pin_from);
-            ln_Pin to_pin = provider.copy(connection.second.pin_to);
-            if (!from_pin.valid || !to_pin.valid)
-                continue;
-
-            auto from_node = provider._noodleNodes.find(connection.second.node_from);
-            if (from_node == provider._noodleNodes.end())
-                continue;
-            std::string from_node_name = from_node->second.name;
-            auto to_node = provider._noodleNodes.find(connection.second.node_to);
-            if (to_node == provider._noodleNodes.end())
-                continue;
-            std::string to_node_name = to_node->second.name;
-
-            auto pin_it = provider._noodlePins.find(to_pin);
-            if (pin_it == provider._noodlePins.end())
-                continue;
 
-            NoodlePin pin = pin_it->second;
-
-            std::string to_pin_name = pin.name;
-
-            if (connection.second.kind == NoodleConnection::Kind::ToParam)
-            {
-                // @TODO - the context needs a named output -> param API
-                file << "    ctx->connectParam(" << clean_name(from_node_name) 
-                     << ", \"" << to_pin_name << "\", " << clean_name(to_node_name) << ", 0);\n";
-            }
-            else
-            {
-                // @TODO - the context needs a named output -> input connection API
-                file << "    ctx->connect(" << clean_name(from_node_name) 
-                     << ", " << clean_name(to_node_name) << ", 0, 0);\n";
-            }
-        }
-        file << "}\n" << std::endl;
-        file.close();
+    const MemoryReport& ProviderHarness::memory_report()
+    {
+        _s->refresh_memory(provider);
+        return _s->memory;
     }
 
-    void ProviderHarness::save_test(const std::string& path)
+    uint64_t ProviderHarness::dropped_quanta() const
     {
-        /// @TODO this is a prototype file format, meant to debug actually writing valuable data
-        /// The format could be something else entirely, this routine should be treated more
-        /// like a prototype template that can be duplicated for a new format.
-
-        // Note: this code uses \n because std::endl has other behaviors
-        using lab::noodle::NoodlePin;
-
-        std::ofstream file(path, std::ios::binary);
-        file << "#!LabSoundGraphToy\n";
-        file << "# " << path << "\n";
-        for (auto& node : provider._noodleNodes)
-        {
-            file << "node: " << node.second.kind << " name: " << node.second.name << "\n";
-
-            auto gnl_it = provider._nodeGraphics.find(node.second.id);
-            if (gnl_it != provider._nodeGraphics.end())
-            {
-                NoodleNodeGraphic& gnl = gnl_it->second;
-                file << " pos: " << gnl.ul_cs.x << " " << gnl.ul_cs.y << "\n";
-            }
-
-            for (const ln_Pin& entity : node.second.pins)
-            {
-                auto pin_it = provider._noodlePins.find(entity);
-                if (pin_it == provider._noodlePins.end())
-                    continue;
-                NoodlePin pin = pin_it->second;
-
-                switch (pin.kind)
-                {
-                case NoodlePin::Kind::BusIn:
-                    break;
-                case NoodlePin::Kind::BusOut:
-                    file << " out: " << pin.name << "\n";
-                    break;
-
-                case NoodlePin::Kind::Param:
-                    file << " param: " << pin.name << " " << pin.value_as_string << "\n";
-                    break;
-                case NoodlePin::Kind::Setting:
-                    file << " setting: " << pin.name << " ";
-                    switch (pin.dataType)
-                    {
-                    case NoodlePin::DataType::None: file << "None "; break;
-                    case NoodlePin::DataType::Bus: file << "Bus "; break;
-                    case NoodlePin::DataType::Bool: file << "Bool "; break;
-                    case NoodlePin::DataType::Integer: file << "Integer "; break;
-                    case NoodlePin::DataType::Enumeration: file << "Enumeration "; break;
-                    case NoodlePin::DataType::Float: file << "Float "; break;
-                    case NoodlePin::DataType::String: file << "String "; break;
-                    }
-                    file << pin.value_as_string << "\n";
-                    break;
-                }
-            }
-        }
-
-        for (auto const& connection : provider._connections)
-        {
-            ln_Pin from_pin = provider.copy(connection.second.pin_from);
-            ln_Pin to_pin = provider.copy(connection.second.pin_to);
-            if (!from_pin.valid || !to_pin.valid)
-                continue;
+        return _s->dropped_quanta;
+    }
 
+    const ProviderHarness::FrameTimings& ProviderHarness::frame_timings() const
+    {
+        return _s->timings;
+    }
 
-            auto from_node = provider._noodleNodes.find(connection.second.node_from);
-            if (from_node == provider._noodleNodes.end())
-                continue;
-            std::string from_node_name = from_node->second.name;
-            auto to_node = provider._noodleNodes.find(connection.second.node_to);
-            if (to_node == provider._noodleNodes.end())
-                continue;
-            std::string to_node_name = to_node->second.name;
+    bool ProviderHarness::needs_saving() const
+    {
+        return _s->core.needs_saving();
+    }
 
-            auto pin_it = provider._noodlePins.find(from_pin);
-            if (pin_it == provider._noodlePins.end())
-                continue;
-            NoodlePin pin = pin_it->second;
+    uint64_t ProviderHarness::content_hash() const
+    {
+        return _s->core.content_hash();
+    }
 
-            std::string from_pin_name = pin.name;
+    std::string ProviderHarness::canonical_serialization() const
+    {
+        return _s->core.canonical_serialization();
+    }
 
-            file << " + " << from_node_name << ":" << from_pin_name <<
-                " -> " << to_node_name << ":" << to_node_name << "\n";
-        }
+    void ProviderHarness::save(const std::string& path)
+    {
+        save_json(path);
+    }
 
-        file.flush();
-        _s->edit.unify_epochs();
+    void ProviderHarness::apply_device_settings(const AudioDeviceSettings& settings)
+    {
+        _s->core.apply_device_settings(settings);
     }
 
     void ProviderHarness::save_json(const std::string& path)
     {
-        using lab::noodle::NoodlePin;
-        using StringBuffer = rapidjson::StringBuffer;
-        using Writer = rapidjson::Writer<StringBuffer>;
-
-        StringBuffer s;
-        Writer writer(s);
-        writer.StartObject();
-        writer.Key("LabSoundGraphToy");
-        writer.StartObject();
-        writer.Key("nodes");
-        writer.StartArray();
-
-        for (auto& node : provider._noodleNodes)
-        {
-            writer.StartObject();
-
-            writer.Key("name");
-            writer.String(node.second.name.c_str());
-            writer.Key("kind");
-            writer.String(node.second.kind.c_str());
-
-            auto gnl_it = provider._nodeGraphics.find(node.second.id);
-            if (gnl_it != provider._nodeGraphics.end())
-            {
-                NoodleNodeGraphic& gnl = gnl_it->second;
-                writer.Key("pos");
-                writer.StartArray();
-                writer.Double(gnl.ul_cs.x);
-                writer.Double(gnl.ul_cs.y);
-                writer.EndArray();
-            }
-
-            writer.Key("pins");
-            writer.StartArray();
-            for (const ln_Pin& entity : node.second.pins)
-            {
-                auto pin_it = provider._noodlePins.find(entity);
-                if (pin_it == provider._noodlePins.end())
-                    continue;
-
-                NoodlePin pin = pin_it->second;
-
-                switch (pin.kind)
-                {
-                case NoodlePin::Kind::BusIn:
-                    break;
-
-                case NoodlePin::Kind::BusOut:
-                    writer.StartObject();
-                    writer.Key("kind");
-                    writer.String("bus_out");
-                    writer.Key("name");
-                    writer.String(pin.name.c_str());
-                    writer.EndObject();
-                    break;
-
-                case NoodlePin::Kind::Param:
-                    writer.StartObject();
-                    writer.Key("kind");
-                    writer.String("param");
-                    writer.Key("name");
-                    writer.String(pin.name.c_str());
-                    writer.Key("value");
-                    writer.String(pin.value_as_string.c_str());
-                    writer.EndObject();
-                    break;
-
-                case NoodlePin::Kind::Setting:
-                    writer.StartObject();
-                    writer.Key("kind");
-                    writer.String("setting");
-                    writer.Key("name");
-                    writer.String(pin.name.c_str());
-                    writer.Key("value");
-                    writer.String(pin.value_as_string.c_str());
-                    writer.Key("type");
-                    switch (pin.dataType)
-                    {
-                    default:
-                    case NoodlePin::DataType::None: writer.String("None"); break;
-                    case NoodlePin::DataType::Bus: writer.String("Bus"); break;
-                    case NoodlePin::DataType::Bool: writer.String("Bool"); break;
-                    case NoodlePin::DataType::Integer: writer.String("Integer"); break;
-                    case NoodlePin::DataType::Enumeration: writer.String("Enumeration"); break;
-                    case NoodlePin::DataType::Float: writer.String("Float"); break;
-                    case NoodlePin::DataType::String: writer.String("String"); break;
-                    }
-                    writer.EndObject();
-                    break;
-                }
-            }
-            writer.EndArray();
-
-            writer.EndObject(); // node
-        }
-
-        writer.EndArray(); // nodes
-
-        writer.Key("connections");
-        writer.StartArray();
-
-        for (const auto& connection : provider._connections)
-        {
-            ln_Pin from_pin = provider.copy(connection.second.pin_from);
-            ln_Pin to_pin = provider.copy(connection.second.pin_to);
-            if (!from_pin.valid || !to_pin.valid)
-                continue;
-
-            auto from_node = provider._noodleNodes.find(connection.second.node_from);
-            if (from_node == provider._noodleNodes.end())
-                continue;
-            std::string from_node_name = from_node->second.name;
-            auto to_node = provider._noodleNodes.find(connection.second.node_to);
-            if (to_node == provider._noodleNodes.end())
-                continue;
-            std::string to_node_name = to_node->second.name;
-
-            auto to_pin_it = provider._noodlePins.find(to_pin);
-            if (to_pin_it == provider._noodlePins.end())
-                continue;
-
-            NoodlePin to_pin_ = to_pin_it->second;
-
-            std::string to_pin_name = to_pin_.name;
-
-            auto from_pin_it = provider._noodlePins.find(from_pin);
-            if (from_pin_it == provider._noodlePins.end())
-                continue;
-
-            NoodlePin from_pin_ = from_pin_it->second;
-
-            std::string from_pin_name = from_pin_.name;
-
-            writer.StartObject();
-            writer.Key("from_node");
-            writer.String(from_node_name.c_str());
-            writer.Key("from_pin");
-            writer.String(from_pin_name.c_str());
-            writer.Key("to_node");
-            writer.String(to_node_name.c_str());
-            writer.Key("to_pin");
-            writer.String(to_pin_name.c_str());
-            writer.Key("to_pin_kind");
-            if (connection.second.kind == NoodleConnection::Kind::ToParam)
-                writer.String("param");
-            else
-                writer.String("bus");
-            writer.EndObject();
-        }
-        writer.EndArray(); // connections
-
-        writer.EndObject(); // LabSoundGraphToy
-        writer.EndObject(); // outer scope
+        _s->core.save_json(path);
+    }
 
-        std::ofstream file(path, std::ios::binary);
-        file << s.GetString();
-        file.flush();
+    void ProviderHarness::save_bundle(const std::string& path)
+    {
+        _s->core.save_bundle(path);
+    }
 
-        _s->edit.unify_epochs();
+    void ProviderHarness::save_test(const std::string& path)
+    {
+        _s->core.save_test(path);
     }
 
     void ProviderHarness::load(const std::string& path)
     {
-        {
-            Work work(provider, _s->root);
-            work.type = WorkType::ClearScene;
-            _s->pending_work.emplace_back(std::move(work));
-        }
-
-        bool load_succeeded = true;
-
-        std::vector<uint8_t> str = read_file_binary(path);
-        str.push_back('\0');
-
-        rapidjson::Document d;
-        d.Parse(reinterpret_cast<const char*>(str.data()));
-
-        auto& dom = d["LabSoundGraphToy"];
-        auto root = dom.GetObject();
-
-        // create all the nodes
-
-        auto& nodes_root = root["nodes"];
-        auto nodes_array = nodes_root.GetArray();
-        for (auto& node : nodes_array)
-        {
-            std::string node_name = node["name"].GetString();
-            {
-                Work work(provider, _s->root);
-                work.type = WorkType::CreateNode;
-                work.name = node_name;
-                work.kind = node["kind"].GetString();
-                work.group_node = ln_Node_null();
-                auto pos_array = node["pos"].GetArray();
-                float x = pos_array[0].GetFloat();
-                float y = pos_array[1].GetFloat();
-                work.canvas_pos = { x, y };
-                _s->pending_work.emplace_back(std::move(work));
-            }
-
-            auto pins_array = node["pins"].GetArray();
-            for (auto& pin_root : pins_array)
-            {
-                std::string name = pin_root["name"].GetString();
-                std::string kind = node["kind"].GetString();
-                std::string value;
-                auto it = node.FindMember("value");
-                if (it != node.MemberEnd())
-                {
-                    value = it->value.GetString();
-                }
-                if (kind == "param")
-                {
-                    if (value.length() > 0)
-                    {
-                        Work work(provider, _s->root);
-                        work.name = name;
-                        work.kind = node_name;
-                        work.param_pin = ln_Pin_null();
-                        work.type = WorkType::SetParam;
-                        work.float_value = static_cast<float>(std::atof(value.c_str()));
-                        _s->pending_work.emplace_back(std::move(work));
-                    }
-                }
-                else if (kind == "setting")
-                {
-                    if (value.length() > 0)
-                    {
-                        std::string type = node["type"].GetString();
-                        if (type == "None") {}
-                        else if (type == "Bus") {}
-                        else if (type == "Bool") 
-                        {
-                            Work work(provider, _s->root);
-                            work.name = name;
-                            work.kind = node_name;
-                            work.setting_pin = ln_Pin_null();
-                            work.type = WorkType::SetBoolSetting;
-                            work.bool_value = value == "True";
-                            _s->pending_work.emplace_back(std::move(work));
-                        }
-                        else if (type == "Integer") 
-                        {
-                            Work work(provider, _s->root);
-                            work.name = name;
-                            work.kind = node_name;
-                            work.setting_pin = ln_Pin_null();
-                            work.type = WorkType::SetIntSetting;
-                            work.int_value = std::atoi(value.c_str());
-                            _s->pending_work.emplace_back(std::move(work));
-                        }
-                        else if (type == "Enumeration") 
-                        {
-                            Work work(provider, _s->root);
-                            work.name = name;
-                            work.kind = node_name;
-                            work.setting_pin = ln_Pin_null();
-                            work.type = WorkType::SetEnumerationSetting;
-                            work.string_value = value;
-                            _s->pending_work.emplace_back(std::move(work));
-                        }
-                        else if (type == "Float") 
-                        {
-                            Work work(provider, _s->root);
-                            work.name = name;
-                            work.kind = node_name;
-                            work.setting_pin = ln_Pin_null();
-                            work.type = WorkType::SetFloatSetting;
-                            work.float_value = static_cast<float>(std::atof(value.c_str()));
-                            _s->pending_work.emplace_back(std::move(work));
-                        }
-                        else if (type == "String")
-                        {
-                        }
-                    }
-                }
-                else if (kind == "bus_out")
-                {
-                    Work work(provider, _s->root);
-                    work.name = name;
-                    work.kind = node_name;
-                    work.setting_pin = ln_Pin_null();
-                    work.type = WorkType::CreateOutput;
-                    work.int_value = 1;     /// @TODO save the channel count in the save path
-                    _s->pending_work.emplace_back(std::move(work));
-                }
-            }
-        }
-
-        // make all the connections
-
-        auto& connections_root = root["connections"];
-        auto connections_array = connections_root.GetArray();
-        for (auto& node : connections_array)
-        {
-            Work work(provider, _s->root);
-            work.pendingConnection = std::make_unique<WorkPendingConnection>();
-            work.pendingConnection->from_node = node["from_node"].GetString();
-            work.pendingConnection->from_pin = node["from_pin"].GetString();
-            work.pendingConnection->to_node = node["to_node"].GetString();
-            work.pendingConnection->to_pin = node["to_pin"].GetString();
-            work.pendingConnection->to_pin_kind = node["to_pin_kind"].GetString();
-
-            if (work.pendingConnection->to_pin_kind == "bus")
-                work.type = WorkType::ConnectBusOutToBusIn;
-            else
-                work.type = WorkType::ConnectBusOutToParamIn;
+        _s->core.load(path);
+    }
 
-            _s->pending_work.emplace_back(std::move(work));
-        }
+    void ProviderHarness::load_bundle(const std::string& path)
+    {
+        _s->core.load_bundle(path);
+    }
 
-        if (load_succeeded)
-        {
-            _s->edit.reset_epochs();
-        }
+    void ProviderHarness::export_cpp(const std::string& path)
+    {
+        _s->core.export_cpp(path);
     }
 
-    bool ProviderHarness::needs_saving() const
+    void ProviderHarness::export_cpp_static(const std::string& path, bool with_benchmark)
     {
-        return _s->edit.need_saving();
+        _s->core.export_cpp_static(path, with_benchmark);
     }
 
     void ProviderHarness::clear_all()
     {
-        Work work(provider, _s->root);
-        work.type = WorkType::ClearScene;
-        _s->pending_work.emplace_back(std::move(work));
+        _s->core.clear_all();
     }
-
+    
 }} // lab::noodle
@@ -85,6 +85,89 @@ namespace lab { namespace noodle {
     struct vec2 { float x, y; };
 
     struct ProviderHarness;
+    struct GraphCore;
+    struct BusData;
+    struct BundleSample;
+    class DurationHistogram;
+
+    // the audio device a runtime context opens, saved with the patch.
+    // empty device names, and zero values, select the system's defaults.
+    struct AudioDeviceSettings
+    {
+        std::string output_device;
+        std::string input_device;
+        bool with_input = true;
+        float sample_rate = 0;
+        int output_channels = 0;
+        int input_channels = 0;
+
+        bool operator==(const AudioDeviceSettings& rh) const
+        {
+            return output_device == rh.output_device && input_device == rh.input_device &&
+                with_input == rh.with_input && sample_rate == rh.sample_rate &&
+                output_channels == rh.output_channels && input_channels == rh.input_channels;
+        }
+        bool operator!=(const AudioDeviceSettings& rh) const { return !(*this == rh); }
+    };
+
+    // the time one node spent in one render quantum, excluding the time
+    // spent rendering its inputs. The entry for node zero, which is never an
+    // entity, holds the time the whole quantum took.
+    struct QuantumTiming
+    {
+        uint64_t quantum = 0;   // render quanta since the context started
+        uint64_t node = 0;      // the node's entity id
+        float seconds = 0;
+    };
+
+    // a render quantum that took longer to render than it lasts
+    struct DeadlineMiss
+    {
+        uint64_t quantum = 0;
+        float render_seconds = 0;   // time taken to render the quantum
+        float interval_seconds = 0; // time since the previous quantum was rendered
+        float callback_seconds = 0; // time since the previous callback began, when this quantum began a callback
+        bool underrun = false;      // the callback began late enough that the device likely ran dry
+    };
+
+    struct DeadlineStatistics
+    {
+        float budget_seconds = 0;   // the duration of a quantum
+        uint64_t quanta = 0;
+        uint64_t misses = 0;
+        uint64_t underruns = 0;
+
+        // in microseconds, owned by the provider
+        const DurationHistogram* render_time = nullptr;
+        const DurationHistogram* interval = nullptr;
+    };
+
+    // memory in bytes. Audio memory is what the audio engine reports the
+    // node as owning; bookkeeping is an estimate of the editor's and the
+    // provider's records of it, including its pins.
+    struct NodeMemory
+    {
+        size_t audio = 0;
+        size_t bookkeeping = 0;
+    };
+
+    struct MemoryReport
+    {
+        std::map<uint64_t, NodeMemory> nodes;   // by entity id
+        size_t audio = 0;
+        size_t bookkeeping = 0;                 // including connections, which belong to no node
+    };
+
+    struct AudioDeviceDescription
+    {
+        std::string name;
+        int input_channels = 0;
+        int output_channels = 0;
+        std::vector<float> sample_rates;
+        float nominal_sample_rate = 0;
+        bool default_input = false;
+        bool default_output = false;
+    };
 
 
     // Some nodes may have overridden draw methods, such as the LabSound 
@@ -121,10 +204,6 @@ namespace lab { namespace noodle {
         NodeRender render;
     };
 
-    // given a proposed name, of the form name, or name-1 create a new
-    // unique name of the form name-2.
-    std::string unique_name(std::string proposed_name);
-
     // pins have kind. Settings can't be connected to.
     // Busses carry signals, and parameters parameterize a node.
     // Busses can connect to parameters to drive them.
@@ -143,6 +222,7 @@ namespace lab { namespace noodle {
         ln_Node      node_id = ln_Node_null();
         std::string  value_as_string;
         char const* const* names = nullptr; // if an DataType is Enumeration, they'll be here
+        std::string  source;                // if a DataType is Bus, the file or bundle address it was loaded from
     };
 
     // PinEdit provides a mechanism by which a pin can
@@ -244,6 +324,8 @@ namespace lab { namespace noodle {
         void lay_out_pins();
 
         friend struct Work;
+        friend struct GraphCore;
+        friend struct ContentHash;
         friend struct ProviderHarness;
         friend struct EditState;
         std::map<std::string, ln_Node> _name_to_entity;
@@ -281,6 +363,21 @@ namespace lab { namespace noodle {
             return &it->second;
         }
 
+        // layout is brought up to date each time the editor runs
+        NoodleNodeGraphic const* const find_node_graphic(ln_Node n) {
+            auto it = _nodeGraphics.find(n);
+            if (it == _nodeGraphics.end())
+                return nullptr;
+            return &it->second;
+        }
+
+        NoodlePinGraphic const* const find_pin_graphic(ln_Pin p) {
+            auto it = _pinGraphics.find(p);
+            if (it == _pinGraphics.end())
+                return nullptr;
+            return &it->second;
+        }
+
         void add_pin(ln_Pin pin_id, const NoodlePin& pin) {
             _noodlePins[pin_id] = pin;
         }
@@ -302,6 +399,31 @@ namespace lab { namespace noodle {
 
         virtual ln_Context create_runtime_context(ln_Node id) = 0;
 
+        // the settings used by the next create_runtime_context. A running
+        // context is closed, so the graph must already have been cleared;
+        // GraphCore::apply_device_settings takes care of that.
+        virtual void set_device_settings(const AudioDeviceSettings&) {}
+        virtual AudioDeviceSettings device_settings() const { return {}; }
+        virtual std::vector<AudioDeviceDescription> audio_devices() { return {}; }
+
+        // the sample rate the runtime context is actually running at, zero if there is none
+        virtual float context_sample_rate() { return 0; }
+
+        // appends the timings captured by the audio thread since the last
+        // call, in quantum order. dropped is the count of quanta lost because
+        // timings weren't drained quickly enough.
+        virtual void drain_quantum_timings(std::vector<QuantumTiming>& timings, uint64_t& dropped) { dropped = 0; }
+
+        // every quantum's render time is measured against its duration on the
+        // audio thread. misses are drained in the same way as timings.
+        virtual bool deadline_statistics(DeadlineStatistics& statistics) { return false; }
+        virtual void drain_deadline_misses(std::vector<DeadlineMiss>& misses) {}
+        virtual void reset_deadline_statistics() {}
+
+        // the base estimates the bookkeeping of the maps above, and a
+        // subclass adds its own records and the nodes' audio memory
+        virtual void memory_report(MemoryReport& report);
+
         void associate(ln_Node node, const std::string& name)
         {
             _name_to_entity[name] = node;
@@ -352,6 +474,10 @@ namespace lab { namespace noodle {
         virtual void  pin_set_enumeration_value(ln_Pin pin, const std::string& value) = 0;
         virtual void  pin_set_setting_enumeration_value(const std::string& node_name, const std::string& setting_name, const std::string& value) = 0;
 
+        // bus data, as captured into, and restored from, bundles
+        virtual bool  pin_bus_value(ln_Pin pin, BusData& result) = 0;
+        virtual void  pin_set_setting_bus_samples(const std::string& node_name, const std::string& setting_name, const BundleSample& sample) = 0;
+
         // string based interfaces
         virtual void pin_create_output(const std::string& node_name, const std::string& output_name, int channel) = 0;
 
@@ -359,6 +485,21 @@ namespace lab { namespace noodle {
         virtual void connect_bus_out_to_bus_in(ln_Node node_out_id, ln_Pin output_pin_id, ln_Node node_in_id) = 0;
         virtual void connect_bus_out_to_param_in(ln_Node output_node_id, ln_Pin output_pin_id, ln_Pin pin_id) = 0;
         virtual void disconnect(ln_Connection connection_id) = 0;
+
+    protected:
+        // drops every record of the graph. a subclass calls this before
+        // releasing its runtime, as the nodes' render and pin functions may
+        // hold on to the runtime's objects.
+        void clear_records()
+        {
+            _name_to_entity.clear();
+            _connections.clear();
+            _canvasNodes.clear();
+            _nodeGraphics.clear();
+            _pinGraphics.clear();
+            _noodleNodes.clear();
+            _noodlePins.clear();
+        }
     };
 
     //--------------------------------------------------------------------------
@@ -377,22 +518,78 @@ namespace lab { namespace noodle {
         bool show_debug = false;
         bool show_demo = false;
         bool show_ids = false;
+        bool show_deadlines = false;
+        bool show_heat_map = false;
+        bool show_memory = false;
+
+        // asks for a path to open, or to save if save is true, returning an
+        // empty string if the user cancelled. the editor's own dialogs, such
+        // as loading a sample into a bus setting, go through it, so that an
+        // application can record and replay the choice. unset, a native
+        // dialog is shown.
+        std::function<std::string(bool save, const char* filter)> file_dialog;
       
         bool run();
 
+        // the document model underneath the editor, see lab_noodle_core.h
+        GraphCore& core();
+
+        // refreshed at most once a second, as reading the nodes' audio
+        // memory holds the audio context's render lock
+        const MemoryReport& memory_report();
+
+        // quanta whose timings were lost because they weren't drained in time
+        uint64_t dropped_quanta() const;
+
+        // time spent in each phase of the most recent run, in microseconds.
+        // the phases partition the frame, so they sum to the total.
+        struct FrameTimings
+        {
+            double layout = 0;      // canvas set up, and lay_out_pins
+            double interaction = 0; // mouse state, hovers, and the edits they cause
+            double wires = 0;       // connection beziers
+            double nodes = 0;       // node bodies, pins, labels, and the debug window
+            double profiler = 0;    // profiler bookkeeping and window
+            double work = 0;        // applying pending work
+            double total = 0;
+        };
+        const FrameTimings& frame_timings() const;
+
         // save and load do their work irrespective of dirty state.
         // check needs_saving to determine if the user should be presented
         // with a save as dialog, or if save should not be called.
         // the Context is not responsible for the document on disk, only reading and writing,
         // so path is not tracked.
         bool needs_saving() const;
+
+        // the content hash depends only on what the patch contains, not on the
+        // order in which it was built, so identical patches hash identically.
+        // canonical_serialization lists the canonical records, sorted; the
+        // hash is the sum of the records' individual hashes, not a hash of it.
+        uint64_t content_hash() const;
+        std::string canonical_serialization() const;
+
         void save(const std::string& path);
         void load(const std::string& path);
         void export_cpp(const std::string& path);
+
+        // writes a class with the patch's topology fixed at compile time,
+        // suitable for embedding in an application that only plays the patch.
+        // with_benchmark additionally writes a driver program, and a CMake
+        // snippet to build it, next to the class.
+        void export_cpp_static(const std::string& path, bool with_benchmark = false);
+
         void save_test(const std::string& path);
         void save_json(const std::string& path);
         void clear_all();
 
+        // bundles hold the patch, and the sample data it references
+        void save_bundle(const std::string& path);
+        void load_bundle(const std::string& path);
+
+        // rebuilds the graph around a context opened with the new settings
+        void apply_device_settings(const AudioDeviceSettings& settings);
+
     private:
         struct State;
         State* _s;
@@ -0,0 +1,2087 @@
+
+#include "lab_noodle_core.h"
+
+#include "lab_bundle.h"
+#include "lab_hash.h"
+#include "lab_instrument.h"
+
+#include <rapidjson/document.h>
+#include <rapidjson/reader.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace lab {
+namespace noodle {
+
+    std::string UniqueNames::make(std::string name)
+    {
+
+        size_t pos = name.rfind("-");
+        std::string base;
+
+        // no dash, or leading dash, it's not a uniqued name
+        if (pos == std::string::npos || pos == 0)
+        {
+            base = name;
+            name += "-1";
+        }
+        else 
+            base = name.substr(0, pos);
+
+        // if base isn't already known, remember it, and return name
+        auto i = _bases.find(base);
+        if (i == _bases.end())
+        {
+            _bases[base] = 1;
+            _names.insert(name);
+            return name;
+        }
+
+        int id = i->second;
+        std::string candidate = base + "-" + std::to_string(id);
+        while (_names.find(candidate) != _names.end())
+        {
+            ++id;
+            candidate = base + "-" + std::to_string(id);
+        }
+        _bases[base] = id;
+        _names.insert(candidate);
+        return candidate;
+    }
+
+    void UniqueNames::clear()
+    {
+        _bases.clear();
+        _names.clear();
+    }
+
+    namespace {
+
+        // a map node is typically the entry plus three links and a color
+        template <typename Map>
+        size_t map_entry_bytes(const Map&)
+        {
+            return sizeof(typename Map::value_type) + 4 * sizeof(void*);
+        }
+
+        // strings short enough for the small string optimization have no heap
+        // storage; an empty string's capacity is the size of the small buffer
+        size_t string_bytes(const std::string& s)
+        {
+            static const size_t small_capacity = std::string().capacity();
+            return s.capacity() > small_capacity ? s.capacity() + 1 : 0;
+        }
+
+    } // anon
+
+    void Provider::memory_report(MemoryReport& report)
+    {
+        report = MemoryReport();
+        for (auto& n : _noodleNodes)
+        {
+            const NoodleNode& node = n.second;
+            size_t bytes = map_entry_bytes(_noodleNodes) + string_bytes(node.name) + string_bytes(node.kind)
+                + node.pins.capacity() * sizeof(ln_Pin);
+            if (_nodeGraphics.count(node.id))
+                bytes += map_entry_bytes(_nodeGraphics);
+            if (_name_to_entity.count(node.name))
+                bytes += map_entry_bytes(_name_to_entity) + string_bytes(node.name);
+            auto group_it = _canvasNodes.find(node.id);
+            if (group_it != _canvasNodes.end())
+                bytes += map_entry_bytes(_canvasNodes) + group_it->second.nodes.size() * (sizeof(ln_Node) + 4 * sizeof(void*));
+
+            for (const ln_Pin& pin_id : node.pins)
+            {
+                auto pin_it = _noodlePins.find(pin_id);
+                if (pin_it != _noodlePins.end())
+                {
+                    const NoodlePin& pin = pin_it->second;
+                    bytes += map_entry_bytes(_noodlePins) + string_bytes(pin.name) + string_bytes(pin.shortName)
+                        + string_bytes(pin.value_as_string) + string_bytes(pin.source);
+                }
+                if (_pinGraphics.count(pin_id))
+                    bytes += map_entry_bytes(_pinGraphics);
+            }
+
+            report.nodes[node.id.id].bookkeeping = bytes;
+            report.bookkeeping += bytes;
+        }
+        report.bookkeeping += _connections.size() * map_entry_bytes(_connections);
+    }
+
+    std::string ContentHash::canonical_node(Provider& provider, const NoodleNode& node) const
+    {
+        char buff[64];
+        std::string result = "node " + node.name + " " + node.kind;
+
+        // positions are rounded so that sub pixel jitter doesn't register as an edit
+        auto gnl_it = provider._nodeGraphics.find(node.id);
+        if (gnl_it != provider._nodeGraphics.end())
+        {
+            const NoodleNodeGraphic& gnl = gnl_it->second;
+            sprintf(buff, " %d %d", (int) std::floor(gnl.ul_cs.x + 0.5f), (int) std::floor(gnl.ul_cs.y + 0.5f));
+            result += buff;
+            if (gnl.group)
+            {
+                sprintf(buff, " %d %d", (int) std::floor(gnl.lr_cs.x + 0.5f), (int) std::floor(gnl.lr_cs.y + 0.5f));
+                result += buff;
+            }
+        }
+
+        std::vector<std::string> pins;
+        for (const ln_Pin& pin_id : node.pins)
+        {
+            auto pin_it = provider._noodlePins.find(pin_id);
+            if (pin_it == provider._noodlePins.end())
+                continue;
+
+            const NoodlePin& pin = pin_it->second;
+            switch (pin.kind)
+            {
+            case NoodlePin::Kind::BusIn:
+                break;
+            case NoodlePin::Kind::BusOut:
+                pins.push_back(" bus_out " + pin.name);
+                break;
+            case NoodlePin::Kind::Param:
+                pins.push_back(" param " + pin.name + "=" + pin.value_as_string);
+                break;
+            case NoodlePin::Kind::Setting:
+                if (pin.dataType == NoodlePin::DataType::Bus)
+                    pins.push_back(" setting " + pin.name + "=" + pin.source);
+                else if (pin.dataType == NoodlePin::DataType::Bool)
+                {
+                    // patches have spelled booleans both as True and False, and as 1 and 0
+                    const std::string& v = pin.value_as_string;
+                    bool value = v == "True" || v == "true" || v == "1";
+                    pins.push_back(" setting " + pin.name + "=" + (value ? "true" : "false"));
+                }
+                else
+                    pins.push_back(" setting " + pin.name + "=" + pin.value_as_string);
+                break;
+            }
+        }
+
+        std::sort(pins.begin(), pins.end());
+        for (auto& p : pins)
+            result += p;
+
+        return result;
+    }
+
+    std::string ContentHash::canonical_connection(Provider& provider, const NoodleConnection& connection) const
+    {
+        auto name_of_node = [&](ln_Node id) -> std::string {
+            auto it = provider._noodleNodes.find(id);
+            return it != provider._noodleNodes.end() ? it->second.name : std::string();
+        };
+        auto name_of_pin = [&](ln_Pin id) -> std::string {
+            auto it = provider._noodlePins.find(id);
+            return it != provider._noodlePins.end() ? it->second.name : std::string();
+        };
+
+        return std::string("connection ")
+            + name_of_node(connection.node_from) + ":" + name_of_pin(connection.pin_from) + " -> "
+            + name_of_node(connection.node_to) + ":" + name_of_pin(connection.pin_to)
+            + (connection.kind == NoodleConnection::Kind::ToBus ? " bus" : " param");
+    }
+
+    std::string ContentHash::canonical_device(Provider& provider) const
+    {
+        AudioDeviceSettings device = provider.device_settings();
+        char buff[96];
+        sprintf(buff, " %d %g %d %d", device.with_input ? 1 : 0, device.sample_rate,
+            device.output_channels, device.input_channels);
+        return "device " + device.output_device + " | " + device.input_device + buff;
+    }
+
+    void ContentHash::update(Provider& provider)
+    {
+        const uint64_t device_hash = hash_string(canonical_device(provider));
+        _content_hash += device_hash - _device_hash;
+        _device_hash = device_hash;
+
+        for (uint64_t id : _touched_nodes)
+        {
+            auto hash_it = _node_hashes.find(id);
+            if (hash_it != _node_hashes.end())
+            {
+                _content_hash -= hash_it->second;
+                _node_hashes.erase(hash_it);
+            }
+
+            auto node_it = provider._noodleNodes.find(ln_Node{ id, true });
+            if (node_it == provider._noodleNodes.end())
+                continue;
+
+            uint64_t h = hash_string(canonical_node(provider, node_it->second));
+            _node_hashes[id] = h;
+            _content_hash += h;
+        }
+
+        for (uint64_t id : _touched_connections)
+        {
+            auto hash_it = _connection_hashes.find(id);
+            if (hash_it != _connection_hashes.end())
+            {
+                _content_hash -= hash_it->second;
+                _connection_hashes.erase(hash_it);
+            }
+
+            auto conn_it = provider._connections.find(ln_Connection{ id });
+            if (conn_it == provider._connections.end())
+                continue;
+
+            uint64_t h = hash_string(canonical_connection(provider, conn_it->second));
+            _connection_hashes[id] = h;
+            _content_hash += h;
+        }
+
+        _touched_nodes.clear();
+        _touched_connections.clear();
+    }
+
+    void Work::delete_connections_and_pins(ln_Node id, GraphCore& core)
+    {
+        for (auto i = provider._connections.begin(), last = provider._connections.end(); i != last; ) {
+            if (i->second.node_from.id == id.id || i->second.node_to.id == id.id) {
+                core.hash.touch_connection(i->first);
+                i = provider._connections.erase(i);
+            }
+            else {
+                ++i;
+            }
+        }
+
+        for (auto i = provider._noodlePins.begin(), last = provider._noodlePins.end(); i != last; ) {
+            if (i->second.node_id.id == id.id) {
+                i = provider._noodlePins.erase(i);
+            }
+            else {
+                ++i;
+            }
+        }
+
+    }
+
+    NoodlePin* Work::find_pin_named(const std::string& node_name, const std::string& pin_name)
+    {
+        auto node_it = provider._noodleNodes.find(provider.entity_for_node_named(node_name));
+        if (node_it == provider._noodleNodes.end())
+            return nullptr;
+
+        for (const ln_Pin& p : node_it->second.pins)
+        {
+            auto pin_it = provider._noodlePins.find(p);
+            if (pin_it != provider._noodlePins.end() && pin_it->second.name == pin_name)
+                return &pin_it->second;
+        }
+        return nullptr;
+    }
+
+    void Work::touch_pin(GraphCore& core, ln_Pin pin_id, const std::string& value)
+    {
+        NoodlePin* pin = nullptr;
+        if (pin_id.id != ln_Pin_null().id)
+        {
+            auto pin_it = provider._noodlePins.find(pin_id);
+            if (pin_it != provider._noodlePins.end())
+                pin = &pin_it->second;
+        }
+        else
+        {
+            pin = find_pin_named(kind, name);
+            if (pin)
+                pin->value_as_string = value;
+        }
+
+        if (pin)
+            core.hash.touch_node(pin->node_id);
+    }
+
+    const char* work_type_name(WorkType type)
+    {
+        switch (type)
+        {
+        case WorkType::Nop: return "Nop";
+        case WorkType::ClearScene: return "ClearScene";
+        case WorkType::CreateRuntimeContext: return "CreateRuntimeContext";
+        case WorkType::CreateGroup: return "CreateGroup";
+        case WorkType::CreateOutput: return "CreateOutput";
+        case WorkType::CreateNode: return "CreateNode";
+        case WorkType::DeleteNode: return "DeleteNode";
+        case WorkType::SetParam: return "SetParam";
+        case WorkType::SetFloatSetting: return "SetFloatSetting";
+        case WorkType::SetIntSetting: return "SetIntSetting";
+        case WorkType::SetBoolSetting: return "SetBoolSetting";
+        case WorkType::SetBusSetting: return "SetBusSetting";
+        case WorkType::SetEnumerationSetting: return "SetEnumerationSetting";
+        case WorkType::ConnectBusOutToBusIn: return "ConnectBusOutToBusIn";
+        case WorkType::ConnectBusOutToParamIn: return "ConnectBusOutToParamIn";
+        case WorkType::DisconnectInFromOut: return "DisconnectInFromOut";
+        case WorkType::Start: return "Start";
+        case WorkType::Bang: return "Bang";
+        case WorkType::SetDeviceSettings: return "SetDeviceSettings";
+        case WorkType::MarkSaved: return "MarkSaved";
+        }
+        return "Unknown";
+    }
+
+    void Work::eval(GraphCore& core)
+    {
+        LAB_TIME_SCOPE_NAMED(work_type_name(type), "work");
+
+        switch (type)
+        {
+        case WorkType::Nop:
+            break;
+
+        case WorkType::MarkSaved:
+            core.hash.mark_saved(provider);
+            break;
+
+        case WorkType::CreateRuntimeContext:
+        {
+            core.device_node = ln_Node{ provider.create_entity(), true };
+            kind = "Device";
+            [[fallthrough]];
+        }
+        case WorkType::CreateNode:
+        {
+            std::string conformed_name;
+            if (name.length())
+                conformed_name = name;
+            else
+                conformed_name = core.unique_names.make(kind);
+
+            if (kind == "Device")
+            {
+                if (!core.device_node.valid)
+                    core.device_node = ln_Node{ provider.create_entity(), true };
+
+                provider._noodleNodes[core.device_node] = NoodleNode("Device", conformed_name, core.device_node);
+
+                provider.create_runtime_context(core.device_node);
+
+                provider._nodeGraphics[core.device_node] = 
+                    NoodleNodeGraphic{ nullptr, NoodleGraphicLayer::Nodes, { canvas_pos.x, canvas_pos.y } };
+
+                provider.associate(core.device_node, conformed_name);
+
+                root.nodes.insert(core.device_node);
+                core.hash.touch_node(core.device_node);
+                break;
+            }
+
+            ln_Node new_node = ln_Node{ provider.create_entity(), true };
+            provider._noodleNodes[new_node] = NoodleNode(kind, conformed_name, new_node);
+            provider.node_create(kind, new_node);
+
+            CanvasGroup* cn = nullptr;
+            if (group_node.id != ln_Node_null().id)
+            {
+                auto it = provider._canvasNodes.find(group_node);
+                if (it != provider._canvasNodes.end())
+                    cn = &it->second;
+            }
+
+            provider._nodeGraphics[new_node] =
+                NoodleNodeGraphic{cn, NoodleGraphicLayer::Nodes, { canvas_pos.x, canvas_pos.y } };
+
+            provider.associate(new_node, conformed_name);
+
+            if (cn)
+                cn->nodes.insert(new_node);
+            else
+                root.nodes.insert(new_node);
+
+            core.hash.touch_node(new_node);
+            break;
+        }
+        case WorkType::CreateOutput:
+        {
+            provider.pin_create_output(kind, name, int_value);
+            core.hash.touch_node(provider.entity_for_node_named(kind));
+            break;
+        }
+        case WorkType::CreateGroup:
+        {
+            std::string conformed_name;
+            if (name.length())
+                conformed_name = name;
+            else
+                conformed_name = core.unique_names.make(kind);
+
+            ln_Node new_ln_node = { provider.create_entity(), true };
+            provider._noodleNodes[new_ln_node] = NoodleNode(kind, conformed_name, new_ln_node);
+
+            provider._nodeGraphics[new_ln_node] = 
+                NoodleNodeGraphic{ nullptr, NoodleGraphicLayer::Groups, 
+                    { canvas_pos.x, canvas_pos.y },
+                    { canvas_pos.x + NoodleNodeGraphic::k_column_width() * 2, canvas_pos.y + NoodlePinGraphic::k_height() * 8},
+                    true };
+
+            provider._canvasNodes[new_ln_node] = CanvasGroup{};
+            core.hash.touch_node(new_ln_node);
+            break;
+        }
+        case WorkType::SetParam:
+        {
+            if (setting_pin.id != ln_Pin_null().id)
+                provider.pin_set_float_value(param_pin, float_value);
+            else
+                provider.pin_set_param_value(kind, name, float_value);
+            touch_pin(core, param_pin, std::to_string(float_value));
+            break;
+        }
+        case WorkType::SetFloatSetting:
+        {
+            if (setting_pin.id != ln_Pin_null().id)
+                provider.pin_set_float_value(setting_pin, float_value);
+            else
+                provider.pin_set_setting_float_value(kind, name, float_value);
+            touch_pin(core, setting_pin, std::to_string(float_value));
+            break;
+        }
+        case WorkType::SetIntSetting:
+        {
+            if (setting_pin.id != ln_Pin_null().id)
+                provider.pin_set_int_value(setting_pin, int_value);
+            else
+                provider.pin_set_setting_int_value(kind, name, int_value);
+            touch_pin(core, setting_pin, std::to_string(int_value));
+            break;
+        }
+        case WorkType::SetBoolSetting:
+        {
+            if (setting_pin.id != ln_Pin_null().id)
+                provider.pin_set_bool_value(setting_pin, bool_value);
+            else
+                provider.pin_set_setting_bool_value(kind, name, bool_value);
+            touch_pin(core, setting_pin, bool_value ? "True" : "False");
+            break;
+        }
+        case WorkType::SetBusSetting:
+        {
+            NoodlePin* pin = nullptr;
+            uint64_t hash;
+            BundleSample sample;
+            if (setting_pin.id != ln_Pin_null().id)
+            {
+                provider.pin_set_bus_from_file(setting_pin, string_value);
+                auto pin_it = provider._noodlePins.find(setting_pin);
+                if (pin_it != provider._noodlePins.end())
+                    pin = &pin_it->second;
+            }
+            else if (parse_content_address(string_value, hash))
+            {
+                if (core.bundle && core.bundle->find_sample(hash, sample))
+                    provider.pin_set_setting_bus_samples(kind, name, sample);
+                else
+                    printf("Sample %s for %s:%s is not in the open bundle\n", string_value.c_str(), kind.c_str(), name.c_str());
+                pin = find_pin_named(kind, name);
+            }
+            else
+            {
+                provider.pin_set_setting_bus_value(kind, name, string_value);
+                pin = find_pin_named(kind, name);
+            }
+
+            if (pin)
+            {
+                pin->source = string_value;
+                size_t o = string_value.find_last_of("/\\");
+                pin->value_as_string = o != std::string::npos ? string_value.substr(o + 1) : string_value;
+                core.hash.touch_node(pin->node_id);
+            }
+            break;
+        }
+        case WorkType::SetEnumerationSetting:
+        {
+            if (setting_pin.id != ln_Pin_null().id)
+                provider.pin_set_enumeration_value(setting_pin, string_value);
+            else
+                provider.pin_set_setting_enumeration_value(kind, name, string_value);
+            touch_pin(core, setting_pin, string_value);
+            break;
+        }
+
+        case WorkType::ConnectBusOutToBusIn:
+        {
+            ln_Node from_node_e = ln_Node_null();
+            ln_Node to_node_e = ln_Node_null();
+            ln_Pin from_pin_e = ln_Pin_null();
+            ln_Pin to_pin_e = ln_Pin_null();
+            if (pendingConnection)
+            {
+                from_node_e = provider.entity_for_node_named(pendingConnection->from_node);
+                to_node_e = provider.entity_for_node_named(pendingConnection->to_node);
+                if (!from_node_e.valid || !to_node_e.valid)
+                    break;
+
+                if (pendingConnection->from_pin.length())
+                    from_pin_e = provider.node_output_named(from_node_e, pendingConnection->from_pin);
+                else
+                    from_pin_e = provider.node_output_with_index(from_node_e, 0);
+
+                to_pin_e = provider.node_input_with_index(to_node_e, 0);
+
+                provider.connect_bus_out_to_bus_in(from_node_e, from_pin_e, to_node_e);
+            }
+            else
+            {
+                provider.connect_bus_out_to_bus_in(output_node, output_pin, input_node);
+                from_node_e = output_node;
+                from_pin_e = output_pin;
+                to_node_e = input_node;
+                to_pin_e = param_pin;
+            }
+
+            ln_Connection new_id{ provider.create_entity() };
+            provider._connections[new_id] = lab::noodle::NoodleConnection(
+                new_id,
+                from_pin_e, from_node_e,
+                to_pin_e, to_node_e,
+                lab::noodle::NoodleConnection::Kind::ToBus);
+
+            core.hash.touch_connection(new_id);
+            break;
+        }
+
+        case WorkType::ConnectBusOutToParamIn:
+        {
+            ln_Node from_node_e = ln_Node_null();
+            ln_Node to_node_e = ln_Node_null();
+            ln_Pin  from_pin_e = ln_Pin_null();
+            ln_Pin  to_pin_e = ln_Pin_null();
+
+            if (pendingConnection)
+            {
+                from_node_e = provider.entity_for_node_named(pendingConnection->from_node);
+                to_node_e = provider.entity_for_node_named(pendingConnection->to_node);
+                if (!from_node_e.valid || !to_node_e.valid)
+                    break;
+
+                from_pin_e = ln_Pin_null();
+                if (pendingConnection->from_pin.length())
+                    from_pin_e = provider.node_output_named(from_node_e, pendingConnection->from_pin);
+                else
+                    from_pin_e = provider.node_output_with_index(from_node_e, 0);
+
+                to_pin_e = ln_Pin_null();
+                if (pendingConnection->to_pin.length())
+                    to_pin_e = provider.node_param_named(to_node_e, pendingConnection->to_pin);
+                else
+                    break;  // nothing to connect from
+
+                if (!from_pin_e.valid || !to_pin_e.valid)
+                    break;
+
+                provider.connect_bus_out_to_param_in(from_node_e, from_pin_e, to_pin_e);
+            }
+            else
+            {
+                provider.connect_bus_out_to_param_in(output_node, output_pin, param_pin);
+                from_node_e = output_node;
+                from_pin_e = output_pin;
+                to_node_e = input_node;
+                to_pin_e = param_pin;
+            }
+
+            ln_Connection new_id{ provider.create_entity() };
+            provider._connections[new_id] = lab::noodle::NoodleConnection(
+                new_id,
+                from_pin_e, from_node_e,
+                to_pin_e, to_node_e,
+                lab::noodle::NoodleConnection::Kind::ToParam);
+
+            core.hash.touch_connection(new_id);
+            break;
+        }
+
+        case WorkType::DisconnectInFromOut:
+        {
+            auto id = ln_Connection{ connection_id };
+            auto conn_it = provider._connections.find(id);
+            if (conn_it != provider._connections.end())
+            {
+                provider.disconnect(id);
+                provider._connections.erase(conn_it);
+            }
+            core.hash.touch_connection(id);
+            break;
+        }
+
+        case WorkType::DeleteNode:
+        {
+            auto gnl = provider._nodeGraphics.find(input_node);
+            auto it = provider._canvasNodes.find(input_node);
+            if (it != provider._canvasNodes.end())
+            {
+                // if it's a canvas, also delete the contained nodes.
+                CanvasGroup& cn = it->second;
+                for (auto en : cn.nodes)
+                {
+                    provider.node_delete(en);
+                    delete_connections_and_pins(en, core);
+                    core.hash.touch_node(en);
+                }
+                cn.nodes.clear();
+            }
+            else
+            {
+                if (gnl != provider._nodeGraphics.end() && gnl->second.parent_canvas)
+                {
+                    // if the node is on a canvas, remove it from the canvas
+                    auto it = gnl->second.parent_canvas->nodes.find(input_node);
+                    if (it != gnl->second.parent_canvas->nodes.end())
+                        gnl->second.parent_canvas->nodes.erase(it);
+                }
+                provider.node_delete(input_node);
+                delete_connections_and_pins(input_node, core);
+            }
+
+            if (gnl != provider._nodeGraphics.end())
+                provider._nodeGraphics.erase(gnl);
+
+            auto n_it = provider._noodleNodes.find(input_node);
+            if (n_it != provider._noodleNodes.end())
+                provider._noodleNodes.erase(n_it);
+
+            core.hash.touch_node(input_node);
+            break;
+        }
+        case WorkType::Start:
+        {
+            provider.node_start_stop(input_node, 0.f);
+            break;
+        }
+        case WorkType::Bang:
+        {
+            provider.node_bang(input_node);
+            break;
+        }
+        case WorkType::ClearScene:
+        {
+            for (auto& noodleNode : provider._noodleNodes) {
+                auto cg = provider._canvasNodes.find(noodleNode.second.id);
+                if (cg != provider._canvasNodes.end())
+                {
+                    // if it's canvas, clear the contained nodes
+                    for (auto en : cg->second.nodes)
+                    {
+                        provider.node_delete(en);
+                    }
+                    cg->second.nodes.clear();
+                }
+                else
+                {
+                    auto gnl = provider._nodeGraphics.find(noodleNode.second.id);
+                    if (gnl != provider._nodeGraphics.end() && gnl->second.parent_canvas)
+                    {
+                        // if it's on a canvas, remove it.
+                        /// @TODO it probably makes sense to recurse the graph and
+                        /// delete from the leaves, rather than using this more complex algorithm
+                        auto it = gnl->second.parent_canvas->nodes.find(noodleNode.second.id);
+                        if (it != gnl->second.parent_canvas->nodes.end())
+                            gnl->second.parent_canvas->nodes.erase(it);
+                    }
+                    provider.node_delete(noodleNode.second.id);
+                }
+            }
+
+            provider._connections.clear();
+            provider._noodleNodes.clear();
+            provider._nodeGraphics.clear();
+            provider._pinGraphics.clear();
+            provider._canvasNodes.clear();
+
+            core.hash.clear();
+            core.unique_names.clear();
+            provider.clear_entity_node_associations();
+        }
+        break;
+
+        case WorkType::SetDeviceSettings:
+            // the scene was cleared by earlier work, so no node outlives the context
+            provider.set_device_settings(device_settings);
+            break;
+        } // switch
+    }
+
+    GraphCore::GraphCore(Provider& provider)
+        : provider(provider)
+    {
+    }
+
+    GraphCore::~GraphCore() = default;
+
+    void GraphCore::init(vec2 device_pos)
+    {
+        {
+            Work work(provider, root);
+            work.type = WorkType::CreateRuntimeContext;
+            work.canvas_pos = device_pos;
+            pending_work.emplace_back(std::move(work));
+        }
+        {
+            Work work(provider, root);
+            work.type = WorkType::MarkSaved; // so that quitting immediately doesn't prompt a save
+            pending_work.emplace_back(std::move(work));
+        }
+    }
+
+    void GraphCore::process_pending_work()
+    {
+        LAB_TIME_SCOPE("process_pending_work", "work");
+        LAB_COUNT("work items", "work", pending_work.size());
+        for (Work& work : pending_work)
+            work.eval(*this);
+
+        pending_work.clear();
+    }
+
+    void GraphCore::export_cpp(const std::string& path)
+    {
+        using lab::noodle::NoodlePin;
+        
+        auto clean_name = [](const std::string& s) -> std::string
+        {
+            std::string res = s;
+            int len = (int) s.size();
+            for (int i = 0; i < len; ++i)
+            {
+                char c = s[i];
+                if ((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'))
+                    continue;
+                res[i] = '_';
+            }
+            return res;
+        };
+        
+        std::ofstream file(path, std::ios::binary);
+        
+        file << "// " << path;
+        file << R"(
+
+// Automatic export from LabSoundGraphToy, output is licensed under BSD-2 clause.
+
+#include <LabSound/LabSound.h>
+#include <memory>
+
+void create_graph(lab::AudioContext& ctx)
+{
+    // Nodes:
+            
+)";
+        for (auto& node : provider._noodleNodes)
+        {
+            std::string node_name_clean = clean_name(node.second.name);
+            file << "\n    //--------------------\n    // Node: "
+                 << node.second.name << " Kind: " << node.second.kind << "\n";
+            file << "    std::shared_ptr<" << node.second.kind << "Node> "
+                 << node_name_clean << " = std::make_shared<" << node.second.kind << "Node>(ac);\n";
+
+            auto gnl_it = provider._nodeGraphics.find(node.second.id);
+            if (gnl_it != provider._nodeGraphics.end())
+            {
+                NoodleNodeGraphic& gnl = gnl_it->second;
+                file << "    // position: " << gnl.ul_cs.x << ", " << gnl.ul_cs.y << "\n\n";
+            }
+
+            file << "    // Pins:\n\n";
+            for (const ln_Pin& entity : node.second.pins)
+            {
+                auto pin_it = provider._noodlePins.find(entity);
+                if (pin_it == provider._noodlePins.end())
+                    continue;
+
+                NoodlePin& pin = pin_it->second;
+
+                switch (pin.kind)
+                {
+                case NoodlePin::Kind::BusIn:
+                    break;
+
+                case NoodlePin::Kind::BusOut:
+                    file << "    // bus out: " << pin.name << "\n";
+                    break;
+
+                case NoodlePin::Kind::Param:
+                    file << "    // param\n";
+                    file << "    {\n        auto param = " << node_name_clean << "->param(" << pin.name << ");\n";
+                    file << "        if (param)\n        {\n            param->setValue(" << pin.value_as_string << ");\n        }\n    }\n";
+                    break;
+
+                case NoodlePin::Kind::Setting:
+                    file << "    // setting\n";
+                    file << "    {\n        auto setting = " << node_name_clean << "->setting(" << pin.name << ");\n";
+                    file << "        if (setting)\n        {\n";
+                    switch (pin.dataType)
+                    {
+                    default:
+                    case NoodlePin::DataType::None: break;
+                    case NoodlePin::DataType::Bus: break;
+                    case NoodlePin::DataType::Bool: file <<        "            setting->setBool(" << pin.value_as_string << ");\n        }\n"; break;
+                    case NoodlePin::DataType::Integer: file <<     "            setting->setUint32(" << pin.value_as_string << ");\n        }\n"; break;
+                    case NoodlePin::DataType::Enumeration: file << "            setting->setEnumeration(\"" << pin.value_as_string << "\");\n        }\n"; break;
+                    case NoodlePin::DataType::Float: file <<       "            setting->setFloat(" << pin.value_as_string << ");\n        }\n"; break;
+                    case NoodlePin::DataType::String: file <<      "            setting->setString(\"" << pin.value_as_string << "\");\n        }\n"; break;
+                    }
+                    file << "    }\n";
+                    break;
+                }
+            }
+        } // node loop
+
+        file << "    // Connections:\n\n";
+        for (const auto& connection : provider._connections)
+        {
+            ln_Pin from_pin = provider.copy(connection.second.pin_from);
+            ln_Pin to_pin = provider.copy(connection.second.pin_to);
+            if (!from_pin.valid || !to_pin.valid)
+                continue;
+
+            auto from_node = provider._noodleNodes.find(connection.second.node_from);
+            if (from_node == provider._noodleNodes.end())
+                continue;
+            std::string from_node_name = from_node->second.name;
+            auto to_node = provider._noodleNodes.find(connection.second.node_to);
+            if (to_node == provider._noodleNodes.end())
+                continue;
+            std::string to_node_name = to_node->second.name;
+
+            auto pin_it = provider._noodlePins.find(to_pin);
+            if (pin_it == provider._noodlePins.end())
+                continue;
+
+            NoodlePin pin = pin_it->second;
+
+            std::string to_pin_name = pin.name;
+
+            if (connection.second.kind == NoodleConnection::Kind::ToParam)
+            {
+                // @TODO - the context needs a named output -> param API
+                file << "    ctx->connectParam(" << clean_name(from_node_name) 
+                     << ", \"" << to_pin_name << "\", " << clean_name(to_node_name) << ", 0);\n";
+            }
+            else
+            {
+                // @TODO - the context needs a named output -> input connection API
+                file << "    ctx->connect(" << clean_name(from_node_name) 
+                     << ", " << clean_name(to_node_name) << ", 0, 0);\n";
+            }
+        }
+        file << "}\n" << std::endl;
+        file.close();
+    }
+
+    void GraphCore::export_cpp_static(const std::string& path, bool with_benchmark)
+    {
+        using lab::noodle::NoodlePin;
+
+        auto clean_name = [](const std::string& s) -> std::string
+        {
+            std::string res = s;
+            int len = (int) s.size();
+            for (int i = 0; i < len; ++i)
+            {
+                char c = s[i];
+                if ((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'))
+                    continue;
+                res[i] = '_';
+            }
+            if (res.empty() || (res[0] >= '0' && res[0] <= '9'))
+                res = "_" + res;
+            return res;
+        };
+
+        // the class is named for the file it is written to
+        std::string directory;
+        std::string header_name = path;
+        size_t o = header_name.find_last_of("/\\");
+        if (o != std::string::npos)
+        {
+            directory = header_name.substr(0, o + 1);
+            header_name = header_name.substr(o + 1);
+        }
+        std::string class_name = header_name;
+        o = class_name.find_first_of('.');
+        if (o != std::string::npos)
+            class_name = class_name.substr(0, o);
+        class_name = clean_name(class_name);
+
+        // names that differ only in characters that aren't valid in an
+        // identifier are cleaned to the same one, so later ones are numbered
+        std::set<std::string> identifiers = { class_name, "node_count", "start" };
+        auto unique_identifier = [&identifiers](const std::string& name) -> std::string
+        {
+            std::string candidate = name;
+            for (int i = 2; !identifiers.insert(candidate).second; ++i)
+                candidate = name + "_" + std::to_string(i);
+            return candidate;
+        };
+
+        // Groups are editor furniture, and the Device is owned by the context,
+        // everything else becomes a member of the exported class.
+        std::map<ln_Node, std::string, cmp_ln_Node> members;
+        for (auto& node : provider._noodleNodes)
+        {
+            if (node.second.kind == "Group" || node.second.kind == "Device")
+                continue;
+            members[node.first] = unique_identifier(clean_name(node.second.name));
+        }
+
+        // a sample loaded from a bundle has only the bundle's address as its
+        // source, which lab::MakeBusFromFile can't open
+        for (auto& m : members)
+        {
+            for (const ln_Pin& entity : provider._noodleNodes[m.first].pins)
+            {
+                auto pin_it = provider._noodlePins.find(entity);
+                uint64_t hash;
+                if (pin_it != provider._noodlePins.end() && pin_it->second.dataType == NoodlePin::DataType::Bus &&
+                    parse_content_address(pin_it->second.source, hash))
+                {
+                    printf("export_cpp_static: %s's %s was loaded from a bundle, save the sample to a file to export %s\n",
+                        provider._noodleNodes[m.first].name.c_str(), pin_it->second.name.c_str(), path.c_str());
+                    return;
+                }
+            }
+        }
+
+        // The processing order is a topological sort of the graph, sources
+        // first. Ties are broken by name so that the export is stable.
+        std::vector<ln_Node> order;
+        {
+            std::map<ln_Node, int, cmp_ln_Node> inputs;
+            for (auto& m : members)
+                inputs[m.first] = 0;
+            for (auto& c : provider._connections)
+            {
+                if (members.count(c.second.node_from) && members.count(c.second.node_to))
+                    inputs[c.second.node_to] += 1;
+            }
+
+            std::set<std::pair<std::string, uint64_t>> ready;
+            for (auto& i : inputs)
+                if (!i.second)
+                    ready.insert({ members[i.first], i.first.id });
+
+            while (!ready.empty())
+            {
+                ln_Node n = { ready.begin()->second, true };
+                ready.erase(ready.begin());
+                order.push_back(n);
+                for (auto& c : provider._connections)
+                {
+                    if (c.second.node_from.id != n.id || !members.count(c.second.node_to))
+                        continue;
+                    if (--inputs[c.second.node_to] == 0)
+                        ready.insert({ members[c.second.node_to], c.second.node_to.id });
+                }
+            }
+
+            if (order.size() != members.size())
+            {
+                // a feedback loop has no static order
+                printf("export_cpp_static: %s contains a cycle, and cannot be exported\n", path.c_str());
+                return;
+            }
+        }
+
+        // the nodes the application registers, rather than LabSound, are
+        // declared outside the lab namespace, in the application's headers
+        struct AppNode { const char* kind; const char* class_name; const char* header; };
+        static const AppNode app_nodes[] = {
+            { "OSC", "OSCNode", "OSCNode.hpp" },
+            { "Midi", "MidiNode", "MidiNode.hpp" },
+            { "LatencyProbe", "LatencyProbeNode", "LatencyProbeNode.hpp" },
+        };
+        auto find_app_node = [](const std::string& kind) -> const AppNode*
+        {
+            for (const AppNode& app_node : app_nodes)
+                if (kind == app_node.kind)
+                    return &app_node;
+            return nullptr;
+        };
+        auto node_class = [&find_app_node](const std::string& kind) -> std::string
+        {
+            if (const AppNode* app_node = find_app_node(kind))
+                return app_node->class_name;
+            return "lab::" + kind + "Node";
+        };
+
+        auto bool_literal = [](const std::string& s) -> const char*
+        {
+            return (s == "True" || s == "true" || s == "1") ? "true" : "false";
+        };
+
+        // values are held as strings, which may be empty, or not finite
+        auto float_literal = [](const std::string& s) -> std::string
+        {
+            float v = strtof(s.c_str(), nullptr);
+            if (std::isnan(v))
+                return "std::numeric_limits<float>::quiet_NaN()";
+            if (std::isinf(v))
+                return v > 0 ? "std::numeric_limits<float>::infinity()" : "-std::numeric_limits<float>::infinity()";
+
+            char buff[32];
+            snprintf(buff, sizeof(buff), "%.9g", v);
+            std::string res = buff;
+            if (res.find_first_of(".e") == std::string::npos)
+                res += ".";
+            return res + "f";
+        };
+
+        auto uint_literal = [](const std::string& s) -> std::string
+        {
+            return std::to_string(strtoul(s.c_str(), nullptr, 10));
+        };
+
+        auto string_literal = [](const std::string& s) -> std::string
+        {
+            std::string res = "\"";
+            for (char c : s)
+            {
+                switch (c)
+                {
+                case '"': res += "\\\""; break;
+                case '\\': res += "\\\\"; break;
+                case '\n': res += "\\n"; break;
+                case '\r': res += "\\r"; break;
+                case '\t': res += "\\t"; break;
+                default:
+                    if ((unsigned char) c < 0x20 || c == 0x7f)
+                    {
+                        // octal escapes end after three digits, unlike hex
+                        char buff[8];
+                        snprintf(buff, sizeof(buff), "\\%03o", (unsigned char) c);
+                        res += buff;
+                    }
+                    else
+                        res += c;
+                }
+            }
+            return res + "\"";
+        };
+
+        // each pin's constant is named for its node and the pin
+        std::map<ln_Pin, std::string, cmp_ln_Pin> constants;
+        for (ln_Node n : order)
+            for (const ln_Pin& entity : provider._noodleNodes[n].pins)
+            {
+                auto pin_it = provider._noodlePins.find(entity);
+                if (pin_it != provider._noodlePins.end() &&
+                    (pin_it->second.kind == NoodlePin::Kind::Param || pin_it->second.kind == NoodlePin::Kind::Setting))
+                    constants[entity] = unique_identifier(members[n] + "_" + clean_name(pin_it->second.name));
+            }
+
+        std::ofstream file(path, std::ios::binary);
+
+        file << "// " << path;
+        file << R"(
+
+// Automatic export from LabSoundGraphToy, output is licensed under BSD-2 clause.
+//
+// The topology of the patch is fixed in this class. Nodes are constructed and
+// connected in processing order, parameters and settings are addressed by
+// index, and the initial values are compile time constants.
+
+#pragma once
+
+#include <LabSound/LabSound.h>
+#include <limits>
+#include <memory>
+)";
+        std::set<std::string> headers;
+        for (auto& m : members)
+        {
+            auto n_it = provider._noodleNodes.find(m.first);
+            if (const AppNode* app_node = find_app_node(n_it->second.kind))
+                headers.insert(app_node->header);
+        }
+        for (auto& header : headers)
+            file << "#include \"" << header << "\"\n";
+
+        file << "\nclass " << class_name << "\n{\npublic:\n";
+
+        // initial values
+        file << "    // initial values\n";
+        for (ln_Node n : order)
+        {
+            NoodleNode& node = provider._noodleNodes[n];
+            for (const ln_Pin& entity : node.pins)
+            {
+                auto pin_it = provider._noodlePins.find(entity);
+                if (pin_it == provider._noodlePins.end())
+                    continue;
+
+                NoodlePin& pin = pin_it->second;
+                const std::string& constant = constants[entity];
+                if (pin.kind == NoodlePin::Kind::Param)
+                {
+                    file << "    static constexpr float " << constant << " = " << float_literal(pin.value_as_string) << ";\n";
+                    continue;
+                }
+                if (pin.kind != NoodlePin::Kind::Setting)
+                    continue;
+
+                switch (pin.dataType)
+                {
+                default:
+                case NoodlePin::DataType::None: break;
+                case NoodlePin::DataType::Bus:
+                    if (pin.source.length())
+                        file << "    static constexpr char const* " << constant << " = " << string_literal(pin.source) << ";\n";
+                    break;
+                case NoodlePin::DataType::Bool: file << "    static constexpr bool " << constant << " = " << bool_literal(pin.value_as_string) << ";\n"; break;
+                case NoodlePin::DataType::Integer: file << "    static constexpr uint32_t " << constant << " = " << uint_literal(pin.value_as_string) << ";\n"; break;
+                case NoodlePin::DataType::Float: file << "    static constexpr float " << constant << " = " << float_literal(pin.value_as_string) << ";\n"; break;
+                case NoodlePin::DataType::String: file << "    static constexpr char const* " << constant << " = " << string_literal(pin.value_as_string) << ";\n"; break;
+                case NoodlePin::DataType::Enumeration:
+                {
+                    int index = 0;
+                    for (int i = 0; pin.names && pin.names[i]; ++i)
+                        if (pin.value_as_string == pin.names[i])
+                            index = i;
+                    file << "    static constexpr int " << constant << " = " << index << "; // " << pin.value_as_string << "\n";
+                    break;
+                }
+                }
+            }
+        }
+
+        file << "\n    static constexpr int node_count = " << order.size() << ";\n";
+
+        // members
+        file << "\n    // nodes, in processing order\n";
+        for (ln_Node n : order)
+            file << "    std::shared_ptr<" << node_class(provider._noodleNodes[n].kind) << "> " << members[n] << ";\n";
+
+        // construction
+        file << "\n    explicit " << class_name << "(lab::AudioContext& ac)\n    {\n";
+        for (ln_Node n : order)
+        {
+            NoodleNode& node = provider._noodleNodes[n];
+            const std::string& member = members[n];
+            file << "\n        " << member << " = std::make_shared<" << node_class(node.kind) << ">(ac);\n";
+
+            int param_index = 0;
+            int setting_index = 0;
+            bool has_values = false;
+            for (const ln_Pin& entity : node.pins)
+            {
+                auto pin_it = provider._noodlePins.find(entity);
+                if (pin_it == provider._noodlePins.end())
+                    continue;
+
+                NoodlePin& pin = pin_it->second;
+                const std::string& constant = constants[entity];
+                if (pin.kind == NoodlePin::Kind::Param)
+                {
+                    if (!has_values)
+                        file << "        {\n            auto params = " << member << "->params();\n            auto settings = " << member << "->settings();\n";
+                    has_values = true;
+                    file << "            params[" << param_index++ << "]->setValue(" << constant << ");\n";
+                    continue;
+                }
+                if (pin.kind != NoodlePin::Kind::Setting)
+                    continue;
+
+                if (!has_values)
+                    file << "        {\n            auto params = " << member << "->params();\n            auto settings = " << member << "->settings();\n";
+                has_values = true;
+
+                int index = setting_index++;
+                switch (pin.dataType)
+                {
+                default:
+                case NoodlePin::DataType::None: break;
+                case NoodlePin::DataType::Bus:
+                    if (pin.source.length())
+                        file << "            settings[" << index << "]->setBus(lab::MakeBusFromFile(" << constant << ", false).get());\n";
+                    break;
+                case NoodlePin::DataType::Bool: file << "            settings[" << index << "]->setBool(" << constant << ");\n"; break;
+                case NoodlePin::DataType::Integer: file << "            settings[" << index << "]->setUint32(" << constant << ");\n"; break;
+                case NoodlePin::DataType::Enumeration: file << "            settings[" << index << "]->setUint32(" << constant << ");\n"; break;
+                case NoodlePin::DataType::Float: file << "            settings[" << index << "]->setFloat(" << constant << ");\n"; break;
+                case NoodlePin::DataType::String: file << "            settings[" << index << "]->setString(" << constant << ");\n"; break;
+                }
+            }
+            if (has_values)
+                file << "        }\n";
+        }
+
+        // connections, in processing order of their destinations
+        file << "\n        // connections\n";
+        auto emit_connection = [&](const NoodleConnection& c, const std::string& to)
+        {
+            auto from_it = members.find(c.node_from);
+            if (from_it == members.end())
+                return;
+
+            int output_index = 0;
+            auto from_node = provider._noodleNodes.find(c.node_from);
+            for (const ln_Pin& entity : from_node->second.pins)
+            {
+                auto pin_it = provider._noodlePins.find(entity);
+                if (pin_it == provider._noodlePins.end() || pin_it->second.kind != NoodlePin::Kind::BusOut)
+                    continue;
+                if (entity.id == c.pin_from.id)
+                    break;
+                ++output_index;
+            }
+
+            if (c.kind == NoodleConnection::Kind::ToParam)
+            {
+                int param_index = 0;
+                auto to_node = provider._noodleNodes.find(c.node_to);
+                for (const ln_Pin& entity : to_node->second.pins)
+                {
+                    auto pin_it = provider._noodlePins.find(entity);
+                    if (pin_it == provider._noodlePins.end() || pin_it->second.kind != NoodlePin::Kind::Param)
+                        continue;
+                    if (entity.id == c.pin_to.id)
+                        break;
+                    ++param_index;
+                }
+                file << "        ac.connectParam(" << to << "->params()[" << param_index << "], "
+                     << from_it->second << ", " << output_index << ");\n";
+            }
+            else
+            {
+                file << "        ac.connect(" << to << ", " << from_it->second << ", 0, " << output_index << ");\n";
+            }
+        };
+
+        for (ln_Node n : order)
+            for (auto& c : provider._connections)
+                if (c.second.node_to.id == n.id)
+                    emit_connection(c.second, members[n]);
+
+        for (auto& c : provider._connections)
+        {
+            auto to_node = provider._noodleNodes.find(c.second.node_to);
+            if (to_node != provider._noodleNodes.end() && to_node->second.kind == "Device")
+                emit_connection(c.second, "ac.device()");
+        }
+
+        // analysers aren't necessarily connected to the device, so they must be pulled
+        for (ln_Node n : order)
+            if (provider._noodleNodes[n].kind == "Analyser")
+                file << "        ac.addAutomaticPullNode(" << members[n] << ");\n";
+
+        file << "    }\n";
+
+        // scheduled nodes
+        file << "\n    void start(float when = 0.f)\n    {\n";
+        for (ln_Node n : order)
+            if (provider._noodleNodes[n].play_controller)
+                file << "        " << members[n] << "->start(when);\n";
+        file << "    }\n";
+
+        file << "};\n" << std::endl;
+        file.close();
+
+        if (!with_benchmark)
+            return;
+
+        // The benchmark driver renders the class through an offline context.
+        // A clock node is pulled once per quantum, so the interval between its
+        // calls is the time taken to render a quantum.
+        static const char* benchmark_template = R"(// @HEADER@ benchmark driver
+
+// Automatic export from LabSoundGraphToy, output is licensed under BSD-2 clause.
+//
+// usage: @CLASS@_benchmark [seconds] [sample rate]
+
+#include "@HEADER@"
+
+#include <LabSound/core/AudioNode.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+static double peak_memory_mb()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+        return pmc.PeakWorkingSetSize / (1024.0 * 1024.0);
+    return 0;
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / (1024.0 * 1024.0);
+#else
+    return usage.ru_maxrss / 1024.0;
+#endif
+#endif
+}
+
+struct QuantumClock : public lab::AudioNode
+{
+    using clock = std::chrono::steady_clock;
+
+    explicit QuantumClock(lab::AudioContext& ac, size_t expected_quanta)
+        : AudioNode(ac)
+    {
+        intervals.reserve(expected_quanta);
+        initialize();
+    }
+
+    static const char* static_name() { return "QuantumClock"; }
+    virtual const char* name() const override { return static_name(); }
+
+    virtual void process(lab::ContextRenderLock& r, int bufferSize) override
+    {
+        clock::time_point now = clock::now();
+        if (started)
+            intervals.push_back(std::chrono::duration<double, std::micro>(now - last).count());
+        last = now;
+        started = true;
+    }
+
+    virtual void reset(lab::ContextRenderLock&) override { }
+    virtual double tailTime(lab::ContextRenderLock& r) const override { return 0.; }
+    virtual double latencyTime(lab::ContextRenderLock& r) const override { return 0.; }
+
+    std::vector<double> intervals; // in microseconds
+    clock::time_point last;
+    bool started = false;
+};
+
+int main(int argc, char** argv)
+{
+    double seconds = argc > 1 ? atof(argv[1]) : 10.0;
+    float sample_rate = argc > 2 ? (float) atof(argv[2]) : 48000.f;
+    if (seconds <= 0 || sample_rate <= 0)
+    {
+        printf("usage: %s [seconds] [sample rate]\n", argv[0]);
+        return 1;
+    }
+
+    lab::AudioStreamConfig config;
+    config.device_index = 0;
+    config.desired_channels = 2;
+    config.desired_samplerate = sample_rate;
+
+    std::unique_ptr<lab::AudioContext> ac = lab::MakeOfflineAudioContext(config, seconds * 1000.0);
+
+    size_t expected_quanta = size_t(seconds * sample_rate / 128) + 1;
+    std::shared_ptr<QuantumClock> quantum_clock = std::make_shared<QuantumClock>(*ac, expected_quanta);
+    ac->addAutomaticPullNode(quantum_clock);
+
+    @CLASS@ graph(*ac);
+    graph.start();
+
+    std::atomic<bool> complete{ false };
+    ac->offlineRenderCompleteCallback = [&complete]() { complete = true; };
+
+    auto start = std::chrono::steady_clock::now();
+    ac->startOfflineRendering();
+    while (!complete)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<double>& q = quantum_clock->intervals;
+    if (q.empty())
+    {
+        printf("no quanta were rendered\n");
+        return 1;
+    }
+
+    std::sort(q.begin(), q.end());
+    double mean = 0;
+    for (double t : q)
+        mean += t;
+    mean /= q.size();
+    double p99 = q[std::min(q.size() - 1, size_t(q.size() * 0.99))];
+
+    printf("@CLASS@: %.2f s at %.0f Hz, %d nodes\n", seconds, sample_rate, @CLASS@::node_count);
+    printf("  realtime factor  %.2fx\n", seconds / wall);
+    printf("  quantum min      %.2f us\n", q.front());
+    printf("  quantum mean     %.2f us\n", mean);
+    printf("  quantum p99      %.2f us\n", p99);
+    printf("  peak memory      %.2f MB\n", peak_memory_mb());
+    return 0;
+}
+)";
+
+        static const char* cmake_template = R"(# @HEADER@ benchmark driver
+#
+# include() this file from a project where LabSound is available as Lab::Sound.
+
+add_executable(@CLASS@_benchmark "${CMAKE_CURRENT_LIST_DIR}/@CLASS@_benchmark.cpp")
+target_include_directories(@CLASS@_benchmark PRIVATE "${CMAKE_CURRENT_LIST_DIR}")
+set_property(TARGET @CLASS@_benchmark PROPERTY CXX_STANDARD 17)
+set_property(TARGET @CLASS@_benchmark PROPERTY CXX_STANDARD_REQUIRED ON)
+target_link_libraries(@CLASS@_benchmark Lab::Sound)
+if (WIN32)
+    target_link_libraries(@CLASS@_benchmark psapi)
+endif()
+)";
+
+        auto expand = [&](std::string s) -> std::string
+        {
+            for (size_t i = s.find("@CLASS@"); i != std::string::npos; i = s.find("@CLASS@", i))
+                s.replace(i, 7, class_name);
+            for (size_t i = s.find("@HEADER@"); i != std::string::npos; i = s.find("@HEADER@", i))
+                s.replace(i, 8, header_name);
+            return s;
+        };
+
+        std::ofstream driver(directory + class_name + "_benchmark.cpp", std::ios::binary);
+        driver << expand(benchmark_template);
+        driver.close();
+
+        std::ofstream cmake(directory + class_name + "_benchmark.cmake", std::ios::binary);
+        cmake << expand(cmake_template);
+        cmake.close();
+    }
+
+    void GraphCore::save_test(const std::string& path)
+    {
+        /// @TODO this is a prototype file format, meant to debug actually writing valuable data
+        /// The format could be something else entirely, this routine should be treated more
+        /// like a prototype template that can be duplicated for a new format.
+
+        // Note: this code uses \n because std::endl has other behaviors
+        using lab::noodle::NoodlePin;
+
+        std::ofstream file(path, std::ios::binary);
+        file << "#!LabSoundGraphToy\n";
+        file << "# " << path << "\n";
+        for (auto& node : provider._noodleNodes)
+        {
+            file << "node: " << node.second.kind << " name: " << node.second.name << "\n";
+
+            auto gnl_it = provider._nodeGraphics.find(node.second.id);
+            if (gnl_it != provider._nodeGraphics.end())
+            {
+                NoodleNodeGraphic& gnl = gnl_it->second;
+                file << " pos: " << gnl.ul_cs.x << " " << gnl.ul_cs.y << "\n";
+            }
+
+            for (const ln_Pin& entity : node.second.pins)
+            {
+                auto pin_it = provider._noodlePins.find(entity);
+                if (pin_it == provider._noodlePins.end())
+                    continue;
+                NoodlePin pin = pin_it->second;
+
+                switch (pin.kind)
+                {
+                case NoodlePin::Kind::BusIn:
+                    break;
+                case NoodlePin::Kind::BusOut:
+                    file << " out: " << pin.name << "\n";
+                    break;
+
+                case NoodlePin::Kind::Param:
+                    file << " param: " << pin.name << " " << pin.value_as_string << "\n";
+                    break;
+                case NoodlePin::Kind::Setting:
+                    file << " setting: " << pin.name << " ";
+                    switch (pin.dataType)
+                    {
+                    case NoodlePin::DataType::None: file << "None "; break;
+                    case NoodlePin::DataType::Bus: file << "Bus "; break;
+                    case NoodlePin::DataType::Bool: file << "Bool "; break;
+                    case NoodlePin::DataType::Integer: file << "Integer "; break;
+                    case NoodlePin::DataType::Enumeration: file << "Enumeration "; break;
+                    case NoodlePin::DataType::Float: file << "Float "; break;
+                    case NoodlePin::DataType::String: file << "String "; break;
+                    }
+                    file << pin.value_as_string << "\n";
+                    break;
+                }
+            }
+        }
+
+        for (auto const& connection : provider._connections)
+        {
+            ln_Pin from_pin = provider.copy(connection.second.pin_from);
+            ln_Pin to_pin = provider.copy(connection.second.pin_to);
+            if (!from_pin.valid || !to_pin.valid)
+                continue;
+
+
+            auto from_node = provider._noodleNodes.find(connection.second.node_from);
+            if (from_node == provider._noodleNodes.end())
+                continue;
+            std::string from_node_name = from_node->second.name;
+            auto to_node = provider._noodleNodes.find(connection.second.node_to);
+            if (to_node == provider._noodleNodes.end())
+                continue;
+            std::string to_node_name = to_node->second.name;
+
+            auto pin_it = provider._noodlePins.find(from_pin);
+            if (pin_it == provider._noodlePins.end())
+                continue;
+            NoodlePin pin = pin_it->second;
+
+            std::string from_pin_name = pin.name;
+
+            file << " + " << from_node_name << ":" << from_pin_name <<
+                " -> " << to_node_name << ":" << to_node_name << "\n";
+        }
+
+        file.flush();
+        hash.mark_saved(provider);
+    }
+
+    std::string GraphCore::serialize_json(const std::function<std::string(const NoodlePin&)>& bus_value)
+    {
+        using lab::noodle::NoodlePin;
+        using StringBuffer = rapidjson::StringBuffer;
+        using Writer = rapidjson::Writer<StringBuffer>;
+
+        StringBuffer s;
+        Writer writer(s);
+        writer.StartObject();
+        writer.Key("LabSoundGraphToy");
+        writer.StartObject();
+        writer.Key("content_hash");
+        writer.String(content_address(hash.value(provider)).c_str());
+        writer.Key("nodes");
+        writer.StartArray();
+
+        for (auto& node : provider._noodleNodes)
+        {
+            writer.StartObject();
+
+            writer.Key("name");
+            writer.String(node.second.name.c_str());
+            writer.Key("kind");
+            writer.String(node.second.kind.c_str());
+
+            auto gnl_it = provider._nodeGraphics.find(node.second.id);
+            if (gnl_it != provider._nodeGraphics.end())
+            {
+                NoodleNodeGraphic& gnl = gnl_it->second;
+                writer.Key("pos");
+                writer.StartArray();
+                writer.Double(gnl.ul_cs.x);
+                writer.Double(gnl.ul_cs.y);
+                writer.EndArray();
+            }
+
+            writer.Key("pins");
+            writer.StartArray();
+            for (const ln_Pin& entity : node.second.pins)
+            {
+                auto pin_it = provider._noodlePins.find(entity);
+                if (pin_it == provider._noodlePins.end())
+                    continue;
+
+                NoodlePin pin = pin_it->second;
+
+                switch (pin.kind)
+                {
+                case NoodlePin::Kind::BusIn:
+                    break;
+
+                case NoodlePin::Kind::BusOut:
+                    writer.StartObject();
+                    writer.Key("kind");
+                    writer.String("bus_out");
+                    writer.Key("name");
+                    writer.String(pin.name.c_str());
+                    writer.EndObject();
+                    break;
+
+                case NoodlePin::Kind::Param:
+                    writer.StartObject();
+                    writer.Key("kind");
+                    writer.String("param");
+                    writer.Key("name");
+                    writer.String(pin.name.c_str());
+                    writer.Key("value");
+                    writer.String(pin.value_as_string.c_str());
+                    writer.EndObject();
+                    break;
+
+                case NoodlePin::Kind::Setting:
+                    writer.StartObject();
+                    writer.Key("kind");
+                    writer.String("setting");
+                    writer.Key("name");
+                    writer.String(pin.name.c_str());
+                    writer.Key("value");
+                    if (pin.dataType == NoodlePin::DataType::Bus)
+                        writer.String(bus_value(pin).c_str());
+                    else
+                        writer.String(pin.value_as_string.c_str());
+                    writer.Key("type");
+                    switch (pin.dataType)
+                    {
+                    default:
+                    case NoodlePin::DataType::None: writer.String("None"); break;
+                    case NoodlePin::DataType::Bus: writer.String("Bus"); break;
+                    case NoodlePin::DataType::Bool: writer.String("Bool"); break;
+                    case NoodlePin::DataType::Integer: writer.String("Integer"); break;
+                    case NoodlePin::DataType::Enumeration: writer.String("Enumeration"); break;
+                    case NoodlePin::DataType::Float: writer.String("Float"); break;
+                    case NoodlePin::DataType::String: writer.String("String"); break;
+                    }
+                    writer.EndObject();
+                    break;
+                }
+            }
+            writer.EndArray();
+
+            writer.EndObject(); // node
+        }
+
+        writer.EndArray(); // nodes
+
+        writer.Key("connections");
+        writer.StartArray();
+
+        for (const auto& connection : provider._connections)
+        {
+            ln_Pin from_pin = provider.copy(connection.second.pin_from);
+            ln_Pin to_pin = provider.copy(connection.second.pin_to);
+            if (!from_pin.valid || !to_pin.valid)
+                continue;
+
+            auto from_node = provider._noodleNodes.find(connection.second.node_from);
+            if (from_node == provider._noodleNodes.end())
+                continue;
+            std::string from_node_name = from_node->second.name;
+            auto to_node = provider._noodleNodes.find(connection.second.node_to);
+            if (to_node == provider._noodleNodes.end())
+                continue;
+            std::string to_node_name = to_node->second.name;
+
+            auto to_pin_it = provider._noodlePins.find(to_pin);
+            if (to_pin_it == provider._noodlePins.end())
+                continue;
+
+            NoodlePin to_pin_ = to_pin_it->second;
+
+            std::string to_pin_name = to_pin_.name;
+
+            auto from_pin_it = provider._noodlePins.find(from_pin);
+            if (from_pin_it == provider._noodlePins.end())
+                continue;
+
+            NoodlePin from_pin_ = from_pin_it->second;
+
+            std::string from_pin_name = from_pin_.name;
+
+            writer.StartObject();
+            writer.Key("from_node");
+            writer.String(from_node_name.c_str());
+            writer.Key("from_pin");
+            writer.String(from_pin_name.c_str());
+            writer.Key("to_node");
+            writer.String(to_node_name.c_str());
+            writer.Key("to_pin");
+            writer.String(to_pin_name.c_str());
+            writer.Key("to_pin_kind");
+            if (connection.second.kind == NoodleConnection::Kind::ToParam)
+                writer.String("param");
+            else
+                writer.String("bus");
+            writer.EndObject();
+        }
+        writer.EndArray(); // connections
+
+        AudioDeviceSettings device = provider.device_settings();
+        writer.Key("device");
+        writer.StartObject();
+        writer.Key("output_device");
+        writer.String(device.output_device.c_str());
+        writer.Key("input_device");
+        writer.String(device.input_device.c_str());
+        writer.Key("with_input");
+        writer.Bool(device.with_input);
+        writer.Key("sample_rate");
+        writer.Double(device.sample_rate);
+        writer.Key("output_channels");
+        writer.Int(device.output_channels);
+        writer.Key("input_channels");
+        writer.Int(device.input_channels);
+        writer.EndObject(); // device
+
+        writer.EndObject(); // LabSoundGraphToy
+        writer.EndObject(); // outer scope
+
+        return s.GetString();
+    }
+
+    void GraphCore::save_json(const std::string& path)
+    {
+        // samples loaded from a bundle are addressed by their content, which
+        // only the bundle resolves, so they are written out beside the patch
+        std::string stem = path;
+        size_t o = stem.find_last_of("./\\");
+        if (o != std::string::npos && stem[o] == '.')
+            stem = stem.substr(0, o);
+        for (auto& p : provider._noodlePins)
+        {
+            NoodlePin& pin = p.second;
+            uint64_t address;
+            if (pin.dataType != NoodlePin::DataType::Bus || !parse_content_address(pin.source, address))
+                continue;
+
+            BusData bus;
+            std::string sample_path = stem + "." + pin.source.substr(1) + ".wav";
+            if (!provider.pin_bus_value(pin.pin_id, bus) || !write_wav(sample_path, bus))
+            {
+                printf("Could not write the sample %s to %s\n", pin.source.c_str(), sample_path.c_str());
+                continue;
+            }
+            pin.source = sample_path;
+            o = sample_path.find_last_of("/\\");
+            pin.value_as_string = o != std::string::npos ? sample_path.substr(o + 1) : sample_path;
+            hash.touch_node(pin.node_id);
+        }
+
+        std::string json = serialize_json([](const NoodlePin& pin) { return pin.source; });
+
+        std::ofstream file(path, std::ios::binary);
+        file << json;
+        file.flush();
+
+        hash.mark_saved(provider);
+    }
+
+    void GraphCore::save_bundle(const std::string& path)
+    {
+        BundleWriter writer;
+        std::string json = serialize_json([&](const NoodlePin& pin) -> std::string
+        {
+            BusData bus;
+            if (!provider.pin_bus_value(pin.pin_id, bus))
+                return "";
+            return content_address(writer.add_sample(bus));
+        });
+
+        writer.set_patch(json);
+        if (writer.write(path))
+            hash.mark_saved(provider);
+    }
+
+    bool GraphCore::load(const std::string& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+        {
+            printf("Could not open %s\n", path.c_str());
+            return false;
+        }
+        std::stringstream ss;
+        ss << file.rdbuf();
+
+        // samples already handed to the audio engine keep the previous bundle alive
+        bundle.reset();
+        return load_json(ss.str().c_str());
+    }
+
+    bool GraphCore::load_bundle(const std::string& path)
+    {
+        std::shared_ptr<Bundle> bundle = Bundle::open(path);
+        if (!bundle)
+            return false;
+
+        // samples already handed to the audio engine keep the previous bundle alive
+        this->bundle = bundle;
+        return load_json(bundle->patch().c_str());
+    }
+
+    bool GraphCore::load_json(const char* json)
+    {
+        return queue_load(json, nullptr, true);
+    }
+
+    void GraphCore::apply_device_settings(const AudioDeviceSettings& settings)
+    {
+        std::string json = serialize_json([](const NoodlePin& pin) { return pin.source; });
+        queue_load(json.c_str(), &settings, false);
+    }
+
+    bool GraphCore::queue_load(const char* json, const AudioDeviceSettings* device, bool mark_saved)
+    {
+        rapidjson::Document d;
+        d.Parse(json);
+        if (d.HasParseError() || !d.IsObject() || !d.HasMember("LabSoundGraphToy"))
+        {
+            printf("Could not parse patch\n");
+            return false;
+        }
+
+        {
+            Work work(provider, root);
+            work.type = WorkType::ClearScene;
+            pending_work.emplace_back(std::move(work));
+        }
+
+        bool load_succeeded = true;
+
+        auto& dom = d["LabSoundGraphToy"];
+        auto doc_root = dom.GetObject();
+
+        // the device is configured before the Device node reopens the context.
+        // patches saved before devices were configurable keep the current settings.
+        AudioDeviceSettings settings = provider.device_settings();
+        bool has_settings = device != nullptr;
+        if (device)
+            settings = *device;
+        else if (doc_root.HasMember("device") && doc_root["device"].IsObject())
+        {
+            auto device_root = doc_root["device"].GetObject();
+            auto get_string = [&](const char* key, std::string& value) {
+                auto it = device_root.FindMember(key);
+                if (it != device_root.MemberEnd() && it->value.IsString())
+                    value = it->value.GetString();
+            };
+            auto get_int = [&](const char* key, int& value) {
+                auto it = device_root.FindMember(key);
+                if (it != device_root.MemberEnd() && it->value.IsInt())
+                    value = it->value.GetInt();
+            };
+            get_string("output_device", settings.output_device);
+            get_string("input_device", settings.input_device);
+            get_int("output_channels", settings.output_channels);
+            get_int("input_channels", settings.input_channels);
+            auto with_input = device_root.FindMember("with_input");
+            if (with_input != device_root.MemberEnd() && with_input->value.IsBool())
+                settings.with_input = with_input->value.GetBool();
+            auto sample_rate = device_root.FindMember("sample_rate");
+            if (sample_rate != device_root.MemberEnd() && sample_rate->value.IsNumber())
+                settings.sample_rate = static_cast<float>(sample_rate->value.GetDouble());
+            has_settings = true;
+        }
+        if (has_settings && settings != provider.device_settings())
+        {
+            Work work(provider, root);
+            work.type = WorkType::SetDeviceSettings;
+            work.device_settings = settings;
+            pending_work.emplace_back(std::move(work));
+        }
+
+        // create all the nodes
+
+        auto& nodes_root = doc_root["nodes"];
+        auto nodes_array = nodes_root.GetArray();
+
+        // the Device goes first, as it opens the context the other nodes are
+        // created in, which new device settings will have closed
+        std::vector<rapidjson::Value*> nodes_in_order;
+        for (auto& node : nodes_array)
+            if (std::string(node["kind"].GetString()) == "Device")
+                nodes_in_order.push_back(&node);
+        for (auto& node : nodes_array)
+            if (std::string(node["kind"].GetString()) != "Device")
+                nodes_in_order.push_back(&node);
+
+        for (rapidjson::Value* node_value : nodes_in_order)
+        {
+            auto& node = *node_value;
+            std::string node_name = node["name"].GetString();
+            {
+                Work work(provider, root);
+                work.type = WorkType::CreateNode;
+                work.name = node_name;
+                work.kind = node["kind"].GetString();
+                work.group_node = ln_Node_null();
+                auto pos_array = node["pos"].GetArray();
+                float x = pos_array[0].GetFloat();
+                float y = pos_array[1].GetFloat();
+                work.canvas_pos = { x, y };
+                pending_work.emplace_back(std::move(work));
+            }
+
+            auto pins_array = node["pins"].GetArray();
+            for (auto& pin_root : pins_array)
+            {
+                std::string name = pin_root["name"].GetString();
+                std::string kind = pin_root["kind"].GetString();
+                std::string value;
+                auto it = pin_root.FindMember("value");
+                if (it != pin_root.MemberEnd())
+                {
+                    value = it->value.GetString();
+                }
+                if (kind == "param")
+                {
+                    if (value.length() > 0)
+                    {
+                        Work work(provider, root);
+                        work.name = name;
+                        work.kind = node_name;
+                        work.param_pin = ln_Pin_null();
+                        work.type = WorkType::SetParam;
+                        work.float_value = static_cast<float>(std::atof(value.c_str()));
+                        pending_work.emplace_back(std::move(work));
+                    }
+                }
+                else if (kind == "setting")
+                {
+                    if (value.length() > 0)
+                    {
+                        std::string type = pin_root["type"].GetString();
+                        if (type == "None") {}
+                        else if (type == "Bus")
+                        {
+                            Work work(provider, root);
+                            work.name = name;
+                            work.kind = node_name;
+                            work.setting_pin = ln_Pin_null();
+                            work.type = WorkType::SetBusSetting;
+                            work.string_value = value;
+                            pending_work.emplace_back(std::move(work));
+                        }
+                        else if (type == "Bool") 
+                        {
+                            Work work(provider, root);
+                            work.name = name;
+                            work.kind = node_name;
+                            work.setting_pin = ln_Pin_null();
+                            work.type = WorkType::SetBoolSetting;
+                            work.bool_value = value == "True" || value == "1";
+                            pending_work.emplace_back(std::move(work));
+                        }
+                        else if (type == "Integer") 
+                        {
+                            Work work(provider, root);
+                            work.name = name;
+                            work.kind = node_name;
+                            work.setting_pin = ln_Pin_null();
+                            work.type = WorkType::SetIntSetting;
+                            work.int_value = std::atoi(value.c_str());
+                            pending_work.emplace_back(std::move(work));
+                        }
+                        else if (type == "Enumeration") 
+                        {
+                            Work work(provider, root);
+                            work.name = name;
+                            work.kind = node_name;
+                            work.setting_pin = ln_Pin_null();
+                            work.type = WorkType::SetEnumerationSetting;
+                            work.string_value = value;
+                            pending_work.emplace_back(std::move(work));
+                        }
+                        else if (type == "Float") 
+                        {
+                            Work work(provider, root);
+                            work.name = name;
+                            work.kind = node_name;
+                            work.setting_pin = ln_Pin_null();
+                            work.type = WorkType::SetFloatSetting;
+                            work.float_value = static_cast<float>(std::atof(value.c_str()));
+                            pending_work.emplace_back(std::move(work));
+                        }
+                        else if (type == "String")
+                        {
+                        }
+                    }
+                }
+                else if (kind == "bus_out")
+                {
+                    Work work(provider, root);
+                    work.name = name;
+                    work.kind = node_name;
+                    work.setting_pin = ln_Pin_null();
+                    work.type = WorkType::CreateOutput;
+                    work.int_value = 1;     /// @TODO save the channel count in the save path
+                    pending_work.emplace_back(std::move(work));
+                }
+            }
+        }
+
+        // make all the connections
+
+        auto& connections_root = doc_root["connections"];
+        auto connections_array = connections_root.GetArray();
+        for (auto& node : connections_array)
+        {
+            Work work(provider, root);
+            work.pendingConnection = std::make_unique<WorkPendingConnection>();
+            work.pendingConnection->from_node = node["from_node"].GetString();
+            work.pendingConnection->from_pin = node["from_pin"].GetString();
+            work.pendingConnection->to_node = node["to_node"].GetString();
+            work.pendingConnection->to_pin = node["to_pin"].GetString();
+            work.pendingConnection->to_pin_kind = node["to_pin_kind"].GetString();
+
+            if (work.pendingConnection->to_pin_kind == "bus")
+                work.type = WorkType::ConnectBusOutToBusIn;
+            else
+                work.type = WorkType::ConnectBusOutToParamIn;
+
+            pending_work.emplace_back(std::move(work));
+        }
+
+        if (load_succeeded && mark_saved)
+        {
+            // the loaded patch is the saved state, once the work above is done
+            Work work(provider, root);
+            work.type = WorkType::MarkSaved;
+            pending_work.emplace_back(std::move(work));
+        }
+        return true;
+    }
+
+    bool GraphCore::needs_saving()
+    {
+        return hash.need_saving(provider);
+    }
+
+    uint64_t GraphCore::content_hash()
+    {
+        return hash.value(provider);
+    }
+
+    std::string GraphCore::canonical_serialization()
+    {
+        std::vector<std::string> records;
+        for (auto& n : provider._noodleNodes)
+            records.push_back(hash.canonical_node(provider, n.second));
+        for (auto& c : provider._connections)
+            records.push_back(hash.canonical_connection(provider, c.second));
+        records.push_back(hash.canonical_device(provider));
+
+        std::sort(records.begin(), records.end());
+        std::string result;
+        for (auto& r : records)
+        {
+            result += r;
+            result += '\n';
+        }
+        return result;
+    }
+
+    void GraphCore::clear_all()
+    {
+        Work work(provider, root);
+        work.type = WorkType::ClearScene;
+        pending_work.emplace_back(std::move(work));
+    }
+
+}} // lab::noodle
@@ -0,0 +1,246 @@
+#ifndef included_noodle_core_h
+#define included_noodle_core_h
+
+/*
+    GraphCore is the model and command layer of a graph document: the root
+    canvas, the queue of pending edits, the content hash, and reading and
+    writing documents. It has no dependency on ImGui, or on a window, so a
+    graph can be built, edited, saved and loaded headlessly, for example by
+    tests, benchmarks, or tools processing patches on a server.
+
+    Edits are expressed as Work, queued in pending_work, and applied when
+    process_pending_work is called. ProviderHarness queues Work in response
+    to user interaction, and processes it once per frame.
+*/
+
+#include "lab_noodle.h"
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace lab { namespace noodle {
+
+    class Bundle;
+    struct GraphCore;
+
+    enum class WorkType
+    {
+        Nop, 
+        ClearScene, 
+        CreateRuntimeContext, 
+        CreateGroup, CreateOutput,
+        CreateNode, DeleteNode, 
+        SetParam,
+        SetFloatSetting, SetIntSetting, SetBoolSetting, SetBusSetting,
+        SetEnumerationSetting,
+        ConnectBusOutToBusIn, ConnectBusOutToParamIn,
+        DisconnectInFromOut,
+        Start, Bang,
+        SetDeviceSettings,
+        MarkSaved
+    };
+
+    // the enumerator's name, for reports
+    const char* work_type_name(WorkType type);
+
+    struct WorkPendingConnection
+    {
+        std::string from_node;
+        std::string from_pin;
+        std::string to_node;
+        std::string to_pin;
+        std::string to_pin_kind;
+    };
+
+    // The content hash is the sum of the hashes of the canonical records of
+    // every node and connection, and of the patch's device settings, so it
+    // doesn't depend on the order in which things were created, and edits
+    // that cancel out leave it unchanged.
+    // Work touches the elements it modifies, and only touched elements are
+    // rehashed when the hash is brought up to date.
+    struct ContentHash
+    {
+        void touch_node(ln_Node node)
+        {
+            _touched_nodes.insert(node.id);
+        }
+        void touch_connection(ln_Connection connection)
+        {
+            _touched_connections.insert(connection.id);
+        }
+        void update(Provider& provider);
+        void clear()
+        {
+            _node_hashes.clear();
+            _connection_hashes.clear();
+            _touched_nodes.clear();
+            _touched_connections.clear();
+            _device_hash = 0;
+            _content_hash = 0;
+            _saved_hash = 0;
+        }
+        void mark_saved(Provider& provider)
+        {
+            update(provider);
+            _saved_hash = _content_hash;
+        }
+        bool need_saving(Provider& provider)
+        {
+            update(provider);
+            return _saved_hash != _content_hash;
+        }
+        uint64_t value(Provider& provider)
+        {
+            update(provider);
+            return _content_hash;
+        }
+
+        // canonical records are independent of entity ids and creation order
+        std::string canonical_node(Provider& provider, const NoodleNode& node) const;
+        std::string canonical_connection(Provider& provider, const NoodleConnection& connection) const;
+        std::string canonical_device(Provider& provider) const;
+
+    private:
+        std::map<uint64_t, uint64_t> _node_hashes;
+        std::map<uint64_t, uint64_t> _connection_hashes;
+        std::set<uint64_t> _touched_nodes;
+        std::set<uint64_t> _touched_connections;
+        uint64_t _device_hash = 0;  // rehashed on every update, as it is cheap
+        uint64_t _content_hash = 0; // zero is reserved for empty
+        uint64_t _saved_hash = 0;
+    };
+
+    struct Work
+    {
+        Provider& provider;
+        CanvasGroup& root;
+        WorkType type = WorkType::Nop;
+
+        std::unique_ptr<WorkPendingConnection> pendingConnection;
+
+        std::string kind;
+        std::string name;
+
+        ln_Node group_node = ln_Node_null();
+        ln_Node input_node = ln_Node_null();
+        ln_Node output_node = ln_Node_null();
+        ln_Pin output_pin = ln_Pin_null();
+        ln_Pin param_pin = ln_Pin_null();
+        ln_Pin setting_pin = ln_Pin_null();
+        ln_Connection connection_id = ln_Connection_null();
+
+        float float_value = 0.f;
+        int int_value = 0;
+        bool bool_value = false;
+        std::string string_value;
+        vec2 canvas_pos = { 0, 0 };
+        AudioDeviceSettings device_settings;
+
+        Work() = delete;
+        ~Work() = default;
+
+        explicit Work(Provider& provider, CanvasGroup& root)
+            : provider(provider), root(root)
+        {
+        }
+
+        explicit Work(Work&& rh) noexcept
+        : provider(rh.provider), root(rh.root)
+        , type(rh.type), kind(rh.kind), name(rh.name)
+        , group_node(rh.group_node), input_node(rh.input_node), output_node(rh.output_node)
+        , output_pin(rh.output_pin)
+        , param_pin(rh.param_pin)
+        , setting_pin(rh.setting_pin)
+        , connection_id(rh.connection_id)
+        , float_value(rh.float_value), int_value(rh.int_value), bool_value(rh.bool_value)
+        , string_value(rh.string_value), canvas_pos(rh.canvas_pos)
+        , device_settings(rh.device_settings)
+        {
+            std::swap(pendingConnection, rh.pendingConnection);
+
+        }
+
+        void eval(GraphCore& core);
+
+    private:
+        void delete_connections_and_pins(ln_Node id, GraphCore& core);
+        NoodlePin* find_pin_named(const std::string& node_name, const std::string& pin_name);
+
+        // values set by name don't pass through the pin editor, so the pin's
+        // string value is brought up to date here.
+        void touch_pin(GraphCore& core, ln_Pin pin_id, const std::string& value);
+    };
+
+    // the node names handed out in one graph. given a proposed name, of the
+    // form name, or name-1, make creates a new unique name of the form name-2.
+    class UniqueNames
+    {
+    public:
+        std::string make(std::string proposed_name);
+        void clear();
+
+    private:
+        std::unordered_map<std::string, int> _bases;
+        std::unordered_set<std::string> _names;
+    };
+
+    struct GraphCore
+    {
+        explicit GraphCore(Provider& provider);
+        ~GraphCore();
+
+        Provider& provider;
+        CanvasGroup root;
+        ContentHash hash;
+        UniqueNames unique_names;
+        std::vector<Work> pending_work;
+        ln_Node device_node = ln_Node_null();
+
+        // the bundle the current patch was loaded from, if any
+        std::shared_ptr<Bundle> bundle;
+
+        // queues the creation of the runtime context, and marks the
+        // resulting document as saved
+        void init(vec2 device_pos);
+
+        // applies, and then discards, all pending work
+        void process_pending_work();
+
+        // the operations below queue work, and take effect when it is processed,
+        // except for saving and exporting which take immediate effect.
+        bool needs_saving();
+        uint64_t content_hash();
+        std::string canonical_serialization();
+
+        // bus_value provides the value written for Bus settings
+        std::string serialize_json(const std::function<std::string(const NoodlePin&)>& bus_value);
+
+        // the loads return false, and report the problem, if the patch can't be read
+        bool load_json(const char* json);
+        bool load(const std::string& path);
+        bool load_bundle(const std::string& path);
+        void save_json(const std::string& path);
+        void save_bundle(const std::string& path);
+        void save_test(const std::string& path);
+        void export_cpp(const std::string& path);
+        void export_cpp_static(const std::string& path, bool with_benchmark);
+        void clear_all();
+
+        // the graph is cleared, the runtime context is reopened with the new
+        // settings, and the graph is rebuilt. The document is left unsaved.
+        void apply_device_settings(const AudioDeviceSettings& settings);
+
+    private:
+        // device, if not null, replaces the patch's own device settings
+        bool queue_load(const char* json, const AudioDeviceSettings* device, bool mark_saved);
+    };
+
+} } // lab::noodle
+
+#endif
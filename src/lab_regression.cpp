@@ -0,0 +1,330 @@
+
+#include "lab_regression.h"
+#include "lab_hash.h"
+
+#include <LabSound/LabSound.h>
+
+#include <rapidjson/document.h>
+#include <rapidjson/prettywriter.h>
+#include <rapidjson/stringbuffer.h>
+
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+namespace lab { namespace noodle {
+
+    namespace {
+
+        // band edges are spaced logarithmically between these frequencies,
+        // bands reaching above nyquist are left out
+        const int spectrum_bands = 24;
+        const double spectrum_low_hz = 40.0;
+        const double spectrum_high_hz = 16000.0;
+
+        // Hann windows overlapping by half; a power of two, for the FFT
+        const int spectrum_window = 4096;
+        const int spectrum_hop = spectrum_window / 2;
+
+        // bands quieter than this in both renders are considered silent, and equal
+        const float silence_db = -100.f;
+
+        const double pi = 3.14159265358979323846;
+
+        float to_db(double power)
+        {
+            return static_cast<float>(10.0 * std::log10(power + 1e-20));
+        }
+
+        // in place iterative radix 2 FFT, the size must be a power of two
+        void fft(std::vector<std::complex<double>>& x)
+        {
+            const size_t n = x.size();
+            for (size_t i = 1, j = 0; i < n; ++i)
+            {
+                size_t bit = n >> 1;
+                for (; j & bit; bit >>= 1)
+                    j ^= bit;
+                j ^= bit;
+                if (i < j)
+                    std::swap(x[i], x[j]);
+            }
+            for (size_t len = 2; len <= n; len <<= 1)
+            {
+                const std::complex<double> step = std::polar(1.0, -2.0 * pi / static_cast<double>(len));
+                for (size_t i = 0; i < n; i += len)
+                {
+                    std::complex<double> w(1.0, 0.0);
+                    for (size_t k = 0; k < len / 2; ++k, w *= step)
+                    {
+                        std::complex<double> even = x[i + k];
+                        std::complex<double> odd = x[i + k + len / 2] * w;
+                        x[i + k] = even + odd;
+                        x[i + k + len / 2] = even - odd;
+                    }
+                }
+            }
+        }
+
+    } // anon
+
+    bool fingerprint_wav(const std::string& path, AudioFingerprint& fingerprint)
+    {
+        std::shared_ptr<lab::AudioBus> bus = lab::MakeBusFromFile(path.c_str(), false);
+        if (!bus)
+        {
+            printf("Could not read %s\n", path.c_str());
+            return false;
+        }
+
+        const int channels = static_cast<int>(bus->numberOfChannels());
+        const int frames = static_cast<int>(bus->length());
+        const double sample_rate = bus->sampleRate();
+
+        fingerprint = AudioFingerprint();
+        fingerprint.duration = sample_rate > 0 ? frames / sample_rate : 0;
+
+        uint64_t h = hash_mix(static_cast<uint64_t>(channels));
+        std::vector<float> mono(frames, 0.f);
+        for (int c = 0; c < channels; ++c)
+        {
+            const float* data = bus->channel(c)->data();
+            h = hash_bytes(data, sizeof(float) * frames, h);
+            for (int i = 0; i < frames; ++i)
+                mono[i] += data[i] / channels;
+        }
+        fingerprint.sample_hash = h;
+
+        // the power spectrum averaged over every window, scaled so that
+        // the bins sum to the mean square of the windowed signal
+        std::vector<double> window(spectrum_window);
+        double window_energy = 0;
+        for (int i = 0; i < spectrum_window; ++i)
+        {
+            window[i] = 0.5 - 0.5 * std::cos(2.0 * pi * i / spectrum_window);
+            window_energy += window[i] * window[i];
+        }
+
+        const int bins = spectrum_window / 2 + 1;
+        std::vector<double> power(bins, 0.0);
+        std::vector<std::complex<double>> buffer(spectrum_window);
+        int windows = 0;
+        for (int start = 0; start + spectrum_window <= frames; start += spectrum_hop, ++windows)
+        {
+            for (int i = 0; i < spectrum_window; ++i)
+                buffer[i] = std::complex<double>(mono[start + i] * window[i], 0.0);
+            fft(buffer);
+            for (int k = 0; k < bins; ++k)
+            {
+                // bins other than DC and nyquist also hold the negative frequencies
+                double scale = (k == 0 || k == bins - 1) ? 1.0 : 2.0;
+                power[k] += scale * std::norm(buffer[k]) / (window_energy * spectrum_window);
+            }
+        }
+        if (windows > 0)
+            for (double& p : power)
+                p /= windows;
+
+        // each band sums the bins whose frequency lies between its edges
+        const double nyquist = sample_rate * 0.5;
+        const double bin_hz = sample_rate / spectrum_window;
+        const double ratio = std::pow(spectrum_high_hz / spectrum_low_hz, 1.0 / spectrum_bands);
+        double low = spectrum_low_hz;
+        for (int b = 0; b < spectrum_bands; ++b, low *= ratio)
+        {
+            double high = low * ratio;
+            if (high > nyquist)
+                break;
+
+            double band_power = 0;
+            for (int k = static_cast<int>(std::ceil(low / bin_hz)); k < bins && k * bin_hz < high; ++k)
+                band_power += power[k];
+            fingerprint.spectrum.push_back(to_db(band_power));
+        }
+        return true;
+    }
+
+    bool read_regression_reference(const std::string& path, RegressionReference& reference)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+        {
+            printf("Could not open %s\n", path.c_str());
+            return false;
+        }
+        std::stringstream ss;
+        ss << file.rdbuf();
+        std::string json = ss.str();
+
+        rapidjson::Document d;
+        d.Parse(json.c_str());
+        if (d.HasParseError() || !d.IsObject() || !d.HasMember("patches") || !d["patches"].IsObject())
+        {
+            printf("Could not parse regression reference %s\n", path.c_str());
+            return false;
+        }
+
+        reference.clear();
+        for (auto& patch : d["patches"].GetObject())
+        {
+            const char* name = patch.name.GetString();
+            if (!patch.value.IsObject())
+            {
+                printf("%s: %s is not an object\n", path.c_str(), name);
+                return false;
+            }
+
+            auto patch_root = patch.value.GetObject();
+            auto get_number = [&](const char* key, double& value)
+            {
+                auto it = patch_root.FindMember(key);
+                if (it == patch_root.MemberEnd())
+                    return true;
+                if (!it->value.IsNumber())
+                {
+                    printf("%s: %s has a %s that is not a number\n", path.c_str(), name, key);
+                    return false;
+                }
+                value = it->value.GetDouble();
+                return true;
+            };
+
+            RegressionEntry entry;
+            if (!get_number("duration", entry.fingerprint.duration) ||
+                !get_number("wall_seconds", entry.wall_seconds))
+                return false;
+
+            auto hash_it = patch_root.FindMember("sample_hash");
+            if (hash_it != patch_root.MemberEnd())
+            {
+                uint64_t hash = 0;
+                if (!hash_it->value.IsString() || !parse_content_address(hash_it->value.GetString(), hash))
+                {
+                    printf("%s: %s has a sample_hash that is not a content address\n", path.c_str(), name);
+                    return false;
+                }
+                entry.fingerprint.sample_hash = hash;
+            }
+
+            auto spectrum_it = patch_root.FindMember("spectrum");
+            if (spectrum_it != patch_root.MemberEnd())
+            {
+                if (!spectrum_it->value.IsArray())
+                {
+                    printf("%s: %s has a spectrum that is not an array\n", path.c_str(), name);
+                    return false;
+                }
+                for (auto& band : spectrum_it->value.GetArray())
+                {
+                    if (!band.IsNumber())
+                    {
+                        printf("%s: %s has a spectrum band that is not a number\n", path.c_str(), name);
+                        return false;
+                    }
+                    entry.fingerprint.spectrum.push_back(static_cast<float>(band.GetDouble()));
+                }
+            }
+
+            reference[name] = entry;
+        }
+        return true;
+    }
+
+    bool write_regression_reference(const std::string& path, const RegressionReference& reference)
+    {
+        // pretty printed, so that changes to a reference checked in to
+        // source control can be reviewed
+        rapidjson::StringBuffer s;
+        rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(s);
+        // microseconds, so the time tolerance still applies to patches
+        // that render in a few milliseconds
+        writer.SetMaxDecimalPlaces(6);
+        writer.StartObject();
+        writer.Key("patches");
+        writer.StartObject();
+        for (auto& patch : reference)
+        {
+            writer.Key(patch.first.c_str());
+            writer.StartObject();
+            writer.Key("sample_hash");
+            writer.String(content_address(patch.second.fingerprint.sample_hash).c_str());
+            writer.Key("duration");
+            writer.Double(patch.second.fingerprint.duration);
+            writer.Key("wall_seconds");
+            writer.Double(patch.second.wall_seconds);
+            writer.Key("spectrum");
+            writer.SetMaxDecimalPlaces(3);
+            writer.SetFormatOptions(rapidjson::kFormatSingleLineArray);
+            writer.StartArray();
+            for (float band : patch.second.fingerprint.spectrum)
+                writer.Double(band);
+            writer.EndArray();
+            writer.SetFormatOptions(rapidjson::kFormatDefault);
+            writer.SetMaxDecimalPlaces(6);
+            writer.EndObject();
+        }
+        writer.EndObject();
+        writer.EndObject();
+
+        std::ofstream file(path, std::ios::binary);
+        if (!file)
+        {
+            printf("Could not write %s\n", path.c_str());
+            return false;
+        }
+        file << s.GetString() << "\n";
+        return true;
+    }
+
+    bool compare_regression(const std::string& name, const RegressionEntry& reference,
+        const RegressionEntry& current, const RegressionTolerance& tolerance)
+    {
+        bool pass = true;
+        const AudioFingerprint& ref = reference.fingerprint;
+        const AudioFingerprint& cur = current.fingerprint;
+
+        if (std::abs(ref.duration - cur.duration) > 1e-3)
+        {
+            printf("%s: rendered %.3f s, the reference is %.3f s\n", name.c_str(), cur.duration, ref.duration);
+            pass = false;
+        }
+        else if (ref.sample_hash != cur.sample_hash)
+        {
+            // not bit identical, see if it is close enough
+            if (ref.spectrum.size() != cur.spectrum.size())
+            {
+                printf("%s: spectrum has %d bands, the reference has %d\n", name.c_str(),
+                    (int) cur.spectrum.size(), (int) ref.spectrum.size());
+                pass = false;
+            }
+            else
+            {
+                for (size_t b = 0; b < ref.spectrum.size(); ++b)
+                {
+                    if (ref.spectrum[b] < silence_db && cur.spectrum[b] < silence_db)
+                        continue;
+
+                    float delta = std::abs(ref.spectrum[b] - cur.spectrum[b]);
+                    if (delta > tolerance.spectrum_db)
+                    {
+                        printf("%s: band %d differs by %.2f dB\n", name.c_str(), (int) b, delta);
+                        pass = false;
+                    }
+                }
+            }
+        }
+
+        if (reference.wall_seconds > 0 && current.wall_seconds > reference.wall_seconds * tolerance.time_ratio &&
+            current.wall_seconds - reference.wall_seconds > tolerance.time_floor)
+        {
+            printf("%s: rendered in %.3f ms, the reference is %.3f ms (%.0f%% slower)\n", name.c_str(),
+                current.wall_seconds * 1000.0, reference.wall_seconds * 1000.0,
+                100.0 * (current.wall_seconds / reference.wall_seconds - 1.0));
+            pass = false;
+        }
+        return pass;
+    }
+
+} } // lab::noodle
@@ -0,0 +1,66 @@
+#ifndef included_lab_regression_h
+#define included_lab_regression_h
+
+/*
+    Audio regression checking for rendered patches.
+
+    A rendered WAV is reduced to a fingerprint: a hash of its samples, which
+    only matches if the output is bit identical, and a coarse spectrum, the
+    power of Hann windowed FFTs summed between log spaced band edges, which
+    tolerates the small numeric differences a compiler or library upgrade
+    can introduce. A reference file records the fingerprint and render time
+    of every patch in a corpus, and later renders are compared against it.
+
+    A patch passes if its samples hash identically, or if every band of its
+    spectrum is within the spectrum tolerance of the reference. Independently,
+    a patch fails if it took longer than the reference render time multiplied
+    by the time tolerance, and by more than the time floor; a patch that
+    renders in a millisecond is otherwise at the mercy of the scheduler.
+*/
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace lab { namespace noodle {
+
+    struct AudioFingerprint
+    {
+        uint64_t sample_hash = 0;
+        std::vector<float> spectrum;    // mean power per band, in dB
+        double duration = 0;            // in seconds
+    };
+
+    struct RegressionEntry
+    {
+        AudioFingerprint fingerprint;
+        double wall_seconds = 0;        // time taken to render
+    };
+
+    struct RegressionTolerance
+    {
+        float spectrum_db = 1.f;
+        double time_ratio = 1.25;
+        double time_floor = 0.005;      // in seconds
+    };
+
+    // keyed by patch file name
+    using RegressionReference = std::map<std::string, RegressionEntry>;
+
+    // returns false and reports the problem if the file could not be read
+    bool fingerprint_wav(const std::string& path, AudioFingerprint& fingerprint);
+
+    // returns false and reports the problem if the file could not be read,
+    // or is not a reference
+    bool read_regression_reference(const std::string& path, RegressionReference& reference);
+    bool write_regression_reference(const std::string& path, const RegressionReference& reference);
+
+    // reports every difference found, and returns true if the current
+    // render is within tolerance of the reference
+    bool compare_regression(const std::string& name, const RegressionEntry& reference,
+        const RegressionEntry& current, const RegressionTolerance& tolerance);
+
+} } // lab::noodle
+
+#endif
@@ -0,0 +1,182 @@
+
+#include "lab_render.h"
+#include "lab_noodle_core.h"
+#include "lab_rt_guard.h"
+#include "LabSoundInterface.h"
+
+#include <LabSound/LabSound.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace lab { namespace noodle {
+
+    namespace {
+
+        // records the render, and marks the render thread for lab_rt_guard.h.
+        // the recording grows as it goes, so the recorder itself is exempt.
+        class GuardedRecorder : public lab::RecorderNode
+        {
+        public:
+            GuardedRecorder(lab::AudioContext& ac, const lab::AudioStreamConfig& config)
+                : RecorderNode(ac, config) {}
+
+            virtual void process(lab::ContextRenderLock& r, int bufferSize) override
+            {
+                rt_guard::mark_realtime_thread();
+                rt_guard::Exempt exempt;
+                RecorderNode::process(r, bufferSize);
+            }
+        };
+
+    } // anon
+
+    bool render_patch(const RenderOptions& options, RenderStats* stats)
+    {
+        // the context is opened for the patch's device settings, when the
+        // patch's Device node is created, unless the options override them
+        lab::AudioStreamConfig config;
+        auto open_context = [&options, &config](const AudioDeviceSettings& settings)
+        {
+            config.device_index = 0;
+            config.desired_channels = options.channels > 0 ? options.channels :
+                settings.output_channels > 0 ? settings.output_channels : 2;
+            config.desired_samplerate = options.sample_rate > 0 ? options.sample_rate :
+                settings.sample_rate > 0 ? settings.sample_rate : 48000.f;
+            return lab::MakeOfflineAudioContext(config, options.duration * 1000.0);
+        };
+
+        // everything connected to the Device is recorded
+        auto create_recorder = [&config](lab::AudioContext& ac) -> std::shared_ptr<lab::AudioNode>
+        {
+            std::shared_ptr<lab::RecorderNode> recorder = std::make_shared<GuardedRecorder>(ac, config);
+            recorder->startRecording();
+            return recorder;
+        };
+
+        // the provider must outlive the core
+        LabSoundProvider provider(open_context, create_recorder);
+        GraphCore core(provider);
+        core.init({ 0, 0 });
+        size_t ext = options.patch_path.find_last_of('.');
+        bool loaded = ext != std::string::npos && options.patch_path.substr(ext) == ".lsb" ?
+            core.load_bundle(options.patch_path) : core.load(options.patch_path);
+        core.process_pending_work();
+        if (!loaded)
+            return false;
+
+        std::shared_ptr<lab::RecorderNode> recorder = std::dynamic_pointer_cast<lab::RecorderNode>(provider.device_tap());
+        lab::AudioContext* context = provider.audio_context();
+        if (!recorder || !context)
+        {
+            printf("%s has no Device to record\n", options.patch_path.c_str());
+            return false;
+        }
+
+        // scheduled nodes start at time zero, as if play had been pressed
+        for (ln_Node n : core.root.nodes)
+        {
+            NoodleNode* node = provider.find_node(n);
+            if (node && node->play_controller)
+                provider.node_start_stop(n, 0.f);
+        }
+
+        if (stats)
+        {
+            MemoryReport memory;
+            provider.memory_report(memory);
+            stats->audio_bytes = memory.audio;
+        }
+
+        // the render is timed by the render thread itself, so that waking
+        // this thread does not add to it
+        std::mutex complete_mutex;
+        std::condition_variable complete_cv;
+        bool complete = false;
+        std::chrono::steady_clock::time_point start, end;
+        context->offlineRenderCompleteCallback = [&]()
+        {
+            end = std::chrono::steady_clock::now();
+            std::lock_guard<std::mutex> lock(complete_mutex);
+            complete = true;
+            complete_cv.notify_one();
+        };
+
+        start = std::chrono::steady_clock::now();
+        context->startOfflineRendering();
+        {
+            std::unique_lock<std::mutex> lock(complete_mutex);
+            complete_cv.wait(lock, [&complete]() { return complete; });
+        }
+        double wall = std::chrono::duration<double>(end - start).count();
+
+        recorder->stopRecording();
+        context->removeAutomaticPullNode(recorder);
+        recorder->writeRecordingToWav(options.output_path, false);
+
+        if (stats)
+        {
+            stats->succeeded = true;
+            stats->rendered_seconds = recorder->recordedLengthInSeconds();
+            stats->wall_seconds = wall;
+        }
+        return true;
+    }
+
+    int render_batch(const std::vector<RenderOptions>& jobs, int workers, RenderStats* total,
+        std::vector<RenderStats>* each)
+    {
+        if (workers < 1)
+            workers = std::max(1, (int) std::thread::hardware_concurrency());
+        workers = std::min(workers, (int) jobs.size());
+
+        std::atomic<size_t> next_job{ 0 };
+        std::atomic<int> failures{ 0 };
+        std::mutex total_mutex;
+        RenderStats sum;
+        if (each)
+            each->assign(jobs.size(), RenderStats());
+
+        auto start = std::chrono::steady_clock::now();
+
+        auto worker = [&]()
+        {
+            for (size_t i = next_job++; i < jobs.size(); i = next_job++)
+            {
+                RenderStats stats;
+                if (!render_patch(jobs[i], &stats))
+                {
+                    ++failures;
+                    continue;
+                }
+
+                std::lock_guard<std::mutex> lock(total_mutex);
+                if (each)
+                    (*each)[i] = stats;
+                sum.rendered_seconds += stats.rendered_seconds;
+                sum.audio_bytes += stats.audio_bytes;
+                printf("%s: rendered %.2f s in %.2f s, %.2f MB of audio memory\n", jobs[i].output_path.c_str(),
+                    stats.rendered_seconds, stats.wall_seconds, stats.audio_bytes / (1024.0 * 1024.0));
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (int i = 0; i < workers; ++i)
+            threads.emplace_back(worker);
+        for (auto& t : threads)
+            t.join();
+
+        sum.succeeded = failures == 0;
+        sum.wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (total)
+            *total = sum;
+        return failures;
+    }
+
+} } // lab::noodle
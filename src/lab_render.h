@@ -0,0 +1,51 @@
+#ifndef included_lab_render_h
+#define included_lab_render_h
+
+/*
+    Offline rendering of patches, with no window and no audio device.
+
+    A patch, or a bundle, is loaded as the editor loads it, through a
+    GraphCore and a LabSoundProvider, but into an offline LabSound context,
+    and rendered faster than realtime to a WAV file. Anything the patch
+    connects to its Device node is what is recorded. Scheduled nodes are
+    started at time zero, as if play had been pressed in the editor the
+    moment the patch was loaded.
+*/
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace lab { namespace noodle {
+
+    struct RenderOptions
+    {
+        std::string patch_path;     // a .ls patch, or a .lsb bundle
+        std::string output_path;    // a .wav file
+        double duration = 10.0;     // in seconds
+        float sample_rate = 0;      // zero for the patch's device settings, or 48 kHz
+        int channels = 0;           // zero for the patch's device settings, or stereo
+    };
+
+    struct RenderStats
+    {
+        bool succeeded = false;
+        double rendered_seconds = 0;
+        double wall_seconds = 0;
+        size_t audio_bytes = 0;     // owned by the patch's nodes once built, see lab_memory.h
+    };
+
+    // returns false and reports the problem if the patch could not be rendered
+    bool render_patch(const RenderOptions& options, RenderStats* stats = nullptr);
+
+    // renders every job, spread over worker threads that each take the next
+    // job from a shared queue, and render it through its own offline context.
+    // workers less than one means one per core. returns the number of jobs
+    // that failed; total accumulates the rendered time of the successful jobs,
+    // and each, if provided, receives the stats of every job in order.
+    int render_batch(const std::vector<RenderOptions>& jobs, int workers, RenderStats* total = nullptr,
+        std::vector<RenderStats>* each = nullptr);
+
+} } // lab::noodle
+
+#endif
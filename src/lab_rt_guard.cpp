@@ -0,0 +1,253 @@
+#include "lab_rt_guard.h"
+
+#if !LAB_RT_GUARD
+#error lab_rt_guard.cpp is compiled only with LAB_RT_GUARD defined as nonzero
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <execinfo.h>
+#endif
+
+#if defined(__linux__)
+#include <dlfcn.h>
+#include <pthread.h>
+#endif
+
+namespace lab { namespace noodle { namespace rt_guard {
+
+    namespace {
+
+        enum class Kind : int { Allocation, Free, Lock };
+        const char* kind_names[] = { "allocation", "free", "lock" };
+
+        const int max_depth = 32;
+        const int max_stacks = 256;
+
+        struct Stack
+        {
+            std::atomic<bool> ready{ false };
+            uint64_t hash = 0;
+            Kind kind = Kind::Allocation;
+            int depth = 0;
+            void* frames[max_depth];
+            std::atomic<uint64_t> count{ 0 };
+        };
+
+        Stack stacks[max_stacks];
+        std::atomic<int> next_stack{ 0 };
+
+        const int max_allowed_locks = 64;
+        std::atomic<const void*> allowed_locks[max_allowed_locks];
+        std::atomic<int> next_allowed_lock{ 0 };
+
+        std::atomic<bool> g_enabled{ false };
+        std::atomic<uint64_t> g_counts[3];
+
+        thread_local bool t_realtime = false;
+        thread_local bool t_in_hook = false;
+        thread_local bool t_allowing = false;
+
+        bool allowed(const void* mutex)
+        {
+            const int count = std::min(next_allowed_lock.load(std::memory_order_acquire), max_allowed_locks);
+            for (int i = 0; i < count; ++i)
+                if (allowed_locks[i].load(std::memory_order_relaxed) == mutex)
+                    return true;
+            return false;
+        }
+
+        void allow(const void* mutex)
+        {
+            if (allowed(mutex))
+                return;
+            const int i = next_allowed_lock.fetch_add(1, std::memory_order_acq_rel);
+            if (i < max_allowed_locks)
+                allowed_locks[i].store(mutex, std::memory_order_relaxed);
+        }
+
+        int capture(void** frames, int max)
+        {
+#if defined(_WIN32)
+            return (int) CaptureStackBackTrace(0, (DWORD) max, frames, nullptr);
+#else
+            return backtrace(frames, max);
+#endif
+        }
+
+        void report(Kind kind)
+        {
+            g_counts[(int) kind].fetch_add(1, std::memory_order_relaxed);
+
+            void* frames[max_depth];
+            int depth = capture(frames, max_depth);
+            uint64_t hash = 14695981039346656037ull ^ (uint64_t) kind;
+            for (int i = 0; i < depth; ++i)
+                hash = (hash ^ (uint64_t) (uintptr_t) frames[i]) * 1099511628211ull;
+
+            const int filled = std::min(next_stack.load(std::memory_order_acquire), max_stacks);
+            for (int i = 0; i < filled; ++i)
+            {
+                Stack& s = stacks[i];
+                if (s.ready.load(std::memory_order_acquire) && s.hash == hash)
+                {
+                    s.count.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+            }
+
+            // two threads may add the same stack at once, and it is then listed twice
+            const int i = next_stack.fetch_add(1, std::memory_order_acq_rel);
+            if (i >= max_stacks)
+                return;
+            Stack& s = stacks[i];
+            s.hash = hash;
+            s.kind = kind;
+            s.depth = depth;
+            memcpy(s.frames, frames, sizeof(void*) * depth);
+            s.count.store(1, std::memory_order_relaxed);
+            s.ready.store(true, std::memory_order_release);
+        }
+
+        void hook(Kind kind)
+        {
+            if (!g_enabled.load(std::memory_order_relaxed) || !t_realtime || t_in_hook)
+                return;
+
+            // capturing a stack may itself allocate or lock
+            t_in_hook = true;
+            report(kind);
+            t_in_hook = false;
+        }
+
+    } // anon
+
+    void mark_realtime_thread()
+    {
+        t_realtime = true;
+    }
+
+    void enable(bool enabled)
+    {
+        if (enabled)
+        {
+            // the first capture loads the unwinder, which allocates, so it happens here
+            void* frames[4];
+            capture(frames, 4);
+        }
+        g_enabled.store(enabled);
+    }
+
+    bool enabled()
+    {
+        return g_enabled.load();
+    }
+
+    Counts counts()
+    {
+        Counts c;
+        c.allocations = g_counts[(int) Kind::Allocation].load(std::memory_order_relaxed);
+        c.frees = g_counts[(int) Kind::Free].load(std::memory_order_relaxed);
+        c.locks = g_counts[(int) Kind::Lock].load(std::memory_order_relaxed);
+        return c;
+    }
+
+    void reset()
+    {
+        for (auto& c : g_counts)
+            c.store(0);
+        const int filled = std::min(next_stack.load(), max_stacks);
+        for (int i = 0; i < filled; ++i)
+            stacks[i].ready.store(false);
+        next_stack.store(0);
+    }
+
+    void print_stacks(FILE* f)
+    {
+        Counts c = counts();
+        fprintf(f, "audio thread: %llu allocations, %llu frees, %llu locks\n",
+            (unsigned long long) c.allocations, (unsigned long long) c.frees, (unsigned long long) c.locks);
+
+        const int filled = std::min(next_stack.load(), max_stacks);
+        for (int i = 0; i < filled; ++i)
+        {
+            Stack& s = stacks[i];
+            if (!s.ready.load(std::memory_order_acquire))
+                continue;
+
+            fprintf(f, "%s, %llu times\n", kind_names[(int) s.kind], (unsigned long long) s.count.load());
+
+            // the first frames are the guard's own
+#if defined(_WIN32)
+            for (int j = 2; j < s.depth; ++j)
+                fprintf(f, "    %p\n", s.frames[j]);
+#else
+            char** symbols = backtrace_symbols(s.frames, s.depth);
+            for (int j = 2; j < s.depth; ++j)
+                fprintf(f, "    %s\n", symbols ? symbols[j] : "?");
+            free(symbols);
+#endif
+        }
+        if (next_stack.load() > max_stacks)
+            fprintf(f, "%d further stacks were not kept\n", next_stack.load() - max_stacks);
+    }
+
+    AllowLocks::AllowLocks()
+    {
+        t_allowing = true;
+    }
+
+    AllowLocks::~AllowLocks()
+    {
+        t_allowing = false;
+    }
+
+    Exempt::Exempt()
+        : _realtime(t_realtime)
+    {
+        t_realtime = false;
+    }
+
+    Exempt::~Exempt()
+    {
+        t_realtime = _realtime;
+    }
+
+    void on_allocation() { hook(Kind::Allocation); }
+    void on_free() { hook(Kind::Free); }
+
+    void on_lock(const void* mutex)
+    {
+        if (t_allowing)
+            allow(mutex);
+        else if (g_enabled.load(std::memory_order_relaxed) && t_realtime && !allowed(mutex))
+            hook(Kind::Lock);
+    }
+
+} } } // lab::noodle::rt_guard
+
+#if defined(__linux__)
+
+// std::mutex locks through pthread_mutex_lock, which this definition
+// interposes, forwarding to the C library's
+extern "C" int pthread_mutex_lock(pthread_mutex_t* mutex)
+{
+    using lock_fn = int (*)(pthread_mutex_t*);
+    static std::atomic<lock_fn> next{ nullptr };
+    lock_fn fn = next.load(std::memory_order_relaxed);
+    if (!fn)
+    {
+        fn = reinterpret_cast<lock_fn>(dlsym(RTLD_NEXT, "pthread_mutex_lock"));
+        next.store(fn, std::memory_order_relaxed);
+    }
+    lab::noodle::rt_guard::on_lock(mutex);
+    return fn(mutex);
+}
+
+#endif
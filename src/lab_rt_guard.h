@@ -0,0 +1,109 @@
+#ifndef included_lab_rt_guard_h
+#define included_lab_rt_guard_h
+
+/*
+    Detects allocation, freeing, and mutex locking on the audio render
+    thread, none of which has a bounded duration.
+
+    A node that the context pulls every quantum marks the render thread.
+    While the guard is enabled, the replaced operator new and delete of
+    lab_alloc_counter.cpp, and on Linux an interposed pthread_mutex_lock,
+    report to the guard when they run on a marked thread. Each distinct
+    call stack is kept with a count, in a fixed table, so the audio thread
+    neither allocates nor locks to record it; once the table is full, new
+    stacks are counted but not kept. Stacks are symbolized when printed.
+
+    A lock that is expected on the audio thread, such as the context's
+    render lock, which LabSound takes every quantum, is exempted by taking
+    it once while an AllowLocks is in scope.
+
+    Allocation through malloc directly isn't seen, nor are locks taken
+    other than through pthread_mutex_lock, or on other platforms.
+
+    The guard compiles to nothing unless LAB_RT_GUARD is defined as
+    nonzero, in which case the program must also link lab_rt_guard.cpp
+    and lab_alloc_counter.cpp. The renderer always does; the editor does
+    when built with the LABSOUNDGRAPHTOY_RT_GUARD option.
+*/
+
+#include <cstdint>
+#include <cstdio>
+
+#ifndef LAB_RT_GUARD
+#define LAB_RT_GUARD 0
+#endif
+
+namespace lab { namespace noodle { namespace rt_guard {
+
+    struct Counts
+    {
+        uint64_t allocations = 0;
+        uint64_t frees = 0;
+        uint64_t locks = 0;
+        uint64_t total() const { return allocations + frees + locks; }
+    };
+
+#if LAB_RT_GUARD
+
+    // called on the render thread, every quantum
+    void mark_realtime_thread();
+
+    void enable(bool enabled);
+    bool enabled();
+
+    Counts counts();
+
+    // clears the counts and the stacks, called when no render thread is reporting
+    void reset();
+
+    // prints each distinct stack recorded, with its count
+    void print_stacks(FILE* f);
+
+    // every mutex the constructing thread locks while this is in scope is
+    // exempted from then on, up to a small fixed number of them
+    class AllowLocks
+    {
+    public:
+        AllowLocks();
+        ~AllowLocks();
+        AllowLocks(const AllowLocks&) = delete;
+        AllowLocks& operator=(const AllowLocks&) = delete;
+    };
+
+    // nothing the constructing thread does while this is in scope is reported
+    class Exempt
+    {
+    public:
+        Exempt();
+        ~Exempt();
+        Exempt(const Exempt&) = delete;
+        Exempt& operator=(const Exempt&) = delete;
+
+    private:
+        bool _realtime;
+    };
+
+    // called by the allocator and lock hooks
+    void on_allocation();
+    void on_free();
+    void on_lock(const void* mutex);
+
+#else
+
+    inline void mark_realtime_thread() {}
+    inline void enable(bool) {}
+    inline bool enabled() { return false; }
+    inline Counts counts() { return {}; }
+    inline void reset() {}
+    inline void print_stacks(FILE*) {}
+    class AllowLocks {};
+    class Exempt {};
+    inline void on_allocation() {}
+    inline void on_free() {}
+    inline void on_lock(const void*) {}
+
+#endif
+
+} } } // lab::noodle::rt_guard
+
+#endif
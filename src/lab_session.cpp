@@ -0,0 +1,267 @@
+#include "lab_session.h"
+
+#include <cstring>
+
+namespace lab { namespace noodle {
+
+    namespace {
+
+        const char session_magic[8] = { 'L', 'S', 'G', 'T', 'S', 'E', 'S', '1' };
+
+        enum class Record : uint8_t
+        {
+            Input = 'I', Frame = 'F', Osc = 'O', Dialog = 'D'
+        };
+
+        // values are written in the host's byte order, sessions are meant to
+        // be replayed on the machine, or at least the kind of machine, that
+        // recorded them
+        template <typename T>
+        void put(std::vector<uint8_t>& out, const T& value)
+        {
+            const uint8_t* p = reinterpret_cast<const uint8_t*>(&value);
+            out.insert(out.end(), p, p + sizeof(T));
+        }
+
+        void put_string(std::vector<uint8_t>& out, const std::string& s)
+        {
+            uint16_t len = static_cast<uint16_t>(s.size() < 0xffff ? s.size() : 0xffff);
+            put(out, len);
+            out.insert(out.end(), s.begin(), s.begin() + len);
+        }
+
+        struct Reader
+        {
+            const std::vector<uint8_t>& in;
+            size_t pos = 0;
+            bool ok = true;
+
+            template <typename T>
+            T get()
+            {
+                T value{};
+                if (pos + sizeof(T) > in.size())
+                {
+                    ok = false;
+                    return value;
+                }
+                memcpy(&value, in.data() + pos, sizeof(T));
+                pos += sizeof(T);
+                return value;
+            }
+
+            std::string get_string()
+            {
+                uint16_t len = get<uint16_t>();
+                if (!ok || pos + len > in.size())
+                {
+                    ok = false;
+                    return {};
+                }
+                std::string s(reinterpret_cast<const char*>(in.data() + pos), len);
+                pos += len;
+                return s;
+            }
+        };
+
+    } // anon
+
+    SessionRecorder::~SessionRecorder()
+    {
+        close();
+    }
+
+    bool SessionRecorder::open(const std::string& path)
+    {
+        close();
+        _file = fopen(path.c_str(), "wb");
+        if (!_file)
+        {
+            printf("Could not write %s\n", path.c_str());
+            return false;
+        }
+        fwrite(session_magic, sizeof(session_magic), 1, _file);
+        return true;
+    }
+
+    void SessionRecorder::close()
+    {
+        if (_file)
+        {
+            fclose(_file);
+            _file = nullptr;
+        }
+    }
+
+    void SessionRecorder::add_input(const SessionInputEvent& event)
+    {
+        if (!_file)
+            return;
+
+        std::vector<uint8_t> out;
+        put(out, Record::Input);
+        put(out, event.type);
+        put(out, event.key_code);
+        put(out, event.char_code);
+        put(out, event.modifiers);
+        put(out, event.mouse_button);
+        put(out, event.mouse_x);
+        put(out, event.mouse_y);
+        put(out, event.scroll_x);
+        put(out, event.scroll_y);
+        put(out, event.window_width);
+        put(out, event.window_height);
+        put(out, event.framebuffer_width);
+        put(out, event.framebuffer_height);
+        put(out, static_cast<uint8_t>(event.key_repeat ? 1 : 0));
+        fwrite(out.data(), out.size(), 1, _file);
+    }
+
+    void SessionRecorder::begin_frame(float delta_time, int width, int height)
+    {
+        if (!_file)
+            return;
+
+        std::vector<uint8_t> out;
+        put(out, Record::Frame);
+        put(out, delta_time);
+        put(out, static_cast<int32_t>(width));
+        put(out, static_cast<int32_t>(height));
+        fwrite(out.data(), out.size(), 1, _file);
+    }
+
+    void SessionRecorder::add_osc(const SessionOscMessage& msg)
+    {
+        if (!_file)
+            return;
+
+        std::vector<uint8_t> out;
+        put(out, Record::Osc);
+        put_string(out, msg.addr);
+        put(out, static_cast<int32_t>(msg.addr_id));
+        put(out, static_cast<int32_t>(msg.argc));
+        for (float f : msg.data)
+            put(out, f);
+        fwrite(out.data(), out.size(), 1, _file);
+    }
+
+    void SessionRecorder::add_dialog_result(const std::string& path)
+    {
+        if (!_file)
+            return;
+
+        std::vector<uint8_t> out;
+        put(out, Record::Dialog);
+        put_string(out, path);
+        fwrite(out.data(), out.size(), 1, _file);
+
+        // a dialog usually precedes a long operation, such as loading a patch,
+        // so the session is kept intact should that operation fail
+        fflush(_file);
+    }
+
+    bool SessionPlayer::open(const std::string& path)
+    {
+        _frames.clear();
+        _next = 0;
+
+        FILE* file = fopen(path.c_str(), "rb");
+        if (!file)
+        {
+            printf("Could not open %s\n", path.c_str());
+            return false;
+        }
+        std::vector<uint8_t> in;
+        uint8_t buffer[4096];
+        size_t n;
+        while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0)
+            in.insert(in.end(), buffer, buffer + n);
+        fclose(file);
+
+        if (in.size() < sizeof(session_magic) || memcmp(in.data(), session_magic, sizeof(session_magic)) != 0)
+        {
+            printf("%s is not a recorded session\n", path.c_str());
+            return false;
+        }
+
+        Reader reader{ in, sizeof(session_magic) };
+        std::vector<SessionInputEvent> pending_input;
+        while (reader.ok && reader.pos < in.size())
+        {
+            Record record = reader.get<Record>();
+            switch (record)
+            {
+            case Record::Input:
+            {
+                SessionInputEvent e;
+                e.type = reader.get<uint32_t>();
+                e.key_code = reader.get<uint32_t>();
+                e.char_code = reader.get<uint32_t>();
+                e.modifiers = reader.get<uint32_t>();
+                e.mouse_button = reader.get<int32_t>();
+                e.mouse_x = reader.get<float>();
+                e.mouse_y = reader.get<float>();
+                e.scroll_x = reader.get<float>();
+                e.scroll_y = reader.get<float>();
+                e.window_width = reader.get<int32_t>();
+                e.window_height = reader.get<int32_t>();
+                e.framebuffer_width = reader.get<int32_t>();
+                e.framebuffer_height = reader.get<int32_t>();
+                e.key_repeat = reader.get<uint8_t>() != 0;
+                pending_input.push_back(e);
+                break;
+            }
+            case Record::Frame:
+            {
+                SessionFrame frame;
+                frame.delta_time = reader.get<float>();
+                frame.width = reader.get<int32_t>();
+                frame.height = reader.get<int32_t>();
+                if (!reader.ok)
+                    break;
+                frame.input.swap(pending_input);
+                _frames.emplace_back(std::move(frame));
+                break;
+            }
+            case Record::Osc:
+            {
+                SessionOscMessage msg;
+                msg.addr = reader.get_string();
+                msg.addr_id = reader.get<int32_t>();
+                msg.argc = reader.get<int32_t>();
+                for (float& f : msg.data)
+                    f = reader.get<float>();
+                if (reader.ok && !_frames.empty())
+                    _frames.back().osc.emplace_back(std::move(msg));
+                break;
+            }
+            case Record::Dialog:
+            {
+                std::string result = reader.get_string();
+                if (reader.ok && !_frames.empty())
+                    _frames.back().dialog_results.emplace_back(std::move(result));
+                break;
+            }
+            default:
+                reader.ok = false;
+                break;
+            }
+        }
+
+        // a session cut short, for example by a crash, is replayed up to the
+        // last complete frame
+        if (!reader.ok)
+            printf("%s is truncated, replaying the first %d frames\n", path.c_str(), (int) _frames.size());
+
+        return !_frames.empty();
+    }
+
+    bool SessionPlayer::next_frame(SessionFrame& frame)
+    {
+        if (_next >= _frames.size())
+            return false;
+        frame = std::move(_frames[_next++]);
+        return true;
+    }
+
+} } // lab::noodle
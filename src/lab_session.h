@@ -0,0 +1,97 @@
+#ifndef included_lab_session_h
+#define included_lab_session_h
+
+/*
+    Recording and replay of editing sessions.
+
+    A session is everything that arrives from outside the application, frame
+    by frame: input events, OSC messages, and the paths chosen in file
+    dialogs, along with each frame's time step and window size. Replaying a
+    session feeds the same inputs to the same frames, in place of the live
+    ones, so the editor and the audio graph go through the same sequence of
+    states, as fast as frames can be drawn.
+
+    The file is a compact binary stream of records, in the order they
+    occurred. Input events precede the frame that consumed them, while OSC
+    messages and dialog results follow the frame they occurred in.
+*/
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace lab { namespace noodle {
+
+    // a platform neutral copy of the fields of an input event
+    struct SessionInputEvent
+    {
+        uint32_t type = 0;
+        uint32_t key_code = 0;
+        uint32_t char_code = 0;
+        uint32_t modifiers = 0;
+        int32_t mouse_button = 0;
+        float mouse_x = 0, mouse_y = 0;
+        float scroll_x = 0, scroll_y = 0;
+        int32_t window_width = 0, window_height = 0;
+        int32_t framebuffer_width = 0, framebuffer_height = 0;
+        bool key_repeat = false;
+    };
+
+    struct SessionOscMessage
+    {
+        std::string addr;
+        int addr_id = 0;
+        int argc = 0;
+        float data[4] = { 0, 0, 0, 0 };
+    };
+
+    struct SessionFrame
+    {
+        float delta_time = 0;   // in seconds
+        int width = 0, height = 0;
+        std::vector<SessionInputEvent> input;
+        std::vector<SessionOscMessage> osc;
+        std::vector<std::string> dialog_results;   // empty if a dialog was cancelled
+    };
+
+    class SessionRecorder
+    {
+    public:
+        SessionRecorder() = default;
+        ~SessionRecorder();
+
+        bool open(const std::string& path);
+        void close();
+        bool recording() const { return _file != nullptr; }
+
+        // input is recorded as it arrives, and belongs to the frame that follows
+        void add_input(const SessionInputEvent& event);
+
+        // marks the start of a frame, OSC and dialog results that follow belong to it
+        void begin_frame(float delta_time, int width, int height);
+        void add_osc(const SessionOscMessage& msg);
+        void add_dialog_result(const std::string& path);
+
+    private:
+        FILE* _file = nullptr;
+    };
+
+    class SessionPlayer
+    {
+    public:
+        // reads the whole session, returns false and reports the problem if it can't
+        bool open(const std::string& path);
+        bool playing() const { return _next < _frames.size(); }
+
+        // the next frame, which is consumed
+        bool next_frame(SessionFrame& frame);
+
+    private:
+        std::vector<SessionFrame> _frames;
+        size_t _next = 0;
+    };
+
+} } // lab::noodle
+
+#endif
@@ -0,0 +1,166 @@
+#ifndef included_lab_spsc_ring_h
+#define included_lab_spsc_ring_h
+
+/*
+    A bounded single producer, single consumer ring of records, with its
+    slots allocated once, when it is constructed. Neither side allocates or
+    locks afterwards, so either may be the audio thread.
+
+    The producer and the consumer each own an index, on a cache line of
+    its own, and keep a copy of the other's index, refreshed only when the
+    ring appears full or empty, so that they rarely read each other's line.
+    Records that don't fit are counted, rather than waited for.
+*/
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace lab { namespace noodle {
+
+    template <typename T>
+    class SpscRing
+    {
+    public:
+        // capacity is rounded up to a power of two
+        explicit SpscRing(size_t capacity)
+        {
+            size_t size = 1;
+            while (size < capacity)
+                size <<= 1;
+            _slots.resize(size);
+            _mask = size - 1;
+        }
+
+        SpscRing(const SpscRing&) = delete;
+        SpscRing& operator=(const SpscRing&) = delete;
+
+        size_t capacity() const { return _slots.size(); }
+
+        // called by the producer only. pushes all of the records, or none of
+        // them if there isn't room for all, so that a batch stays whole.
+        bool push(const T* records, size_t count)
+        {
+            const size_t tail = _tail.load(std::memory_order_relaxed);
+            if (count > room(tail, count))
+            {
+                _overflows.fetch_add(count, std::memory_order_relaxed);
+                return false;
+            }
+
+            for (size_t i = 0; i < count; ++i)
+                _slots[(tail + i) & _mask] = records[i];
+
+            _tail.store(tail + count, std::memory_order_release);
+            return true;
+        }
+
+        bool push(const T& record)
+        {
+            return push(&record, 1);
+        }
+
+        // called by the producer only. pushes as many of the records as fit,
+        // and returns how many that was.
+        size_t push_available(const T* records, size_t count)
+        {
+            const size_t tail = _tail.load(std::memory_order_relaxed);
+            const size_t free = room(tail, count);
+            const size_t n = count < free ? count : free;
+            for (size_t i = 0; i < n; ++i)
+                _slots[(tail + i) & _mask] = records[i];
+
+            _tail.store(tail + n, std::memory_order_release);
+            if (n < count)
+                _overflows.fetch_add(count - n, std::memory_order_relaxed);
+            return n;
+        }
+
+        // called by the consumer only, returns the number of records popped
+        size_t pop(T* records, size_t max)
+        {
+            const size_t head = _head.load(std::memory_order_relaxed);
+            const size_t available = ready(head, max);
+            const size_t n = max < available ? max : available;
+            for (size_t i = 0; i < n; ++i)
+                records[i] = _slots[(head + i) & _mask];
+
+            _head.store(head + n, std::memory_order_release);
+            return n;
+        }
+
+        bool pop(T& record)
+        {
+            return pop(&record, 1) == 1;
+        }
+
+        // called by the consumer only, appends everything pushed so far
+        void drain(std::vector<T>& out)
+        {
+            const size_t head = _head.load(std::memory_order_relaxed);
+            const size_t tail = _tail.load(std::memory_order_acquire);
+            for (size_t i = head; i != tail; ++i)
+                out.push_back(_slots[i & _mask]);
+
+            _cached_tail = tail;
+            _head.store(tail, std::memory_order_release);
+        }
+
+        // the number of records waiting, which may be stale by the time it is read
+        size_t size() const
+        {
+            const size_t head = _head.load(std::memory_order_acquire);
+            const size_t tail = _tail.load(std::memory_order_acquire);
+            return tail - head;
+        }
+
+        // the number of records discarded because the ring was full
+        uint64_t overflows() const
+        {
+            return _overflows.load(std::memory_order_relaxed);
+        }
+
+    private:
+        // the producer's free space, rereading the consumer's index only if
+        // the copy shows less than is needed
+        size_t room(size_t tail, size_t needed)
+        {
+            size_t free = _slots.size() - (tail - _cached_head);
+            if (free < needed)
+            {
+                _cached_head = _head.load(std::memory_order_acquire);
+                free = _slots.size() - (tail - _cached_head);
+            }
+            return free;
+        }
+
+        // the consumer's waiting records, rereading the producer's index only
+        // if the copy shows fewer than are wanted
+        size_t ready(size_t head, size_t wanted)
+        {
+            size_t available = _cached_tail - head;
+            if (available < wanted)
+            {
+                _cached_tail = _tail.load(std::memory_order_acquire);
+                available = _cached_tail - head;
+            }
+            return available;
+        }
+
+        std::vector<T> _slots;
+        size_t _mask = 0;
+
+        // the indices increase without wrapping, and are masked on access.
+        // each side's index and its copy of the other's share a cache line,
+        // apart from the other side's.
+        alignas(64) std::atomic<size_t> _head{ 0 };    // written by the consumer
+        size_t _cached_tail = 0;
+        alignas(64) std::atomic<size_t> _tail{ 0 };    // written by the producer
+        size_t _cached_head = 0;
+        std::atomic<uint64_t> _overflows{ 0 };      // written by the producer
+    };
+
+} } // lab::noodle
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef included_lab_timing_ring_h
+#define included_lab_timing_ring_h
+
+/*
+    Rings of records, such as QuantumTiming, written by the audio thread
+    and read by the UI. The audio thread pushes a whole quantum's records
+    at once, or none of them if the ring is full, so the reader never sees
+    part of a quantum. See lab_spsc_ring.h.
+*/
+
+#include "lab_noodle.h"
+#include "lab_spsc_ring.h"
+
+namespace lab { namespace noodle {
+
+    template <typename T>
+    using TimingRing = SpscRing<T>;
+
+    using QuantumTimingRing = TimingRing<QuantumTiming>;
+
+} } // lab::noodle
+
+#endif
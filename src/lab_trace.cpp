@@ -0,0 +1,199 @@
+#include "lab_trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace lab { namespace noodle { namespace trace {
+
+    namespace {
+
+        struct Event
+        {
+            const char* name;
+            const char* category;
+            uint64_t node;          // if not zero, the event is named for the node
+            double start;
+            double duration;
+            uint32_t thread;
+        };
+
+        const int max_threads = 64;
+
+        std::unique_ptr<Event[]> events;
+        size_t capacity = 0;
+        std::atomic<size_t> next_event{ 0 };
+        std::atomic<size_t> dropped_events{ 0 };
+
+        // recording threads register as writers before checking that the
+        // recording is active, so that stop can wait for them to finish
+        std::atomic<bool> active{ false };
+        std::atomic<int> writers{ 0 };
+        std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+        std::atomic<uint32_t> next_thread{ 0 };
+        std::atomic<const char*> thread_names[max_threads];
+
+        std::mutex node_names_mutex;
+        std::unordered_map<uint64_t, std::string> node_names;
+
+        uint32_t thread_index()
+        {
+            thread_local uint32_t index = next_thread.fetch_add(1) % max_threads;
+            return index;
+        }
+
+        void record(const char* name, const char* category, uint64_t node, double start, double duration)
+        {
+            writers.fetch_add(1);
+            if (active.load())
+            {
+                size_t i = next_event.fetch_add(1, std::memory_order_relaxed);
+                if (i < capacity)
+                    events[i] = Event{ name, category, node, start, duration, thread_index() };
+                else
+                    dropped_events.fetch_add(1, std::memory_order_relaxed);
+            }
+            writers.fetch_sub(1);
+        }
+
+        void write_escaped(FILE* f, const char* s)
+        {
+            for (; *s; ++s)
+            {
+                if (*s == '"' || *s == '\\')
+                    fprintf(f, "\\%c", *s);
+                else if (static_cast<unsigned char>(*s) < 0x20)
+                    fprintf(f, "\\u%04x", *s);
+                else
+                    fputc(*s, f);
+            }
+        }
+
+    } // anon
+
+    void start(size_t requested_capacity)
+    {
+        stop();
+        if (!events || capacity != requested_capacity)
+        {
+            events.reset(new Event[requested_capacity]);
+            capacity = requested_capacity;
+        }
+        next_event = 0;
+        dropped_events = 0;
+        epoch = std::chrono::steady_clock::now();
+        active = true;
+    }
+
+    void stop()
+    {
+        active = false;
+        while (writers.load())
+            std::this_thread::yield();
+    }
+
+    bool recording()
+    {
+        return active.load(std::memory_order_relaxed);
+    }
+
+    size_t event_count()
+    {
+        return std::min(next_event.load(), capacity);
+    }
+
+    size_t dropped()
+    {
+        return dropped_events.load();
+    }
+
+    double now()
+    {
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    void name_thread(const char* name)
+    {
+        thread_names[thread_index()].store(name, std::memory_order_relaxed);
+    }
+
+    void name_node(uint64_t node, const std::string& name)
+    {
+        std::lock_guard<std::mutex> lock(node_names_mutex);
+        node_names[node] = name;
+    }
+
+    void complete(const char* name, const char* category, double start, double duration)
+    {
+        record(name, category, 0, start, duration);
+    }
+
+    void complete_node(uint64_t node, const char* category, double start, double duration)
+    {
+        record(nullptr, category, node, start, duration);
+    }
+
+    bool write(const std::string& path)
+    {
+        if (recording())
+        {
+            printf("The trace must be stopped before it is written\n");
+            return false;
+        }
+
+        FILE* f = fopen(path.c_str(), "wb");
+        if (!f)
+        {
+            printf("Could not write %s\n", path.c_str());
+            return false;
+        }
+
+        fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+        bool first = true;
+        for (int t = 0; t < max_threads; ++t)
+        {
+            const char* name = thread_names[t].load();
+            if (!name)
+                continue;
+            fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"", first ? "" : ",\n", t);
+            write_escaped(f, name);
+            fprintf(f, "\"}}");
+            first = false;
+        }
+
+        std::lock_guard<std::mutex> lock(node_names_mutex);
+        const size_t count = event_count();
+        for (size_t i = 0; i < count; ++i)
+        {
+            const Event& e = events[i];
+            const char* name = e.name;
+            if (e.node)
+            {
+                auto it = node_names.find(e.node);
+                name = it != node_names.end() ? it->second.c_str() : "node";
+            }
+            fprintf(f, "%s{\"name\":\"", first ? "" : ",\n");
+            write_escaped(f, name ? name : "");
+            fprintf(f, "\",\"cat\":\"");
+            write_escaped(f, e.category ? e.category : "");
+            fprintf(f, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", e.thread, e.start, e.duration);
+            first = false;
+        }
+        fprintf(f, "\n]}\n");
+        fclose(f);
+
+        if (dropped())
+            printf("wrote %d trace events to %s, %d were dropped when the buffer filled\n",
+                (int) count, path.c_str(), (int) dropped());
+        else
+            printf("wrote %d trace events to %s\n", (int) count, path.c_str());
+        return true;
+    }
+
+} } } // lab::noodle::trace
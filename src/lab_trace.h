@@ -0,0 +1,71 @@
+#ifndef included_lab_trace_h
+#define included_lab_trace_h
+
+/*
+    A trace recorder for the audio, OSC, and UI threads, written in the
+    Chrome trace event format, which chrome://tracing and ui.perfetto.dev
+    open.
+
+    Events go into a buffer whose size is fixed when recording starts;
+    recording an event is a few atomic operations, with no allocation or
+    locking, so the audio thread may record. Once the buffer is full,
+    further events are counted as dropped. Event and category names must
+    be string literals, or otherwise outlive the recording, except for node
+    names, which are given by entity id, and looked up when the trace is
+    written.
+*/
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace lab { namespace noodle { namespace trace {
+
+    // discards any previous recording. capacity is in events.
+    void start(size_t capacity = 1 << 18);
+
+    // waits for any events being recorded to complete
+    void stop();
+
+    bool recording();
+    size_t event_count();
+    size_t dropped();
+
+    // writes the most recent recording, which must be stopped
+    bool write(const std::string& path);
+
+    // names the calling thread in the trace
+    void name_thread(const char* name);
+
+    // names a node's events in the trace, called from the UI thread
+    void name_node(uint64_t node, const std::string& name);
+
+    // microseconds since recording started
+    double now();
+
+    void complete(const char* name, const char* category, double start, double duration);
+    void complete_node(uint64_t node, const char* category, double start, double duration);
+
+    // records the time from its construction to its destruction
+    class Scope
+    {
+    public:
+        Scope(const char* name, const char* category)
+            : _name(name), _category(category), _start(recording() ? now() : -1.0)
+        {
+        }
+        ~Scope()
+        {
+            if (_start >= 0)
+                complete(_name, _category, _start, now() - _start);
+        }
+
+    private:
+        const char* _name;
+        const char* _category;
+        double _start;
+    };
+
+} } } // lab::noodle::trace
+
+#endif
@@ -0,0 +1,201 @@
+#include "lab_udp_receiver.h"
+
+#include <cstdio>
+#include <cstring>
+
+#if defined(_WIN32)
+#include <winsock2.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace lab { namespace noodle {
+
+    namespace {
+
+        const int receive_buffer_bytes = 4 * 1024 * 1024;
+
+#if defined(_WIN32)
+        using socket_t = SOCKET;
+        void close_socket(socket_t s) { closesocket(s); }
+#else
+        using socket_t = int;
+        void close_socket(socket_t s) { ::close(s); }
+#endif
+
+        bool wait_readable(socket_t s, int timeout_ms)
+        {
+#if defined(_WIN32)
+            fd_set set;
+            FD_ZERO(&set);
+            FD_SET(s, &set);
+            timeval tv = { timeout_ms / 1000, (timeout_ms % 1000) * 1000 };
+            return select(0, &set, nullptr, nullptr, &tv) > 0;
+#else
+            pollfd fd = { s, POLLIN, 0 };
+            return poll(&fd, 1, timeout_ms) > 0 && (fd.revents & POLLIN);
+#endif
+        }
+
+    } // anon
+
+    UdpReceiver::~UdpReceiver()
+    {
+        close();
+    }
+
+    bool UdpReceiver::open(uint16_t port)
+    {
+        close();
+
+        socket_t s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+#if defined(_WIN32)
+        if (s == INVALID_SOCKET)
+#else
+        if (s < 0)
+#endif
+        {
+            printf("Could not open a UDP socket\n");
+            return false;
+        }
+
+        int enable = 1;
+        setsockopt(s, SOL_SOCKET, SO_REUSEADDR, (const char*) &enable, sizeof(enable));
+
+        // a larger buffer absorbs bursts; the system may limit it
+        int size = receive_buffer_bytes;
+        setsockopt(s, SOL_SOCKET, SO_RCVBUF, (const char*) &size, sizeof(size));
+#if defined(SO_RXQ_OVFL)
+        // each datagram then carries the count the kernel has dropped
+        setsockopt(s, SOL_SOCKET, SO_RXQ_OVFL, &enable, sizeof(enable));
+#endif
+
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        addr.sin_port = htons(port);
+        if (bind(s, (sockaddr*) &addr, sizeof(addr)) != 0)
+        {
+            printf("Could not bind UDP port %d\n", (int) port);
+            close_socket(s);
+            return false;
+        }
+
+        // once readable, the socket is drained without blocking
+#if defined(_WIN32)
+        u_long non_blocking = 1;
+        ioctlsocket(s, FIONBIO, &non_blocking);
+#else
+        fcntl(s, F_SETFL, fcntl(s, F_GETFL, 0) | O_NONBLOCK);
+#endif
+
+        _buffers.assign(static_cast<size_t>(max_batch) * max_datagram, 0);
+        _socket = static_cast<intptr_t>(s);
+        _kernel_drops = 0;
+        return true;
+    }
+
+    void UdpReceiver::close()
+    {
+        if (_socket == -1)
+            return;
+        close_socket(static_cast<socket_t>(_socket));
+        _socket = -1;
+    }
+
+    int UdpReceiver::receive(int timeout_ms)
+    {
+        if (_socket == -1)
+            return 0;
+
+        const socket_t s = static_cast<socket_t>(_socket);
+        if (!wait_readable(s, timeout_ms))
+            return 0;
+
+        int count = 0;
+        uint64_t bytes = 0;
+
+#if defined(__linux__)
+        mmsghdr messages[max_batch];
+        iovec vectors[max_batch];
+        alignas(cmsghdr) uint8_t controls[max_batch][CMSG_SPACE(sizeof(uint32_t))];
+        for (int i = 0; i < max_batch; ++i)
+        {
+            vectors[i] = { _buffers.data() + i * max_datagram, max_datagram };
+            messages[i] = {};
+            messages[i].msg_hdr.msg_iov = &vectors[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+            messages[i].msg_hdr.msg_control = controls[i];
+            messages[i].msg_hdr.msg_controllen = sizeof(controls[i]);
+        }
+
+        int received = recvmmsg(s, messages, max_batch, MSG_DONTWAIT, nullptr);
+        for (int i = 0; i < received; ++i)
+        {
+            msghdr& m = messages[i].msg_hdr;
+            for (cmsghdr* c = CMSG_FIRSTHDR(&m); c; c = CMSG_NXTHDR(&m, c))
+            {
+                if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SO_RXQ_OVFL)
+                {
+                    uint32_t drops;
+                    memcpy(&drops, CMSG_DATA(c), sizeof(drops));
+                    _statistics.kernel_drops.fetch_add(drops - _kernel_drops, std::memory_order_relaxed);
+                    _kernel_drops = drops;
+                }
+            }
+
+            if (m.msg_flags & MSG_TRUNC)
+            {
+                _statistics.truncated.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+
+            // datagrams are packed to the front, over any that were discarded
+            if (count != i)
+                memmove(_buffers.data() + count * max_datagram, _buffers.data() + i * max_datagram, messages[i].msg_len);
+            _sizes[count++] = messages[i].msg_len;
+            bytes += messages[i].msg_len;
+        }
+#else
+        for (int i = 0; i < max_batch; ++i)
+        {
+            char* buffer = reinterpret_cast<char*>(_buffers.data() + count * max_datagram);
+            int received = (int) recv(s, buffer, (int) max_datagram, 0);
+            if (received < 0)
+            {
+#if defined(_WIN32)
+                if (WSAGetLastError() == WSAEMSGSIZE)
+                {
+                    _statistics.truncated.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+#endif
+                break;
+            }
+
+            // a datagram filling the buffer may have been cut short
+            if ((size_t) received >= max_datagram)
+            {
+                _statistics.truncated.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            _sizes[count++] = (size_t) received;
+            bytes += (uint64_t) received;
+        }
+#endif
+
+        if (count)
+        {
+            _statistics.datagrams.fetch_add(count, std::memory_order_relaxed);
+            _statistics.bytes.fetch_add(bytes, std::memory_order_relaxed);
+            _statistics.wakeups.fetch_add(1, std::memory_order_relaxed);
+        }
+        return count;
+    }
+
+} } // lab::noodle
@@ -0,0 +1,69 @@
+#ifndef included_lab_udp_receiver_h
+#define included_lab_udp_receiver_h
+
+/*
+    A UDP socket for the OSC server that receives datagrams in batches,
+    into buffers allocated once when it is opened.
+
+    receive waits for the socket to become readable, and then takes every
+    datagram already queued, up to the batch size, without waiting again.
+    On Linux a batch is taken with a single recvmmsg call, elsewhere with
+    a non-blocking receive per datagram. The socket's receive buffer is
+    enlarged so that bursts queue in the kernel rather than being dropped.
+
+    Statistics are counted by the receiving thread, and may be read from
+    any other. Datagrams dropped by the kernel because the socket's buffer
+    was full are only reported on Linux.
+*/
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace lab { namespace noodle {
+
+    struct UdpReceiveStatistics
+    {
+        std::atomic<uint64_t> datagrams{ 0 };
+        std::atomic<uint64_t> bytes{ 0 };
+        std::atomic<uint64_t> wakeups{ 0 };         // receives that returned at least one datagram
+        std::atomic<uint64_t> truncated{ 0 };       // larger than a buffer, and discarded
+        std::atomic<uint64_t> kernel_drops{ 0 };    // dropped by the kernel, Linux only
+    };
+
+    class UdpReceiver
+    {
+    public:
+        static const int max_batch = 32;
+        static const size_t max_datagram = 65536;
+
+        UdpReceiver() = default;
+        ~UdpReceiver();
+        UdpReceiver(const UdpReceiver&) = delete;
+        UdpReceiver& operator=(const UdpReceiver&) = delete;
+
+        // binds to the port on every interface. returns false and reports
+        // the problem if the socket could not be opened.
+        bool open(uint16_t port);
+        void close();
+
+        // waits up to timeout_ms for a datagram, and returns the number
+        // received, valid until the next call
+        int receive(int timeout_ms);
+        const uint8_t* datagram(int i) const { return _buffers.data() + i * max_datagram; }
+        size_t datagram_size(int i) const { return _sizes[i]; }
+
+        const UdpReceiveStatistics& statistics() const { return _statistics; }
+
+    private:
+        std::vector<uint8_t> _buffers;      // max_batch buffers of max_datagram bytes
+        size_t _sizes[max_batch] = {};
+        intptr_t _socket = -1;
+        uint32_t _kernel_drops = 0;         // the kernel's running count, as last reported
+        UdpReceiveStatistics _statistics;
+    };
+
+} } // lab::noodle
+
+#endif
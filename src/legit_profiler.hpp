@@ -5,10 +5,13 @@
 #include <algorithm>
 #include <array>
 #include <chrono>
+#include <cmath>
 #include <cstdint>
-#include <map>
+#include <cstdio>
+#include <functional>
 #include <sstream>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace legit
@@ -48,11 +51,14 @@ namespace legit
     Colors::carrot, Colors::pumpkin, Colors::alizarin, Colors::pomegranate, Colors::clouds, Colors::silver
   };
 
+  // task ids are interned by the caller, and stay the same from frame to
+  // frame, so that no strings are copied per task. names are looked up, by
+  // ProfilerGraph::taskName, only for the tasks the legend shows.
   struct ProfilerTask
   {
     double startTime;
     double endTime;
-    std::string name;
+    uint64_t id;
     uint32_t color;
     double GetLength()
     {
@@ -75,36 +81,60 @@ namespace legit
   }
   class ProfilerGraph
   {
+      // tasks are stored compactly, relative to the frame's start
+      struct FrameTask
+      {
+          float startTime;
+          float endTime;
+          uint32_t statsIndex;
+          uint32_t color;
+      };
+
+      // the frames form a ring; each frame's vector keeps its capacity as
+      // the ring wraps, so once warmed up, loading a frame doesn't allocate
       struct FrameData
       {
-          FrameData() { tasks.reserve(100); }
-          std::vector<legit::ProfilerTask> tasks;
-          std::vector<size_t> taskStatsIndex;
+          std::vector<FrameTask> tasks;
       };
 
+      // the maximum is over the current window of frames and the previous
+      // one, so it reflects between one and two windows of history, and is
+      // maintained as each frame is loaded rather than recomputed
       struct TaskStats
       {
+          uint64_t id;
           double maxTime;
-          size_t priorityOrder;
+          double windowMaxTime;
+          size_t priorityOrder;   // rank among topTasks, or -1
           size_t onScreenIndex;
       };
       std::vector<TaskStats> taskStats;
-      std::map<std::string, size_t> taskNameToStatsIndex;
+      std::unordered_map<uint64_t, uint32_t> taskIdToStatsIndex;
+      std::vector<uint32_t> positionStatsIndex;   // by position in the tasks loaded
+
+      // the stats with the largest maxTime, in descending order
+      std::vector<uint32_t> topTasks;
+      static const size_t topTaskCount = 64;
 
       std::vector<FrameData> frames;
       size_t currFrameIndex = 0;
+      size_t framesInWindow = 0;
 
   public:
     int frameWidth;
     int frameSpacing;
     bool useColoredLegendText;
 
+    // names a task id for the legend
+    std::function<const char*(uint64_t)> taskName;
+
     ProfilerGraph(size_t framesCount)
     {
       frames.resize(framesCount);
       frameWidth = 3;
       frameSpacing = 1;
       useColoredLegendText = false;
+      topTasks.reserve(topTaskCount + 1);
     }
 
     // load data for the current frame, at currFrameIndex.
@@ -113,44 +143,64 @@ namespace legit
     {
       auto &currFrame = frames[currFrameIndex];
       currFrame.tasks.resize(0);
+      bool topChanged = false;
       for (size_t taskIndex = 0; taskIndex < count; taskIndex++)
       {
-        if (taskIndex == 0)
-          currFrame.tasks.push_back(tasks[taskIndex]);
-        else
+        const ProfilerTask& task = tasks[taskIndex];
+
+        // if the task has the same id and color as the previous one, extend that one
+        if (taskIndex > 0 && tasks[taskIndex - 1].id == task.id && tasks[taskIndex - 1].color == task.color)
+        {
+          currFrame.tasks.back().endTime = float(task.endTime);
+          continue;
+        }
+
+        // tasks usually arrive in the same order every frame, so the
+        // previous frame's lookup at the same position is tried first
+        if (taskIndex >= positionStatsIndex.size())
+          positionStatsIndex.resize(taskIndex + 1, uint32_t(-1));
+        uint32_t statsIndex = positionStatsIndex[taskIndex];
+        if (statsIndex >= taskStats.size() || taskStats[statsIndex].id != task.id)
         {
-          // if the task under consideration has a different color or name add it
-          if (tasks[taskIndex - 1].color != tasks[taskIndex].color || tasks[taskIndex - 1].name != tasks[taskIndex].name)
+          auto it = taskIdToStatsIndex.find(task.id);
+          if (it == taskIdToStatsIndex.end())
           {
-            currFrame.tasks.push_back(tasks[taskIndex]);
+            statsIndex = uint32_t(taskStats.size());
+            taskIdToStatsIndex[task.id] = statsIndex;
+            taskStats.push_back({ task.id, -1.0, -1.0, size_t(-1), size_t(-1) });
           }
           else
-          {
-            // otherwise extend the last existing task to include this one
-            currFrame.tasks.back().endTime = tasks[taskIndex].endTime;
-          }
+            statsIndex = it->second;
+          positionStatsIndex[taskIndex] = statsIndex;
         }
+
+        currFrame.tasks.push_back({ float(task.startTime), float(task.endTime), statsIndex, task.color });
       }
-      currFrame.taskStatsIndex.resize(currFrame.tasks.size());
 
-      for (size_t taskIndex = 0; taskIndex < currFrame.tasks.size(); taskIndex++)
+      // the merged tasks' lengths update the statistics
+      for (const FrameTask& task : currFrame.tasks)
       {
-        auto &task = currFrame.tasks[taskIndex];
-        auto it = taskNameToStatsIndex.find(task.name);
-        if (it == taskNameToStatsIndex.end())
-        {
-          taskNameToStatsIndex[task.name] = taskStats.size();
-          TaskStats taskStat;
-          taskStat.maxTime = -1.0;
-          taskStats.push_back(taskStat);
-        }
-        currFrame.taskStatsIndex[taskIndex] = taskNameToStatsIndex[task.name];
+        TaskStats& stats = taskStats[task.statsIndex];
+        const double length = task.endTime - task.startTime;
+        stats.windowMaxTime = std::max(stats.windowMaxTime, length);
+        if (length <= stats.maxTime)
+          continue;
+
+        stats.maxTime = length;
+        topChanged |= PromoteTask(task.statsIndex);
       }
+
       currFrameIndex = (currFrameIndex + 1) % frames.size();
 
-      RebuildTaskStats(currFrameIndex, 300/*frames.size()*/);
+      if (++framesInWindow >= frames.size())
+      {
+        framesInWindow = 0;
+        StartStatsWindow();
+      }
+      else if (topChanged)
+        RankTopTasks();
     }
-    
+
     void RenderTimings(int graphWidth, int legendWidth, int height, float maxFrameTime, int frameIndexOffset)
     {
       ImDrawList* drawList = ImGui::GetWindowDrawList();
@@ -161,38 +211,87 @@ namespace legit
     }
 
   private:
-    void RebuildTaskStats(size_t endFrame, size_t framesCount)
+    // returns true if the stat is, or has just become, one of the top tasks
+    bool PromoteTask(uint32_t statsIndex)
     {
-      for (auto &taskStat : taskStats)
+      TaskStats& stats = taskStats[statsIndex];
+      if (stats.priorityOrder != size_t(-1))
+        return true;
+
+      // the list is only ranked once a frame, so the smallest is searched for
+      if (topTasks.size() >= topTaskCount)
       {
-        taskStat.maxTime = -1.0f;
-        taskStat.priorityOrder = size_t(-1);
-        taskStat.onScreenIndex = size_t(-1);
+        auto smallest = std::min_element(topTasks.begin(), topTasks.end(), [this](uint32_t left, uint32_t right) { return taskStats[left].maxTime < taskStats[right].maxTime; });
+        if (stats.maxTime <= taskStats[*smallest].maxTime)
+          return false;
+        taskStats[*smallest].priorityOrder = size_t(-1);
+        *smallest = statsIndex;
       }
+      else
+        topTasks.push_back(statsIndex);
+      stats.priorityOrder = 0;    // ranked by RankTopTasks
+      return true;
+    }
 
-      for (size_t frameNumber = 0; frameNumber < framesCount; frameNumber++)
+    void RankTopTasks()
+    {
+      std::sort(topTasks.begin(), topTasks.end(), [this](uint32_t left, uint32_t right) { return taskStats[left].maxTime > taskStats[right].maxTime; });
+      for (size_t i = 0; i < topTasks.size(); i++)
+        taskStats[topTasks[i]].priorityOrder = i;
+    }
+
+    // the window just completed becomes the previous window, and the top
+    // tasks are chosen afresh, as maxima from two windows ago have expired
+    void StartStatsWindow()
+    {
+      RemoveExpiredStats();
+      topTasks.clear();
+      for (uint32_t statsIndex = 0; statsIndex < taskStats.size(); statsIndex++)
       {
-        size_t frameIndex = (endFrame - 1 - frameNumber + frames.size()) % frames.size();
-        auto &frame = frames[frameIndex];
-        for (size_t taskIndex = 0; taskIndex < frame.tasks.size(); taskIndex++)
-        {
-          auto &task = frame.tasks[taskIndex];
-          auto &stats = taskStats[frame.taskStatsIndex[taskIndex]];
-          stats.maxTime = std::max(stats.maxTime, task.endTime - task.startTime);
-        }
+        TaskStats& stats = taskStats[statsIndex];
+        stats.maxTime = stats.windowMaxTime;
+        stats.windowMaxTime = -1.0;
+        stats.priorityOrder = size_t(-1);
+        if (stats.maxTime >= 0.0)
+          PromoteTask(statsIndex);
       }
-      std::vector<size_t> statPriorities;
-      statPriorities.resize(taskStats.size());
-      for(size_t statIndex = 0; statIndex < taskStats.size(); statIndex++)
-        statPriorities[statIndex] = statIndex;
+      RankTopTasks();
+    }
 
-      std::sort(statPriorities.begin(), statPriorities.end(), [this](size_t left, size_t right) {return taskStats[left].maxTime > taskStats[right].maxTime; });
-      for (size_t statNumber = 0; statNumber < taskStats.size(); statNumber++)
+    // tasks unseen for two windows, such as those of deleted nodes, are
+    // forgotten. none of the frames in the ring can refer to them, as the
+    // ring holds a single window, so the others' indices are remapped.
+    void RemoveExpiredStats()
+    {
+      std::vector<uint32_t> remap(taskStats.size(), uint32_t(-1));
+      uint32_t kept = 0;
+      for (uint32_t statsIndex = 0; statsIndex < taskStats.size(); statsIndex++)
       {
-        size_t statIndex = statPriorities[statNumber];
-        taskStats[statIndex].priorityOrder = statNumber;
+        const TaskStats& stats = taskStats[statsIndex];
+        if (stats.maxTime < 0.0 && stats.windowMaxTime < 0.0)
+        {
+          taskIdToStatsIndex.erase(stats.id);
+          continue;
+        }
+        remap[statsIndex] = kept;
+        if (kept != statsIndex)
+        {
+          taskStats[kept] = stats;
+          taskIdToStatsIndex[stats.id] = kept;
+        }
+        kept++;
       }
+      if (kept == taskStats.size())
+        return;
+
+      taskStats.resize(kept);
+      for (FrameData& frame : frames)
+        for (FrameTask& task : frame.tasks)
+          task.statsIndex = remap[task.statsIndex];
+      for (uint32_t& statsIndex : positionStatsIndex)
+        statsIndex = statsIndex < remap.size() ? remap[statsIndex] : uint32_t(-1);
     }
+
     void RenderGraph(ImDrawList *drawList, vec2 graphPos, vec2 graphSize, float maxFrameTime, size_t frameIndexOffset)
     {
       Rect(drawList, graphPos, graphPos + graphSize, 0xffffffff, false);
@@ -207,12 +306,11 @@ namespace legit
           break;
         vec2 taskPos = framePos + vec2(0.0f, 0.0f);
         auto &frame = frames[frameIndex];
-        for (auto task : frame.tasks)
+        for (const FrameTask& task : frame.tasks)
         {
-          float taskStartHeight = (float(task.startTime) / maxFrameTime) * graphSize.y;
-          float taskEndHeight = (float(task.endTime) / maxFrameTime) * graphSize.y;
-          //taskMaxCosts[task.name] = std::max(taskMaxCosts[task.name], task.endTime - task.startTime);
-          if (abs(taskEndHeight - taskStartHeight) > heightThreshold)
+          float taskStartHeight = (task.startTime / maxFrameTime) * graphSize.y;
+          float taskEndHeight = (task.endTime / maxFrameTime) * graphSize.y;
+          if (std::abs(taskEndHeight - taskStartHeight) > heightThreshold)
             Rect(drawList, taskPos + vec2(0.0f, -taskStartHeight), taskPos + vec2(static_cast<float>(frameWidth), -taskEndHeight), task.color, true);
         }
       }
@@ -232,17 +330,17 @@ namespace legit
       auto &currFrame = frames[(currFrameIndex - frameIndexOffset - 1 + 2 * frames.size()) % frames.size()];
       size_t maxTasksCount = size_t(legendSize.y / (markerRightRectHeight + markerRightRectSpacing));
 
-      for (auto &taskStat : taskStats)
+      for (uint32_t statsIndex : topTasks)
       {
-        taskStat.onScreenIndex = size_t(-1);
+        taskStats[statsIndex].onScreenIndex = size_t(-1);
       }
 
-      size_t tasksToShow = std::min<size_t>(taskStats.size(), maxTasksCount);
+      size_t tasksToShow = std::min<size_t>(topTasks.size(), maxTasksCount);
       size_t tasksShownCount = 0;
       for (size_t taskIndex = 0; taskIndex < currFrame.tasks.size(); taskIndex++)
       {
         auto &task = currFrame.tasks[taskIndex];
-        auto &stat = taskStats[currFrame.taskStatsIndex[taskIndex]];
+        auto &stat = taskStats[task.statsIndex];
 
         if (stat.priorityOrder >= tasksToShow)
           continue;
@@ -253,8 +351,8 @@ namespace legit
         }
         else
           continue;
-        float taskStartHeight = (float(task.startTime) / maxFrameTime) * legendSize.y;
-        float taskEndHeight = (float(task.endTime) / maxFrameTime) * legendSize.y;
+        float taskStartHeight = (task.startTime / maxFrameTime) * legendSize.y;
+        float taskEndHeight = (task.endTime / maxFrameTime) * legendSize.y;
 
         vec2 markerLeftRectMin = legendPos + vec2(markerLeftRectMargin, legendSize.y);
         vec2 markerLeftRectMax = markerLeftRectMin + vec2(markerLeftRectWidth, 0.0f);
@@ -267,13 +365,16 @@ namespace legit
 
         uint32_t textColor = useColoredLegendText ? task.color : legit::Colors::imguiText;// task.color;
 
-        float taskTimeMs = float(task.endTime - task.startTime);
-        std::ostringstream timeText;
-        timeText.precision(2);
-        timeText << std::fixed << std::string("[") << (taskTimeMs * 1000.0f);
-
-        Text(drawList, markerRightRectMax + textMargin, textColor, timeText.str().c_str());
-        Text(drawList, markerRightRectMax + textMargin + vec2(nameOffset, 0.0f), textColor, (std::string("ms] ") + task.name).c_str());
+        float taskTimeMs = (task.endTime - task.startTime) * 1000.0f;
+        const char* name = taskName ? taskName(stat.id) : nullptr;
+        char text[128];
+        snprintf(text, sizeof(text), "[%.2f", taskTimeMs);
+        Text(drawList, markerRightRectMax + textMargin, textColor, text);
+        if (name)
+          snprintf(text, sizeof(text), "ms] %s", name);
+        else
+          snprintf(text, sizeof(text), "ms] %llu", (unsigned long long) stat.id);
+        Text(drawList, markerRightRectMax + textMargin + vec2(nameOffset, 0.0f), textColor, text);
       }
     }
 
@@ -11,8 +11,17 @@
 #include "lab_imgui_ext.hpp"
 #include "LabSoundInterface.h"
 #include "lab_noodle.h"
+#include "lab_session.h"
+#include "lab_spsc_ring.h"
+#include "lab_histogram.h"
+#include "lab_instrument.h"
+#include "lab_metrics.h"
+#include "lab_rt_guard.h"
+#include "lab_trace.h"
+#include "lab_udp_receiver.h"
 #include "MidiNode.hpp"
 #include "OSCNode.hpp"
+#include "LatencyProbeNode.hpp"
 
 #include <LabSound/LabSound.h>
 
@@ -25,6 +34,10 @@
 #include <tinyosc.hpp>
 #include <tinyosc-net.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
 #include <string>
@@ -38,85 +51,97 @@ std::unordered_map<std::string, int> _addr_map;
 std::unordered_map<int, int> _id_argc_map;
 int _next_addr = 0;
 
-polymer::spsc_queue<OSCMsg> * _osc_queue = nullptr;
+// messages from the OSC thread to the UI; a burst larger than this is dropped
+lab::noodle::SpscRing<OSCMsg> * _osc_queue = nullptr;
+const size_t osc_queue_capacity = 16384;
+
+// while replaying, frames run undrawn for this long before one is presented
+const double replay_present_interval_ms = 15.0;
 namespace {
     bool join_osc = false;
 }
 
+// messages received by the OSC thread, for the metrics
+std::atomic<uint64_t> g_osc_received{ 0 };
+
+// the OSC server's socket, opened by the OSC thread, see lab_udp_receiver.h
+lab::noodle::UdpReceiver g_osc_receiver;
+
 void open_udp_server()
 {
-    osc_net_address_t server_addr;
-    osc_net_get_address(&server_addr, nullptr, 8000);
+    const uint16_t port = 8000;
+    if (!g_osc_receiver.open(port))
+        return;
 
-    osc_net_socket_t server_socket;
-    if (osc_net_udp_socket_open(&server_socket, server_addr, true))
-    {
-        std::cout << "osc_net_udp_socket_open osc_net_err: " << osc_net_get_error() << std::endl;
-    }
-    else
-    {
-        std::cout << "OSC server started, will listen to packets on UDP port " << 8000 << std::endl;
+    std::cout << "OSC server started, will listen to packets on UDP port " << port << std::endl;
+    lab::noodle::trace::name_thread("OSC");
+
+    tinyosc::osc_packet_reader packet_reader;
 
-        tinyosc::osc_packet_reader packet_reader;
-        tinyosc::osc_packet_writer packet_writer;
+    while (!join_osc)
+    {
+        // every datagram queued when the socket wakes is taken at once
+        const int count = g_osc_receiver.receive(30);
+        if (!count)
+            continue;
 
-        while (!join_osc)
+        const int64_t arrival = OSCNode::now();
+        for (int d = 0; d < count; ++d)
         {
-            std::vector<uint8_t> recv_byte_buffer(1024 * 128);
+            LAB_TIME_SCOPE("packet", "osc");
+            packet_reader.initialize_from_ptr(const_cast<uint8_t*>(g_osc_receiver.datagram(d)), (int) g_osc_receiver.datagram_size(d));
+            tinyosc::osc_message* msg;
 
-            osc_net_address_t sender;
-            if (auto bytes = osc_net_udp_socket_receive(&server_socket, &sender, recv_byte_buffer.data(), (int) recv_byte_buffer.size(), 30))
+            while (packet_reader.check_error() && (msg = packet_reader.pop_message()) != 0)
             {
-                packet_reader.initialize_from_ptr(recv_byte_buffer.data(), bytes);
-                tinyosc::osc_message* msg;
-
-                while (packet_reader.check_error() && (msg = packet_reader.pop_message()) != 0)
+                OSCMsg osc_msg;
+                osc_msg.arrival = arrival;
+                auto addr = msg->get_address_pattern();
+                int addr_id;
+                auto it = _addr_map.find(addr);
+                if (it == _addr_map.end())
                 {
-                    OSCMsg osc_msg;
-                    auto addr = msg->get_address_pattern();
-                    int addr_id;
-                    auto it = _addr_map.find(addr);
-                    if (it == _addr_map.end())
-                    {
-                        addr_id = ++_next_addr;
-                        _addr_map[addr] = addr_id;
-                        auto tags = msg->get_type_tags();
-                        if (tags == "f")
-                            osc_msg.argc = 1;
-                        else if (tags == "ff")
-                            osc_msg.argc = 2;
-                        else if (tags == "fff")
-                            osc_msg.argc = 3;
-                        else
-                            osc_msg.argc = 0;
-                        _id_argc_map[addr_id] = osc_msg.argc;
-                        it = _addr_map.find(addr);
-                        osc_msg.addr = it->first.c_str();
-                    }
+                    addr_id = ++_next_addr;
+                    _addr_map[addr] = addr_id;
+                    auto tags = msg->get_type_tags();
+                    if (tags == "f")
+                        osc_msg.argc = 1;
+                    else if (tags == "ff")
+                        osc_msg.argc = 2;
+                    else if (tags == "fff")
+                        osc_msg.argc = 3;
                     else
-                    {
-                        addr_id = it->second;
-                        osc_msg.addr = it->first.c_str();
-                        osc_msg.argc = _id_argc_map[addr_id];
-                    }
-
-                    osc_msg.addr_id = addr_id;
+                        osc_msg.argc = 0;
+                    _id_argc_map[addr_id] = osc_msg.argc;
+                    it = _addr_map.find(addr);
+                    osc_msg.addr = it->first.c_str();
+                }
+                else
+                {
+                    addr_id = it->second;
+                    osc_msg.addr = it->first.c_str();
+                    osc_msg.argc = _id_argc_map[addr_id];
+                }
 
-                    auto match = msg->match_complete(addr);
-                    for (int i = 0; i < osc_msg.argc; ++i)
-                    {
-                        float x;
-                        match = match.pop_float(x);
-                        if (i < 4)
-                            osc_msg.data[i] = x;
-                    }
-                    match.check_no_more_args();
+                osc_msg.addr_id = addr_id;
 
-                    _osc_queue->produce(std::move(osc_msg));
+                auto match = msg->match_complete(addr);
+                for (int i = 0; i < osc_msg.argc; ++i)
+                {
+                    float x;
+                    match = match.pop_float(x);
+                    if (i < 4)
+                        osc_msg.data[i] = x;
                 }
+                match.check_no_more_args();
+
+                _osc_queue->push(osc_msg);
+                g_osc_received.fetch_add(1, std::memory_order_relaxed);
             }
         }
     }
+
+    g_osc_receiver.close();
 }
 
 enum class Command
@@ -125,7 +150,11 @@ enum class Command
     New,
     Open,
     Save,
+    OpenBundle,
+    SaveBundle,
     ExportCpp,
+    ExportStaticCpp,
+    ExportStaticCppBenchmark,
     Quit
 };
 
@@ -142,19 +171,295 @@ ImFont * g_audio_icon = nullptr;
 
 std::thread* osc_service_thread = nullptr;
 
+// the audio device given on the command line, patches may replace it when they are loaded
+lab::noodle::AudioDeviceSettings g_device_settings;
+bool g_show_device_panel = false;
+bool g_show_latency_panel = false;
+
+// a trace recorded from launch, see lab_trace.h
+std::string g_trace_path;
+bool g_instrument_dump = false;     // print the instrumentation's totals on quitting
+
+// health metrics for unattended installations, see lab_metrics.h
+lab::noodle::MetricsOptions g_metrics_options;
+lab::noodle::MetricsExporter g_metrics;
+
+// sessions, see lab_session.h
+std::string g_record_path;
+std::string g_replay_path;
+bool g_quit_after_replay = false;
+lab::noodle::SessionRecorder g_recorder;
+lab::noodle::SessionPlayer g_player;
+bool g_replaying_frame = false;
+std::vector<std::string> g_replay_dialogs;
+size_t g_next_replay_dialog = 0;
+
+lab::noodle::SessionInputEvent to_session_event(const sapp_event& e)
+{
+    lab::noodle::SessionInputEvent r;
+    r.type = static_cast<uint32_t>(e.type);
+    r.key_code = static_cast<uint32_t>(e.key_code);
+    r.char_code = e.char_code;
+    r.modifiers = e.modifiers;
+    r.mouse_button = static_cast<int32_t>(e.mouse_button);
+    r.mouse_x = e.mouse_x;
+    r.mouse_y = e.mouse_y;
+    r.scroll_x = e.scroll_x;
+    r.scroll_y = e.scroll_y;
+    r.window_width = e.window_width;
+    r.window_height = e.window_height;
+    r.framebuffer_width = e.framebuffer_width;
+    r.framebuffer_height = e.framebuffer_height;
+    r.key_repeat = e.key_repeat;
+    return r;
+}
+
+sapp_event to_sapp_event(const lab::noodle::SessionInputEvent& r)
+{
+    sapp_event e = { };
+    e.frame_count = sapp_frame_count();
+    e.type = static_cast<sapp_event_type>(r.type);
+    e.key_code = static_cast<sapp_keycode>(r.key_code);
+    e.char_code = r.char_code;
+    e.modifiers = r.modifiers;
+    e.mouse_button = static_cast<sapp_mousebutton>(r.mouse_button);
+    e.mouse_x = r.mouse_x;
+    e.mouse_y = r.mouse_y;
+    e.scroll_x = r.scroll_x;
+    e.scroll_y = r.scroll_y;
+    e.window_width = r.window_width;
+    e.window_height = r.window_height;
+    e.framebuffer_width = r.framebuffer_width;
+    e.framebuffer_height = r.framebuffer_height;
+    e.key_repeat = r.key_repeat;
+    return e;
+}
+
+// the path chosen in a file dialog, or an empty string if it was cancelled.
+// the choice is part of the session, so a replay uses the recorded path in
+// place of asking again.
+std::string file_dialog(bool save, const char* filter)
+{
+    if (g_replaying_frame)
+    {
+        if (g_next_replay_dialog < g_replay_dialogs.size())
+            return g_replay_dialogs[g_next_replay_dialog++];
+        return {};
+    }
+
+    char* file = nullptr;
+    nfdresult_t result = save ? NFD_SaveDialog(filter, "", &file) : NFD_OpenDialog(filter, "", &file);
+    std::string path;
+    if (result == NFD_OKAY && file)
+        path = file;
+    free(file);
+
+    g_recorder.add_dialog_result(path);
+    return path;
+}
+
+// edits a copy of the device settings, which are only applied on request,
+// since applying them reopens the device and rebuilds the graph
+void device_panel(LabSoundProvider& provider, lab::noodle::ProviderHarness& harness)
+{
+    static lab::noodle::AudioDeviceSettings edit;
+    static std::vector<lab::noodle::AudioDeviceDescription> devices;
+
+    if (!ImGui::Begin("Audio Device", &g_show_device_panel, ImGuiWindowFlags_AlwaysAutoResize))
+    {
+        ImGui::End();
+        return;
+    }
+    if (ImGui::IsWindowAppearing())
+    {
+        edit = provider.device_settings();
+        devices = provider.audio_devices();
+    }
+
+    auto device_combo = [&](const char* label, std::string& name, bool output)
+    {
+        if (!ImGui::BeginCombo(label, name.empty() ? "Default" : name.c_str()))
+            return;
+        if (ImGui::Selectable("Default", name.empty()))
+            name.clear();
+        for (const lab::noodle::AudioDeviceDescription& d : devices)
+        {
+            if ((output ? d.output_channels : d.input_channels) == 0)
+                continue;
+            if (ImGui::Selectable(d.name.c_str(), d.name == name))
+                name = d.name;
+        }
+        ImGui::EndCombo();
+    };
+
+    device_combo("Output", edit.output_device, true);
+    ImGui::Checkbox("Use input", &edit.with_input);
+    if (edit.with_input)
+        device_combo("Input", edit.input_device, false);
+
+    // the rates offered are those of the chosen output device
+    std::vector<float> rates;
+    for (const lab::noodle::AudioDeviceDescription& d : devices)
+        if (edit.output_device.empty() ? d.default_output : d.name == edit.output_device)
+            rates = d.sample_rates;
+    char rate_label[32];
+    if (edit.sample_rate > 0)
+        sprintf(rate_label, "%.0f Hz", edit.sample_rate);
+    else
+        sprintf(rate_label, "Device default");
+    if (ImGui::BeginCombo("Sample rate", rate_label))
+    {
+        if (ImGui::Selectable("Device default", edit.sample_rate <= 0))
+            edit.sample_rate = 0;
+        for (float rate : rates)
+        {
+            sprintf(rate_label, "%.0f Hz", rate);
+            if (ImGui::Selectable(rate_label, rate == edit.sample_rate))
+                edit.sample_rate = rate;
+        }
+        ImGui::EndCombo();
+    }
+
+    ImGui::InputInt("Output channels", &edit.output_channels);
+    if (edit.with_input)
+        ImGui::InputInt("Input channels", &edit.input_channels);
+    edit.output_channels = std::max(0, edit.output_channels);
+    edit.input_channels = std::max(0, edit.input_channels);
+    ImGui::TextUnformatted("zero channels selects the device's default");
+
+    ImGui::Separator();
+    ImGui::Text("Running at %.0f Hz", provider.context_sample_rate());
+    ImGui::TextUnformatted("The render quantum is 128 frames, fixed when LabSound is built");
+
+    if (ImGui::Button("Apply"))
+        harness.apply_device_settings(edit);
+    ImGui::SameLine();
+    if (ImGui::Button("Revert"))
+        edit = provider.device_settings();
+    ImGui::SameLine();
+    if (ImGui::Button("Refresh devices"))
+        devices = provider.audio_devices();
+
+    ImGui::End();
+}
+
+// latency measured by the probe and the OSC node, with a table of snapshots
+// so that device settings can be compared
+void latency_panel(LabSoundProvider& provider)
+{
+    struct Row
+    {
+        std::string device;
+        float sample_rate;
+        LabSoundProvider::LatencyReport report;
+    };
+    static std::vector<Row> rows;
+
+    if (!ImGui::Begin("Latency", &g_show_latency_panel, ImGuiWindowFlags_AlwaysAutoResize))
+    {
+        ImGui::End();
+        return;
+    }
+
+    LabSoundProvider::LatencyReport report = provider.latency_report();
+    const float sample_rate = provider.context_sample_rate();
+    const float quantum_ms = sample_rate > 0 ? 1000.f * 128 / sample_rate : 0.f;
+    ImGui::Text("%.0f Hz, render quantum 128 frames, %.2f ms", sample_rate, quantum_ms);
+
+    ImGui::Separator();
+    if (!report.has_probe)
+        ImGui::TextUnformatted("Add a LatencyProbe, connect it to the Device, and loop the output back to the input");
+    else if (!report.round_trip_count)
+        ImGui::Text("Round trip: no impulse heard yet, %d timed out", report.round_trip_timeouts);
+    else
+        ImGui::Text("Round trip: %.2f ms, min %.2f mean %.2f max %.2f, %d measured, %d timed out",
+            report.round_trip_last * 1000.f, report.round_trip_min * 1000.f, report.round_trip_mean * 1000.f,
+            report.round_trip_max * 1000.f, report.round_trip_count, report.round_trip_timeouts);
+
+    if (!report.control_count)
+        ImGui::TextUnformatted("Control: no OSC messages rendered yet");
+    else
+    {
+        ImGui::Text("Control, OSC arrival to render: %.2f ms, min %.2f mean %.2f max %.2f, %d measured",
+            report.control_last * 1000.f, report.control_min * 1000.f, report.control_mean * 1000.f,
+            report.control_max * 1000.f, report.control_count);
+
+        // the output half of the round trip is an estimate, the device doesn't
+        // report how its latency divides between input and output
+        if (report.round_trip_count)
+            ImGui::Text("Control, OSC arrival to output, estimated: %.2f ms",
+                (report.control_mean + report.round_trip_mean * 0.5f) * 1000.f);
+    }
+
+    ImGui::Separator();
+    if (ImGui::Button("Add to table"))
+    {
+        lab::noodle::AudioDeviceSettings settings = provider.device_settings();
+        rows.push_back({ settings.output_device.empty() ? std::string("Default") : settings.output_device, sample_rate, report });
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Clear table"))
+        rows.clear();
+
+    if (!rows.empty())
+    {
+        ImGui::Columns(5, "latency_rows");
+        ImGui::TextUnformatted("Device"); ImGui::NextColumn();
+        ImGui::TextUnformatted("Rate"); ImGui::NextColumn();
+        ImGui::TextUnformatted("Round trip ms"); ImGui::NextColumn();
+        ImGui::TextUnformatted("Control ms"); ImGui::NextColumn();
+        ImGui::TextUnformatted("Timeouts"); ImGui::NextColumn();
+        ImGui::Separator();
+        for (const Row& row : rows)
+        {
+            ImGui::TextUnformatted(row.device.c_str()); ImGui::NextColumn();
+            ImGui::Text("%.0f", row.sample_rate); ImGui::NextColumn();
+            ImGui::Text("%.2f / %.2f", row.report.round_trip_mean * 1000.f, row.report.round_trip_max * 1000.f); ImGui::NextColumn();
+            ImGui::Text("%.2f / %.2f", row.report.control_mean * 1000.f, row.report.control_max * 1000.f); ImGui::NextColumn();
+            ImGui::Text("%d", row.report.round_trip_timeouts); ImGui::NextColumn();
+        }
+        ImGui::Columns(1);
+        ImGui::TextUnformatted("times are mean / max");
+    }
+
+    ImGui::End();
+}
+
 void init(void) {
-    _osc_queue = new polymer::spsc_queue<OSCMsg>();
+    _osc_queue = new lab::noodle::SpscRing<OSCMsg>(osc_queue_capacity);
     osc_net_init();
     osc_service_thread = new std::thread([]() {
         open_udp_server();
         });
 
+    if (!g_trace_path.empty())
+        lab::noodle::trace::start();
+
+    if (g_metrics_options.file_path.length() || g_metrics_options.socket_path.length())
+        g_metrics.start(g_metrics_options);
+
+    if (!g_replay_path.empty())
+    {
+        if (g_player.open(g_replay_path))
+            printf("Replaying %s\n", g_replay_path.c_str());
+        else
+            g_quit_after_replay = false;
+    }
+    else if (!g_record_path.empty())
+    {
+        if (g_recorder.open(g_record_path))
+            printf("Recording the session to %s\n", g_record_path.c_str());
+    }
+
     lab::NodeRegistry::Instance().Register(OSCNode::static_name(),
         [](lab::AudioContext& ac)->lab::AudioNode* { return new OSCNode(ac); },
         [](lab::AudioNode* n) { delete n; });
     lab::NodeRegistry::Instance().Register(MidiNode::static_name(),
         [](lab::AudioContext& ac)->lab::AudioNode* { return new MidiNode(ac); },
         [](lab::AudioNode* n) { delete n; });
+    lab::NodeRegistry::Instance().Register(LatencyProbeNode::static_name(),
+        [](lab::AudioContext& ac)->lab::AudioNode* { return new LatencyProbeNode(ac); },
+        [](lab::AudioNode* n) { delete n; });
     
     // setup sokol-gfx, sokol-time and sokol-imgui
     sg_desc desc = { };
@@ -228,15 +533,50 @@ void init(void) {
     style.AntiAliasedFill = true;
 }
 
-void frame()
+// runs one frame of the editor, drawing it only if it is to be presented
+static void run_frame(bool present)
 {
-    const int width = sapp_width();
-    const int height = sapp_height();
+    lab::noodle::trace::name_thread("UI");
+    LAB_TIME_SCOPE("frame", "ui");
+
+    int width = sapp_width();
+    int height = sapp_height();
     //const float w = (float)sapp_width();
     //const float h = (float)sapp_height();
-    const double delta_time = stm_sec(stm_laptime(&last_time));
+    double delta_time = stm_sec(stm_laptime(&last_time));
 
-    sg_begin_default_pass(&pass_action, width, height);
+    if (present)
+        sg_begin_default_pass(&pass_action, width, height);
+
+    // a replayed frame takes its input, time step, and canvas size from the
+    // session, rather than from the window, so that it runs as it was recorded
+    lab::noodle::SessionFrame replay;
+    const bool replaying = g_player.playing();
+    g_replaying_frame = replaying;
+    if (replaying)
+    {
+        g_player.next_frame(replay);
+        for (const lab::noodle::SessionInputEvent& e : replay.input)
+        {
+            sapp_event event = to_sapp_event(e);
+            simgui_handle_event(&event);
+        }
+        delta_time = replay.delta_time;
+        width = replay.width;
+        height = replay.height;
+        g_replay_dialogs.swap(replay.dialog_results);
+        g_next_replay_dialog = 0;
+        if (!g_player.playing())
+        {
+            printf("Replay finished\n");
+            if (g_quit_after_replay)
+                sapp_request_quit();
+        }
+    }
+    else
+    {
+        g_recorder.begin_frame(static_cast<float>(delta_time), width, height);
+    }
 
     ImGuiIO& io = ImGui::GetIO();
     ImGui::SetNextWindowPos({ 0,0 });
@@ -248,13 +588,36 @@ void frame()
 
     imgui_fixed_window_begin("GraphToyCanvas", 0.f, 20.f, static_cast<float>(width), static_cast<float>(height));
 
-    static LabSoundProvider provider;
+    static LabSoundProvider provider(g_device_settings);
     static lab::noodle::ProviderHarness config(provider);
-    OSCMsg osc_msg;
-    while (_osc_queue->consume(osc_msg))
+    if (!config.file_dialog)
+        config.file_dialog = file_dialog;
+    // messages are taken from the queue a batch at a time
+    static OSCMsg osc_batch[256];
+    while (size_t count = _osc_queue->pop(osc_batch, 256))
     {
-        provider.add_osc_addr(osc_msg.addr, osc_msg.addr_id, osc_msg.argc, osc_msg.data);
+        // live messages are dropped during a replay, the recorded ones stand in for them
+        if (replaying)
+            continue;
+
+        for (size_t m = 0; m < count; ++m)
+        {
+            const OSCMsg& osc_msg = osc_batch[m];
+            provider.add_osc_addr(osc_msg.addr, osc_msg.addr_id, osc_msg.argc, osc_msg.data, osc_msg.arrival);
+            if (g_recorder.recording())
+            {
+                lab::noodle::SessionOscMessage msg;
+                msg.addr = osc_msg.addr;
+                msg.addr_id = osc_msg.addr_id;
+                msg.argc = osc_msg.argc;
+                for (int i = 0; i < 4; ++i)
+                    msg.data[i] = osc_msg.data[i];
+                g_recorder.add_osc(msg);
+            }
+        }
     }
+    for (lab::noodle::SessionOscMessage& msg : replay.osc)
+        provider.add_osc_addr(msg.addr.c_str(), msg.addr_id, msg.argc, msg.data);
 
     static Command command = Command::None;
     if (ImGui::BeginMainMenuBar())
@@ -264,7 +627,11 @@ void frame()
             bool save = false;
             bool new_file = false;
             bool load = false;
+            bool save_bundle = false;
+            bool load_bundle = false;
             bool export_cpp = false;
+            bool export_static_cpp = false;
+            bool export_static_cpp_benchmark = false;
             bool quit = false;
             ImGui::MenuItem("New", 0, &new_file);
             if (new_file)
@@ -275,20 +642,99 @@ void frame()
             ImGui::MenuItem("Save", 0, &save);
             if (save)
                 command = Command::Save;
+            ImGui::MenuItem("Open Bundle", 0, &load_bundle);
+            if (load_bundle)
+                command = Command::OpenBundle;
+            ImGui::MenuItem("Save Bundle", 0, &save_bundle);
+            if (save_bundle)
+                command = Command::SaveBundle;
             ImGui::MenuItem("Export as C++", 0, &export_cpp);
             if (export_cpp)
                 command = Command::ExportCpp;
+            ImGui::MenuItem("Export as static C++", 0, &export_static_cpp);
+            if (export_static_cpp)
+                command = Command::ExportStaticCpp;
+            ImGui::MenuItem("Export as static C++ with benchmark", 0, &export_static_cpp_benchmark);
+            if (export_static_cpp_benchmark)
+                command = Command::ExportStaticCppBenchmark;
             ImGui::MenuItem("Quit", 0, &quit);
             if (quit)
                 command = Command::Quit;
             ImGui::EndMenu();
         }
+        if (ImGui::BeginMenu("Audio"))
+        {
+            ImGui::MenuItem("Device", 0, &g_show_device_panel);
+            ImGui::MenuItem("Latency", 0, &g_show_latency_panel);
+            ImGui::EndMenu();
+        }
         if (ImGui::BeginMenu("Debug"))
         {
             ImGui::Checkbox("Show Profiler", &config.show_profiler);
             ImGui::Checkbox("Show Graph Canvas values", &config.show_debug);
             ImGui::Checkbox("Show ImGui demo", &config.show_demo);
             ImGui::Checkbox("Show IDs", &config.show_ids);
+            ImGui::Checkbox("Show Deadlines", &config.show_deadlines);
+            ImGui::Checkbox("Show Heat Map", &config.show_heat_map);
+            ImGui::Checkbox("Show Memory", &config.show_memory);
+
+            lab::noodle::DeadlineStatistics deadlines;
+            if (provider.deadline_statistics(deadlines))
+                ImGui::Text("%llu deadline misses, %llu underruns in %llu quanta", (unsigned long long) deadlines.misses,
+                    (unsigned long long) deadlines.underruns, (unsigned long long) deadlines.quanta);
+
+#if LAB_RT_GUARD
+            bool guard = lab::noodle::rt_guard::enabled();
+            if (ImGui::Checkbox("Guard Audio Thread", &guard))
+                lab::noodle::rt_guard::enable(guard);
+            if (guard)
+            {
+                lab::noodle::rt_guard::Counts violations = lab::noodle::rt_guard::counts();
+                ImGui::Text("%llu allocations, %llu frees, %llu locks on the audio thread",
+                    (unsigned long long) violations.allocations, (unsigned long long) violations.frees,
+                    (unsigned long long) violations.locks);
+                if (ImGui::Button("Print Stacks"))
+                    lab::noodle::rt_guard::print_stacks(stdout);
+            }
+#endif
+
+            // the rate is measured over the last second or so
+            const lab::noodle::UdpReceiveStatistics& osc = g_osc_receiver.statistics();
+            static uint64_t last_datagrams = 0;
+            static double osc_rate_time = 0;
+            static float datagrams_per_second = 0;
+            const double osc_now = stm_sec(stm_now());
+            if (osc_now - osc_rate_time >= 1.0)
+            {
+                const uint64_t datagrams = osc.datagrams.load(std::memory_order_relaxed);
+                datagrams_per_second = static_cast<float>((datagrams - last_datagrams) / (osc_now - osc_rate_time));
+                last_datagrams = datagrams;
+                osc_rate_time = osc_now;
+            }
+            ImGui::Text("OSC %.0f packets/s, %llu dropped by the system, %llu too large, %llu messages over the queue",
+                datagrams_per_second, (unsigned long long) osc.kernel_drops.load(std::memory_order_relaxed),
+                (unsigned long long) osc.truncated.load(std::memory_order_relaxed),
+                (unsigned long long) _osc_queue->overflows());
+
+            const lab::noodle::MemoryReport& memory = config.memory_report();
+            ImGui::Text("%.2f MB audio, %.2f MB editor, in %d nodes", memory.audio / (1024.0 * 1024.0),
+                memory.bookkeeping / (1024.0 * 1024.0), (int) memory.nodes.size());
+
+            bool tracing = lab::noodle::trace::recording();
+            if (ImGui::Checkbox("Record Trace", &tracing))
+            {
+                if (tracing)
+                    lab::noodle::trace::start();
+                else
+                {
+                    lab::noodle::trace::stop();
+                    std::string file = file_dialog(true, "*.json");
+                    if (!file.empty())
+                        lab::noodle::trace::write(file);
+                }
+            }
+            if (lab::noodle::trace::recording())
+                ImGui::Text("%d trace events, %d dropped", (int) lab::noodle::trace::event_count(), (int) lab::noodle::trace::dropped());
             ImGui::EndMenu();
         }
         ImGui::EndMainMenuBar();
@@ -307,9 +753,8 @@ void frame()
             {
                 if (ImGui::Button("Save and Quit"))
                 {
-                    char* file = nullptr;
-                    nfdresult_t result = NFD_SaveDialog("*.ls", "", &file);
-                    if (file)
+                    std::string file = file_dialog(true, "*.ls");
+                    if (!file.empty())
                     {
                         config.save(file);
                         sapp_request_quit();
@@ -346,9 +791,8 @@ void frame()
             {
                 if (ImGui::Button("Save work in progress"))
                 {
-                    char* file = nullptr;
-                    nfdresult_t result = NFD_SaveDialog("*.ls", "", &file);
-                    if (file)
+                    std::string file = file_dialog(true, "*.ls");
+                    if (!file.empty())
                     {
                         config.save(file);
                         config.clear_all();
@@ -379,9 +823,8 @@ void frame()
 
     case Command::Save:
     {
-        char* file = nullptr;
-        nfdresult_t result = NFD_SaveDialog("*.ls", "", &file);
-        if (file)
+        std::string file = file_dialog(true, "*.ls");
+        if (!file.empty())
         {
             config.save(file);
         }
@@ -389,11 +832,32 @@ void frame()
         break;
     }
             
+    case Command::SaveBundle:
+    {
+        std::string file = file_dialog(true, "*.lsb");
+        if (!file.empty())
+        {
+            config.save_bundle(file);
+        }
+        command = Command::None;
+        break;
+    }
+
+    case Command::OpenBundle:
+    {
+        std::string file = file_dialog(false, "*.lsb");
+        if (!file.empty())
+        {
+            config.load_bundle(file);
+        }
+        command = Command::None;
+        break;
+    }
+
     case Command::ExportCpp:
     {
-        char* file = nullptr;
-        nfdresult_t result = NFD_SaveDialog("*.cpp", "", &file);
-        if (file)
+        std::string file = file_dialog(true, "*.cpp");
+        if (!file.empty())
         {
             config.export_cpp(file);
         }
@@ -401,6 +865,28 @@ void frame()
         break;
     }
 
+    case Command::ExportStaticCpp:
+    {
+        std::string file = file_dialog(true, "*.h");
+        if (!file.empty())
+        {
+            config.export_cpp_static(file);
+        }
+        command = Command::None;
+        break;
+    }
+
+    case Command::ExportStaticCppBenchmark:
+    {
+        std::string file = file_dialog(true, "*.h");
+        if (!file.empty())
+        {
+            config.export_cpp_static(file, true);
+        }
+        command = Command::None;
+        break;
+    }
+
     case Command::Open:
         if (config.needs_saving())
         {
@@ -409,9 +895,8 @@ void frame()
             {
                 if (ImGui::Button("Save work in progress?"))
                 {
-                    char* file = nullptr;
-                    nfdresult_t result = NFD_SaveDialog("*.ls", "", &file);
-                    if (file)
+                    std::string file = file_dialog(true, "*.ls");
+                    if (!file.empty())
                     {
                         config.save(file);
                         config.clear_all();
@@ -436,9 +921,8 @@ void frame()
         {
             command = Command::None;
         }
-        char* file = nullptr;
-        nfdresult_t result = NFD_OpenDialog("*.ls", "", &file);
-        if (file)
+        std::string file = file_dialog(false, "*.ls");
+        if (!file.empty())
         {
             config.clear_all();
             config.load(file);
@@ -449,8 +933,43 @@ void frame()
 
     config.run();
 
+    if (g_metrics.running())
+    {
+        lab::noodle::MetricsSample sample;
+        lab::noodle::DeadlineStatistics deadlines;
+        if (provider.deadline_statistics(deadlines))
+        {
+            sample.quantum_budget_us = deadlines.budget_seconds * 1.e6;
+            sample.quantum_p50_us = (double) deadlines.render_time->percentile(0.5);
+            sample.quantum_p99_us = (double) deadlines.render_time->percentile(0.99);
+            sample.quantum_max_us = (double) deadlines.render_time->max();
+            sample.quanta = deadlines.quanta;
+            sample.deadline_misses = deadlines.misses;
+            sample.underruns = deadlines.underruns;
+        }
+        const lab::noodle::UdpReceiveStatistics& osc = g_osc_receiver.statistics();
+        sample.osc_datagrams = osc.datagrams.load(std::memory_order_relaxed);
+        sample.osc_truncated = osc.truncated.load(std::memory_order_relaxed);
+        sample.osc_kernel_drops = osc.kernel_drops.load(std::memory_order_relaxed);
+        sample.osc_messages = g_osc_received.load(std::memory_order_relaxed);
+        sample.osc_queue_depth = _osc_queue->size();
+        sample.osc_queue_overflows = _osc_queue->overflows();
+        sample.timing_drops = config.dropped_quanta();
+        sample.frame_seconds = delta_time;
+        const lab::noodle::MemoryReport& memory = config.memory_report();
+        sample.audio_bytes = memory.audio;
+        sample.bookkeeping_bytes = memory.bookkeeping;
+        sample.nodes = memory.nodes.size();
+        g_metrics.publish(sample);
+    }
+
     imgui_fixed_window_end();
 
+    if (g_show_device_panel)
+        device_panel(provider, config);
+    if (g_show_latency_panel)
+        latency_panel(provider);
+
     if (config.show_demo)
         ImGui::ShowDemoWindow();
 
@@ -458,14 +977,35 @@ void frame()
 
     sg_imgui_draw(&sg_imgui);
 
+    if (!present)
+    {
+        ImGui::Render();
+        return;
+    }
+
     // the sokol_gfx draw pass
     simgui_render();
     sg_end_pass();
     sg_commit();
 }
 
+void frame()
+{
+    // a replay isn't paced by the display. its frames run without being
+    // drawn until a display interval has passed, then one is presented
+    if (g_player.playing())
+    {
+        const uint64_t start = stm_now();
+        while (g_player.playing() && stm_ms(stm_since(start)) < replay_present_interval_ms)
+            run_frame(false);
+    }
+    run_frame(true);
+}
+
 void cleanup(void) 
 {
+    g_metrics.stop();
+
     if (osc_service_thread)
     {
         join_osc = true;
@@ -475,6 +1015,16 @@ void cleanup(void)
     }
     delete _osc_queue;
     osc_net_shutdown();
+    g_recorder.close();
+
+    if (!g_trace_path.empty())
+    {
+        lab::noodle::trace::stop();
+        lab::noodle::trace::write(g_trace_path);
+    }
+
+    if (g_instrument_dump)
+        lab::noodle::instrument::dump(stdout);
 
     sg_imgui_discard(&sg_imgui);
     simgui_shutdown();
@@ -483,6 +1033,11 @@ void cleanup(void)
 
 void input(const sapp_event* event) 
 {
+    // live input is ignored while a session is replayed
+    if (g_player.playing())
+        return;
+
+    g_recorder.add_input(to_session_event(*event));
     simgui_handle_event(event);
 }
 
@@ -494,6 +1049,44 @@ sapp_desc sokol_main(int argc, char* argv[])
         index = app_path.rfind('\\');
     g_app_path = app_path.substr(0, index);
 
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg(argv[i]);
+        if (arg == "--record" && i + 1 < argc)
+            g_record_path = argv[++i];
+        else if (arg == "--replay" && i + 1 < argc)
+            g_replay_path = argv[++i];
+        else if (arg == "--trace" && i + 1 < argc)
+            g_trace_path = argv[++i];
+        else if (arg == "--quit-after-replay")
+            g_quit_after_replay = true;
+        else if (arg == "--instrument-dump")
+            g_instrument_dump = true;
+        else if (arg == "--metrics-file" && i + 1 < argc)
+            g_metrics_options.file_path = argv[++i];
+        else if (arg == "--metrics-socket" && i + 1 < argc)
+            g_metrics_options.socket_path = argv[++i];
+        else if (arg == "--metrics-interval" && i + 1 < argc)
+            g_metrics_options.interval = atof(argv[++i]);
+        else if (arg == "--output-device" && i + 1 < argc)
+            g_device_settings.output_device = argv[++i];
+        else if (arg == "--input-device" && i + 1 < argc)
+            g_device_settings.input_device = argv[++i];
+        else if (arg == "--no-input")
+            g_device_settings.with_input = false;
+        else if (arg == "--sample-rate" && i + 1 < argc)
+            g_device_settings.sample_rate = static_cast<float>(atof(argv[++i]));
+        else if (arg == "--output-channels" && i + 1 < argc)
+            g_device_settings.output_channels = atoi(argv[++i]);
+        else if (arg == "--input-channels" && i + 1 < argc)
+            g_device_settings.input_channels = atoi(argv[++i]);
+        else
+            printf("Unknown argument %s, usage: %s [--record session.lss | --replay session.lss [--quit-after-replay]]\n"
+                   "    [--output-device name] [--input-device name | --no-input] [--sample-rate hz]\n"
+                   "    [--output-channels n] [--input-channels n] [--trace trace.json]\n"
+                   "    [--metrics-file metrics.txt] [--metrics-socket path] [--metrics-interval seconds]\n", argv[i], argv[0]);
+    }
+
     sapp_desc desc = { };
     desc.init_cb = init;
     desc.frame_cb = frame;
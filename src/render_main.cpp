@@ -0,0 +1,173 @@
+
+// LabSoundGraphToyRender renders patches to WAV files, with no window,
+// and no audio device.
+
+#include "lab_regression.h"
+#include "lab_render.h"
+#include "lab_rt_guard.h"
+#include "LatencyProbeNode.hpp"
+
+#include <LabSound/LabSound.h>
+
+#include <CLI/CLI.hpp>
+
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+int main(int argc, char** argv)
+{
+    // patches are built as the editor builds them, from the same nodes
+    lab::NodeRegistry::Instance().Register(LatencyProbeNode::static_name(),
+        [](lab::AudioContext& ac)->lab::AudioNode* { return new LatencyProbeNode(ac); },
+        [](lab::AudioNode* n) { delete n; });
+
+    lab::noodle::RenderOptions options;
+    std::vector<std::string> inputs;
+    std::string output_dir;
+    int jobs = 0;
+    std::string record_reference;
+    std::string check_reference;
+    lab::noodle::RegressionTolerance tolerance;
+    bool guard_render_thread = false;
+
+    CLI::App app{ "Render LabSoundGraphToy patches offline, to WAV files" };
+    app.add_option("patches", inputs, "patches (.ls), bundles (.lsb), or directories of them, to render")->required()->check(CLI::ExistingPath);
+    auto output = app.add_option("-o,--output", options.output_path, "output WAV file when rendering a single patch, defaults to the patch name with a .wav extension");
+    app.add_option("--output-dir", output_dir, "directory for the rendered WAV files, defaults to next to each patch")->excludes(output);
+    app.add_option("-d,--duration", options.duration, "duration in seconds")->capture_default_str()->check(CLI::PositiveNumber);
+    app.add_option("-r,--sample-rate", options.sample_rate, "sample rate in Hz, defaults to the patch's device settings, or 48000")->check(CLI::PositiveNumber);
+    app.add_option("-c,--channels", options.channels, "channel count, defaults to the patch's device settings, or 2")->check(CLI::Range(1, 32));
+    app.add_option("-j,--jobs", jobs, "number of patches to render concurrently, defaults to one per core");
+    auto record = app.add_option("--record-reference", record_reference, "write the fingerprint and render time of every patch to a regression reference file");
+    app.add_option("--check-reference", check_reference, "compare every patch against a regression reference file, and fail on any difference")->check(CLI::ExistingFile)->excludes(record);
+    app.add_option("--spectrum-tolerance", tolerance.spectrum_db, "largest difference in dB allowed per spectrum band, if a render is not bit identical to the reference")->capture_default_str();
+    app.add_option("--time-tolerance", tolerance.time_ratio, "largest ratio of render time to reference render time allowed")->capture_default_str()->check(CLI::PositiveNumber);
+    app.add_option("--time-floor", tolerance.time_floor, "smallest slowdown in seconds that can fail a render, however large its ratio")->capture_default_str()->check(CLI::NonNegativeNumber);
+    app.add_flag("--rt-guard", guard_render_thread, "fail if the render thread allocates, frees, or locks, as it does when checking a reference");
+    CLI11_PARSE(app, argc, argv);
+
+    // directories contribute every patch and bundle they contain
+    std::vector<std::string> patches;
+    for (auto& input : inputs)
+    {
+        if (!fs::is_directory(input))
+        {
+            patches.push_back(input);
+            continue;
+        }
+
+        for (auto& entry : fs::directory_iterator(input))
+        {
+            std::string ext = entry.path().extension().string();
+            if (entry.is_regular_file() && (ext == ".ls" || ext == ".lsb"))
+                patches.push_back(entry.path().string());
+        }
+    }
+
+    if (patches.empty())
+    {
+        printf("No patches to render\n");
+        return 1;
+    }
+    if (patches.size() > 1 && options.output_path.length())
+    {
+        printf("--output names a single file, use --output-dir when rendering several patches\n");
+        return 1;
+    }
+
+    std::vector<lab::noodle::RenderOptions> batch;
+    for (auto& patch : patches)
+    {
+        lab::noodle::RenderOptions job = options;
+        job.patch_path = patch;
+        if (!job.output_path.length())
+        {
+            fs::path out = fs::path(patch).replace_extension(".wav");
+            if (output_dir.length())
+                out = fs::path(output_dir) / out.filename();
+            job.output_path = out.string();
+        }
+        batch.push_back(job);
+    }
+
+    if (output_dir.length())
+        fs::create_directories(output_dir);
+
+    lab::noodle::RegressionReference reference;
+    if (check_reference.length() && !lab::noodle::read_regression_reference(check_reference, reference))
+        return 1;
+
+    if (check_reference.length())
+        guard_render_thread = true;
+    lab::noodle::rt_guard::enable(guard_render_thread);
+
+    lab::noodle::RenderStats stats;
+    std::vector<lab::noodle::RenderStats> each;
+    int failures = lab::noodle::render_batch(batch, jobs, &stats, &each);
+
+    printf("rendered %d of %d patches, %.2f s of audio in %.2f s (%.1fx realtime), %.2f MB of audio memory\n",
+        (int) batch.size() - failures, (int) batch.size(), stats.rendered_seconds, stats.wall_seconds,
+        stats.wall_seconds > 0 ? stats.rendered_seconds / stats.wall_seconds : 0.0,
+        stats.audio_bytes / (1024.0 * 1024.0));
+
+    // every render shares the counts, so a violation fails the run rather than a patch
+    if (guard_render_thread)
+    {
+        lab::noodle::rt_guard::enable(false);
+        if (lab::noodle::rt_guard::counts().total())
+        {
+            lab::noodle::rt_guard::print_stacks(stdout);
+            ++failures;
+        }
+    }
+
+    if (!record_reference.length() && !check_reference.length())
+        return failures ? 1 : 0;
+
+    // render times are only comparable between runs with the same --jobs,
+    // as concurrent renders compete for cores and memory bandwidth
+    lab::noodle::RegressionReference current;
+    for (size_t i = 0; i < batch.size(); ++i)
+    {
+        if (!each[i].succeeded)
+            continue;
+
+        lab::noodle::RegressionEntry entry;
+        entry.wall_seconds = each[i].wall_seconds;
+        if (!lab::noodle::fingerprint_wav(batch[i].output_path, entry.fingerprint))
+        {
+            ++failures;
+            continue;
+        }
+        current[fs::path(batch[i].patch_path).filename().string()] = entry;
+    }
+
+    if (record_reference.length())
+    {
+        if (!lab::noodle::write_regression_reference(record_reference, current))
+            return 1;
+        printf("recorded %d patches to %s\n", (int) current.size(), record_reference.c_str());
+        return failures ? 1 : 0;
+    }
+
+    int regressions = 0;
+    for (auto& patch : current)
+    {
+        auto ref = reference.find(patch.first);
+        if (ref == reference.end())
+        {
+            printf("%s: not in the reference\n", patch.first.c_str());
+            ++regressions;
+            continue;
+        }
+        if (!lab::noodle::compare_regression(patch.first, ref->second, patch.second, tolerance))
+            ++regressions;
+    }
+
+    printf("%d of %d patches matched the reference\n", (int) current.size() - regressions, (int) batch.size());
+    return failures || regressions ? 1 : 0;
+}
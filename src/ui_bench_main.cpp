@@ -0,0 +1,354 @@
+
+// LabSoundGraphToyUIBench measures the editor's frame time while a script
+// drives it with mouse input. Dear ImGui runs with no window, and no renderer;
+// draw lists are built as usual, and then discarded.
+
+#include "lab_imgui_ext.hpp"
+#include "lab_instrument.h"
+#include "lab_noodle.h"
+#include "lab_noodle_core.h"
+#include "LabSoundInterface.h"
+
+#include <LabSound/LabSound.h>
+
+#include <rapidjson/prettywriter.h>
+#include <rapidjson/stringbuffer.h>
+
+#include <CLI/CLI.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+using lab::noodle::GraphCore;
+using lab::noodle::ProviderHarness;
+using lab::noodle::Work;
+using lab::noodle::WorkType;
+
+namespace {
+
+    const float display_width = 1920.f;
+    const float display_height = 1080.f;
+    const float menu_height = 20.f;  // the editor's canvas sits below the main menu
+
+    struct FrameInput
+    {
+        ImVec2 mouse = { -1.f, -1.f };
+        bool down = false;
+        float wheel = 0;
+    };
+
+    struct Scenario
+    {
+        std::string name;
+        std::vector<FrameInput> frames;
+    };
+
+    struct Result
+    {
+        int nodes = 0;
+        std::string scenario;
+        int frames = 0;
+        ProviderHarness::FrameTimings mean;
+        double imgui_us = 0;        // ImGui::Render, finalizing the draw lists
+        double total_p99_us = 0;
+    };
+
+    // runs one editor frame, and returns the time taken by ImGui::Render
+    double frame(std::unique_ptr<ProviderHarness>& harness, LabSoundProvider& provider, const FrameInput& input)
+    {
+        ImGuiIO& io = ImGui::GetIO();
+        io.DeltaTime = 1.f / 60.f;
+        io.MousePos = input.mouse;
+        io.MouseDown[0] = input.down;
+        io.MouseWheel = input.wheel;
+
+        ImGui::NewFrame();
+        imgui_fixed_window_begin("GraphToyCanvas", 0.f, menu_height, display_width, display_height);
+        if (!harness)
+            harness = std::make_unique<ProviderHarness>(provider);
+        harness->run();
+        imgui_fixed_window_end();
+
+        auto start = std::chrono::steady_clock::now();
+        ImGui::Render();
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void queue_node(GraphCore& core, const std::string& kind, const std::string& name, float x, float y)
+    {
+        Work work(core.provider, core.root);
+        work.type = WorkType::CreateNode;
+        work.kind = kind;
+        work.name = name;
+        work.canvas_pos = { x, y };
+        core.pending_work.emplace_back(std::move(work));
+    }
+
+    void queue_connection(GraphCore& core, const std::string& from, const std::string& to)
+    {
+        Work work(core.provider, core.root);
+        work.type = WorkType::ConnectBusOutToBusIn;
+        work.pendingConnection = std::make_unique<lab::noodle::WorkPendingConnection>();
+        work.pendingConnection->from_node = from;
+        work.pendingConnection->to_node = to;
+        work.pendingConnection->to_pin_kind = "bus";
+        core.pending_work.emplace_back(std::move(work));
+    }
+
+    // pairs of oscillator and gain, on a grid, every gain connected to the Device.
+    // the left of the canvas is kept clear, so that panning has somewhere to grab.
+    void queue_patch(GraphCore& core, int nodes, const std::string& device)
+    {
+        const int pairs = std::max(1, nodes / 2);
+        const int columns = 4;
+        for (int i = 0; i < pairs; ++i)
+        {
+            float x = 300.f + (i % columns) * 420.f;
+            float y = 60.f + (i / columns) * 160.f;
+            std::string osc = "Osc " + std::to_string(i);
+            std::string gain = "Gain " + std::to_string(i);
+            queue_node(core, "Oscillator", osc, x, y);
+            queue_node(core, "Gain", gain, x + 210.f, y);
+            queue_connection(core, osc, gain);
+            queue_connection(core, gain, device);
+        }
+    }
+
+    // the canvas to window transform, as applied by the editor
+    ImVec2 to_window(const lab::noodle::Canvas& canvas, lab::noodle::vec2 cs)
+    {
+        return { canvas.window_origin_offset_ws.x + cs.x * canvas.scale + canvas.origin_offset_ws.x,
+                 canvas.window_origin_offset_ws.y + cs.y * canvas.scale + canvas.origin_offset_ws.y };
+    }
+
+    void drag(Scenario& s, ImVec2 from, ImVec2 to, int frames)
+    {
+        s.frames.push_back({ from, false, 0 });
+        for (int i = 0; i <= frames; ++i)
+        {
+            float t = static_cast<float>(i) / frames;
+            s.frames.push_back({ { from.x + (to.x - from.x) * t, from.y + (to.y - from.y) * t }, true, 0 });
+        }
+        s.frames.push_back({ to, false, 0 });
+    }
+
+    // the script is built from the layout of the patch, so that drags land
+    // on a node, and on a pin. all interactions start from the layout the
+    // patch was created with, and leave the canvas where they found it.
+    std::vector<Scenario> script(GraphCore& core)
+    {
+        lab::noodle::Provider& provider = core.provider;
+        const lab::noodle::Canvas& canvas = core.root.canvas;
+        std::vector<Scenario> result;
+
+        Scenario idle{ "idle" };
+        for (int i = 0; i < 60; ++i)
+            idle.frames.push_back({ { display_width * 0.5f, display_height * 0.5f }, false, 0 });
+        result.push_back(idle);
+
+        Scenario hover{ "hover" };
+        for (int i = 0; i < 120; ++i)
+        {
+            float t = i / 119.f;
+            hover.frames.push_back({ { display_width * t, menu_height + (display_height - menu_height) * t }, false, 0 });
+        }
+        result.push_back(hover);
+
+        ln_Node osc = provider.entity_for_node_named("Osc 0");
+        auto node_graphic = provider.find_node_graphic(osc);
+        if (node_graphic)
+        {
+            // grab the title, away from the pins, drag there and back
+            ImVec2 title = to_window(canvas, { node_graphic->ul_cs.x + 90.f, node_graphic->ul_cs.y + 5.f });
+            Scenario node_drag{ "node-drag" };
+            drag(node_drag, title, { title.x + 200.f, title.y + 100.f }, 30);
+            drag(node_drag, { title.x + 200.f, title.y + 100.f }, title, 30);
+            result.push_back(node_drag);
+        }
+
+        auto pin_graphic = provider.find_pin_graphic(provider.node_output_with_index(osc, 0));
+        if (pin_graphic)
+        {
+            // dropping a wire on empty canvas abandons it
+            lab::noodle::Canvas c = canvas;
+            lab::noodle::vec2 ul = pin_graphic->ul_ws(c);
+            ImVec2 pin = { ul.x + lab::noodle::NoodlePinGraphic::k_width() * 0.5f, ul.y + lab::noodle::NoodlePinGraphic::k_height() * 0.5f };
+            Scenario wire_drag{ "wire-drag" };
+            drag(wire_drag, pin, { 150.f, display_height - 100.f }, 60);
+            result.push_back(wire_drag);
+        }
+
+        Scenario pan{ "pan" };
+        ImVec2 empty = { 100.f, display_height * 0.5f };
+        drag(pan, empty, { empty.x + 150.f, empty.y - 200.f }, 30);
+        drag(pan, { empty.x + 150.f, empty.y - 200.f }, empty, 30);
+        result.push_back(pan);
+
+        Scenario zoom{ "zoom" };
+        ImVec2 center = { display_width * 0.5f, display_height * 0.5f };
+        for (int i = 0; i < 4; ++i)
+            zoom.frames.push_back({ center, false, -1.f });
+        for (int i = 0; i < 4; ++i)
+            zoom.frames.push_back({ center, false, 1.f });
+        for (int i = 0; i < 52; ++i)
+            zoom.frames.push_back({ center, false, 0 });
+        result.push_back(zoom);
+
+        return result;
+    }
+
+    bool write_results(const std::string& path, const std::vector<Result>& results)
+    {
+        std::ofstream file(path, std::ios::binary);
+        if (!file)
+        {
+            printf("Could not write %s\n", path.c_str());
+            return false;
+        }
+
+        size_t ext = path.find_last_of('.');
+        if (ext != std::string::npos && path.substr(ext) == ".json")
+        {
+            rapidjson::StringBuffer s;
+            rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(s);
+            writer.StartArray();
+            for (const Result& r : results)
+            {
+                writer.StartObject();
+                writer.Key("nodes"); writer.Int(r.nodes);
+                writer.Key("scenario"); writer.String(r.scenario.c_str());
+                writer.Key("frames"); writer.Int(r.frames);
+                writer.Key("layout_us"); writer.Double(r.mean.layout);
+                writer.Key("interaction_us"); writer.Double(r.mean.interaction);
+                writer.Key("wires_us"); writer.Double(r.mean.wires);
+                writer.Key("nodes_us"); writer.Double(r.mean.nodes);
+                writer.Key("profiler_us"); writer.Double(r.mean.profiler);
+                writer.Key("work_us"); writer.Double(r.mean.work);
+                writer.Key("imgui_us"); writer.Double(r.imgui_us);
+                writer.Key("total_mean_us"); writer.Double(r.mean.total);
+                writer.Key("total_p99_us"); writer.Double(r.total_p99_us);
+                writer.EndObject();
+            }
+            writer.EndArray();
+            file << s.GetString() << "\n";
+            return true;
+        }
+
+        file << "nodes,scenario,frames,layout_us,interaction_us,wires_us,nodes_us,profiler_us,work_us,imgui_us,total_mean_us,total_p99_us\n";
+        char buff[512];
+        for (const Result& r : results)
+        {
+            snprintf(buff, sizeof(buff), "%d,%s,%d,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f\n",
+                r.nodes, r.scenario.c_str(), r.frames, r.mean.layout, r.mean.interaction, r.mean.wires,
+                r.mean.nodes, r.mean.profiler, r.mean.work, r.imgui_us, r.mean.total, r.total_p99_us);
+            file << buff;
+        }
+        return true;
+    }
+
+} // anon
+
+int main(int argc, char** argv)
+{
+    std::vector<int> sizes = { 10, 100, 1000 };
+    std::string output = "ui_frame_times.csv";
+    bool show_profiler = false;
+    bool instrument_dump = false;
+
+    CLI::App app{ "Benchmark the LabSoundGraphToy editor's frame time, with scripted interaction, and no window" };
+    app.add_option("-n,--sizes", sizes, "node counts of the synthetic patches")->capture_default_str();
+    app.add_option("-o,--output", output, "table of results, JSON if the name ends in .json, otherwise CSV")->capture_default_str();
+    app.add_flag("--profiler", show_profiler, "show the profiler window, as if it were enabled in the Debug menu");
+    app.add_flag("--instrument-dump", instrument_dump, "print the instrumentation's totals for every size and scenario");
+    CLI11_PARSE(app, argc, argv);
+
+    ImGui::CreateContext();
+    ImGuiIO& io = ImGui::GetIO();
+    io.IniFilename = nullptr;
+    io.DisplaySize = { display_width, display_height };
+    unsigned char* pixels = nullptr;
+    int width = 0, height = 0;
+    io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+
+    std::vector<Result> results;
+    for (int size : sizes)
+    {
+        // an offline context is never rendered, it only hosts the nodes
+        lab::AudioStreamConfig config;
+        config.device_index = 0;
+        config.desired_channels = 2;
+        config.desired_samplerate = 48000.f;
+        LabSoundProvider provider(lab::MakeOfflineAudioContext(config, 1000.0));
+        std::unique_ptr<ProviderHarness> harness;
+
+        // the first frame creates the Device, the second builds the patch,
+        // the third lays it out
+        frame(harness, provider, {});
+        harness->show_profiler = show_profiler;
+        lab::noodle::NoodleNode* device = provider.find_node(harness->core().device_node);
+        if (!device)
+        {
+            printf("Could not create a Device\n");
+            return 1;
+        }
+        queue_patch(harness->core(), size, device->name);
+        frame(harness, provider, {});
+        frame(harness, provider, {});
+
+        for (const Scenario& scenario : script(harness->core()))
+        {
+            Result r;
+            r.nodes = static_cast<int>(harness->core().root.nodes.size());
+            r.scenario = scenario.name;
+            r.frames = static_cast<int>(scenario.frames.size());
+
+            std::vector<double> totals;
+            for (const FrameInput& input : scenario.frames)
+            {
+                r.imgui_us += frame(harness, provider, input);
+                const ProviderHarness::FrameTimings& t = harness->frame_timings();
+                r.mean.layout += t.layout;
+                r.mean.interaction += t.interaction;
+                r.mean.wires += t.wires;
+                r.mean.nodes += t.nodes;
+                r.mean.profiler += t.profiler;
+                r.mean.work += t.work;
+                r.mean.total += t.total;
+                totals.push_back(t.total);
+            }
+
+            double n = static_cast<double>(r.frames);
+            r.mean.layout /= n;
+            r.mean.interaction /= n;
+            r.mean.wires /= n;
+            r.mean.nodes /= n;
+            r.mean.profiler /= n;
+            r.mean.work /= n;
+            r.mean.total /= n;
+            r.imgui_us /= n;
+            std::sort(totals.begin(), totals.end());
+            r.total_p99_us = totals[std::min(totals.size() - 1, static_cast<size_t>(totals.size() * 0.99))];
+            results.push_back(r);
+
+            printf("%6d nodes %-10s layout %8.1f  interaction %8.1f  wires %8.1f  nodes %8.1f  profiler %8.1f  work %8.1f  imgui %8.1f  total %8.1f us (p99 %8.1f)\n",
+                r.nodes, r.scenario.c_str(), r.mean.layout, r.mean.interaction, r.mean.wires, r.mean.nodes,
+                r.mean.profiler, r.mean.work, r.imgui_us, r.mean.total, r.total_p99_us);
+        }
+    }
+
+    ImGui::DestroyContext();
+
+    if (instrument_dump)
+        lab::noodle::instrument::dump(stdout);
+
+    if (!write_results(output, results))
+        return 1;
+    printf("wrote %d measurements to %s\n", (int) results.size(), output.c_str());
+    return 0;
+}